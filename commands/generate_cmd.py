@@ -25,6 +25,10 @@ durations = ["0.5"]
 
 vxlan_version = 1
 
+# 1 to run the threshold/label settings of a load from one warm-up per
+# compress type, forked at the checkpoint
+checkpoint = 0
+
 def AddLoad(start, outFile):
     global hG
     arr = loads
@@ -81,8 +85,23 @@ def AddMPLS(start, outFile):
         AddIP(cmd, outFile + "MPLS" + str(compress))
 
 
+def AddVariants(start, outFile):
+    variants = []
+    for compress in compress_version:
+        for thres in thresholds:
+            for label in labels:
+                variants.append(str(compress) + ":" + str(thres) + ":" + str(label))
+    cmd = start
+    cmd += "--variants=" + ",".join(variants) + " "
+    for ip in ip_version:
+        AddTransport(cmd + "--ip_version=" + str(ip) + " ", outFile + "Checkpoint-IP" + str(ip))
+
+
 if __name__ == "__main__":
     start = 'nohup ./ns3 run "scratch/header-compress '
     outFile = ""
-    AddMPLS(start, outFile)
+    if checkpoint == 1:
+        AddVariants(start, outFile)
+    else:
+        AddMPLS(start, outFile)
 
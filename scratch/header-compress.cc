@@ -1,11 +1,69 @@
 #include "ns3/rdma-scheduler.h"
 
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+
 #include "topology.h"
 
+#include <algorithm>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("HeaderCompress");
 
+std::string OutputName(std::string flow_file){
+	std::string name = output_dir + "/" + flow_file + "s_IP" + std::to_string(ip_version) + \
+					"_Compress" + std::to_string(compress_version) + \
+					"_RDMA" + std::to_string(transport_version) + \
+					"_Thres" + std::to_string(threshold) + \
+					"_Label" + std::to_string(label_size);
+	
+	if(vxlan_version)
+		name += "_vx"; 
+	// Each rank writes the stats of its own nodes
+	if(system_count > 1)
+		name += "_rank" + std::to_string(system_id);
+	return name;
+}
+
+// Settings of the runs sharing a warm-up, from compress[:threshold[:label]],...
+bool ParseVariants(std::string list, std::vector<std::vector<uint32_t>>& result){
+	std::stringstream stream(list);
+	std::string item;
+	while(std::getline(stream, item, ',')){
+		std::vector<uint32_t> variant = {uint32_t(compress_version), threshold, label_size};
+		if(sscanf(item.c_str(), "%u:%u:%u", &variant[0], &variant[1], &variant[2]) < 1)
+			return false;
+		result.push_back(variant);
+	}
+	return !result.empty();
+}
+
+// Fork a process for every run but the first, which stays in this one.
+// Each process goes on from the same simulation state.
+uint32_t Checkpoint(uint32_t count, std::vector<pid_t>& children){
+	// Buffered output would be written once per process
+	fflush(nullptr);
+	std::cout.flush();
+	for(uint32_t i = 1;i < count;++i){
+		pid_t pid = fork();
+		if(pid < 0){
+			std::cerr << "Failed to fork variant " << i << std::endl;
+			exit(1);
+		}
+		if(pid == 0){
+			children.clear();
+			return i;
+		}
+		children.push_back(pid);
+	}
+	return 0;
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -23,52 +81,205 @@ main(int argc, char* argv[])
 	cmd.AddValue("label_size", "Label size, by default 16384", label_size);
 	cmd.AddValue("vxlan", "VxLAN, by default 0", vxlan_version);
 	cmd.AddValue("transport_version", "0 for tcp, 1 for rdma", transport_version);
+	cmd.AddValue("socket_pool", "TCP connections kept open per source, by default 64", socket_pool);
+	cmd.AddValue("prewarm_version", "1 to connect the pairs of the trace in advance", prewarm_version);
+	cmd.AddValue("workload_version", "0 for the flow file, 1 poisson, 2 incast, 3 ml ring, 4 ml all-to-all", workload_version);
+	cmd.AddValue("cdf", "flow size cdf of generated workloads, by default WebSearch", cdf_name);
+	cmd.AddValue("load", "load of generated workloads, by default 0.5", traffic_load);
+	cmd.AddValue("incast_degree", "senders of the incast workload, by default 16", incast_degree);
+	cmd.AddValue("dump_trace", "1 to write the generated workload to the flow file and exit", dump_trace);
+	cmd.AddValue("pfc_version", "0 to disable PFC for RDMA", pfc_version);
+	cmd.AddValue("irn_version", "1 for selective repeat in RDMA", irn_version);
+	cmd.AddValue("cc_version", "RDMA congestion control, 0 for dcqcn, 1 for hpcc, 2 for swift", cc_version);
+	cmd.AddValue("rate_trace", "1 to dump the rate history of RDMA flows", rate_trace);
+	cmd.AddValue("verb_version", "RDMA verb, 0 for send, 1 for write", verb_version);
+	cmd.AddValue("read_ratio", "Fraction of RDMA flows issued as READ", read_ratio);
+	cmd.AddValue("rdma_mtu", "RoCE MTU, by default 1400", rdma_mtu);
+	cmd.AddValue("deadlock_check", "PFC deadlock detection interval (us), 0 to disable", deadlock_check);
+	cmd.AddValue("deadlock_recover", "1 to lift the pause on a hop of each deadlock found, losing the lossless guarantee", deadlock_recover);
+	cmd.AddValue("threads", "threads of the parallel simulator, by default 0 for sequential", threads);
+	cmd.AddValue("mpi", "1 to spread the pods over the ranks of an MPI run", mpi_version);
+	cmd.AddValue("k", "edges and aggs per pod of the fat tree, by default 3", fat_k);
+	cmd.AddValue("blocks", "pods of the fat tree, by default 6", fat_blocks);
+	cmd.AddValue("ratio", "oversubscription of the edges, by default 4", fat_ratio);
+	cmd.AddValue("fct_start", "start of the window of the FCT statistics (s), by default the trace start", fct_start);
+	cmd.AddValue("fct_end", "end of the window of the FCT statistics (s), by default the end of the run", fct_end);
+	cmd.AddValue("fct_interval", "ms between FCT reports, 0 for the final one only", fct_interval);
+	cmd.AddValue("fct_raw", "1 to write every flow to the .fct file", fct_raw);
+	cmd.AddValue("output", "directory of the output files, by default logs", output_dir);
+	cmd.AddValue("variants", "compress[:threshold[:label]],... to run from one warm-up per compress type", variants);
+	cmd.AddValue("checkpoint", "end of the warm-up shared by the variants (s), by default 1.9", checkpoint_time);
+	cmd.AddValue("converge", "stop once the p99 FCT and compression intervals are within this fraction, 0 to disable", converge);
+	cmd.AddValue("converge_confidence", "confidence level of the intervals, by default 0.95", converge_confidence);
+	cmd.AddValue("converge_interval", "ms between convergence checks, by default 10", converge_interval);
+	cmd.AddValue("converge_min_flows", "flows of a size bucket before its p99 counts, by default 1000", converge_min_flows);
     
     cmd.Parse(argc, argv);
+
+	if(mpi_version){
+#ifdef NS3_MPI
+		GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+		MpiInterface::Enable(&argc, &argv);
+		system_id = MpiInterface::GetSystemId();
+		system_count = MpiInterface::GetSize();
+		threads = 0;
+#else
+		std::cerr << "Not built with MPI" << std::endl;
+		return 1;
+#endif
+	}
+	else if(threads){
+		GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::MultithreadedSimulatorImpl"));
+		Config::SetDefault("ns3::MultithreadedSimulatorImpl::ThreadCount", UintegerValue(threads));
+	}
 	
+	std::vector<pid_t> children;
+	std::vector<std::vector<uint32_t>> forks;
+	if(!variants.empty()){
+		if(!ParseVariants(variants, forks)){
+			std::cerr << "Invalid variants " << variants << std::endl;
+			return 1;
+		}
+		if(mpi_version || checkpoint_time >= start_time){
+			std::cerr << "Variants need a single process and a checkpoint before " << start_time << "s" << std::endl;
+			return 1;
+		}
+		// The NICs and controllers build up their compression state during the
+		// warm-up, so only variants of one compress type can share it; each
+		// type warms up in its own process with its own compression
+		std::vector<uint32_t> types;
+		for(auto& variant : forks){
+			if(std::find(types.begin(), types.end(), variant[0]) == types.end())
+				types.push_back(variant[0]);
+		}
+		uint32_t type = types[Checkpoint(types.size(), children)];
+		std::vector<std::vector<uint32_t>> group;
+		for(auto& variant : forks){
+			if(variant[0] == type)
+				group.push_back(variant);
+		}
+		forks = group;
+		compress_version = forks[0][0];
+		threshold = forks[0][1];
+		label_size = forks[0][2];
+	}
+	// The checks need the counters of every node
+	if(converge > 0 && mpi_version){
+		std::cerr << "Convergence checks need a single process" << std::endl;
+		return 1;
+	}
+
 	std::cout << "Run Experiment for ";
 	if(ip_version == 0) 
 		std::cout << "Ipv4." << std::endl;
 	else if(ip_version == 1) 
 		std::cout << "Ipv6." << std::endl;
 
-	file_name = "logs/" + flow_file + "s_IP" + std::to_string(ip_version) + \
-					"_Compress" + std::to_string(compress_version) + \
-					"_RDMA" + std::to_string(transport_version) + \
-					"_Thres" + std::to_string(threshold) + \
-					"_Label" + std::to_string(label_size);
-	
-	if(vxlan_version)
-		file_name += "_vx"; 
+	file_name = OutputName(flow_file);
 
 	SetVariables();
 	std::cout << "Set Variables" << std::endl;
-	BuildFatTree();
+	// Node ids are 1000 + server, 2000 + edge, 3000 + agg and 4000 + core
+	if(fat_k * fat_k * fat_blocks * fat_ratio > 1000 || fat_k * fat_blocks > 1000){
+		std::cerr << "Fat tree too large for the node ids" << std::endl;
+		return 1;
+	}
+	BuildFatTree(fat_k, fat_blocks, fat_ratio);
 	std::cout << "Build Topology" << std::endl;
 
+	Ptr<WorkloadGenerator> workload = BuildWorkload();
+	if(workload != nullptr && dump_trace){
+		uint64_t flows = workload->Dump("trace/" + flow_file + ".tr");
+		std::cout << "Dump " << flows << " flows to trace/" << flow_file << ".tr" << std::endl;
+		return 0;
+	}
+
 	countFile = fopen((file_name + ".count").c_str(), "w");
 	Simulator::Schedule(Seconds(start_time + 0.001), CountPacket);
 
 	Ptr<TcpScheduler> tcpScheduler;
 	Ptr<RdmaScheduler> rdmaScheduler;
 	if(transport_version == 0){
-		tcpScheduler = Create<TcpScheduler>(flow_file, file_name);
+		tcpScheduler = Create<TcpScheduler>(flow_file, file_name, 
+			ip_version, servers, server_v4addr, server_v6addr, DEFAULT_PORT);
+		if(workload != nullptr)
+			tcpScheduler->SetFlowSource(workload);
+		if(system_count > 1)
+			tcpScheduler->SetSystemId(system_id);
+		SetFctCollector(tcpScheduler->GetFctCollector());
 		StartSinkApp(tcpScheduler);
 		tcpScheduler->Schedule();
 	}
 	else if(transport_version == 1){
 		rdmaScheduler = Create<RdmaScheduler>(flow_file, file_name, 
 			ip_version, nics, server_v4addr, server_v6addr);
+		if(workload != nullptr)
+			rdmaScheduler->SetFlowSource(workload);
+		if(system_count > 1)
+			rdmaScheduler->SetSystemId(system_id);
+		if(rate_trace)
+			rdmaScheduler->EnableRateTrace(file_name);
+		SetFctCollector(rdmaScheduler->GetFctCollector());
+		rdmaScheduler->SetVerbs(verb_version == 1 ? RdmaQueuePair::WRITE : RdmaQueuePair::SEND, read_ratio);
 		rdmaScheduler->Schedule();
+		if(deadlock_check)
+			SwitchNode::StartDeadlockDetector(MicroSeconds(deadlock_check), deadlock_recover);
 	}
 	std::cout << "Start Application" << std::endl;
 	auto start = std::chrono::system_clock::now();
 
-	Simulator::Stop(Seconds(start_time + duration + 5));
+	if(!forks.empty()){
+		Simulator::Stop(Seconds(checkpoint_time));
+		Simulator::Run();
+		std::chrono::duration<double> warm = std::chrono::system_clock::now() - start;
+		std::cout << "Warm-up time: " << warm.count() << "s." << std::endl;
+
+		std::vector<uint32_t> variant = forks[Checkpoint(forks.size(), children)];
+		compress_version = variant[0];
+		threshold = variant[1];
+		label_size = variant[2];
+		file_name = OutputName(flow_file);
+		RestoreSettings();
+		if(tcpScheduler != nullptr)
+			tcpScheduler->SetOutput(file_name);
+		if(rdmaScheduler != nullptr){
+			rdmaScheduler->SetOutput(file_name);
+			if(rate_trace)
+				rdmaScheduler->EnableRateTrace(file_name);
+		}
+		std::cout << "Restore " << file_name << " in process " << getpid() << std::endl;
+	}
+
+	// Scheduled from here, the checks run in the global partition of a
+	// parallel run; the fixed end still bounds a run that does not converge
+	Ptr<ConvergenceController> controller;
+	if(converge > 0 && tcpScheduler != nullptr)
+		controller = StartController(tcpScheduler->GetFctCollector(),
+			MakeCallback(&TcpScheduler::StopFlows, tcpScheduler), MakeCallback(&TcpScheduler::GetInFlight, tcpScheduler));
+	if(converge > 0 && rdmaScheduler != nullptr)
+		controller = StartController(rdmaScheduler->GetFctCollector(),
+			MakeCallback(&RdmaScheduler::StopFlows, rdmaScheduler), MakeCallback(&RdmaScheduler::GetInFlight, rdmaScheduler));
+
+	Simulator::Stop(Seconds(start_time + duration + 5) - Simulator::Now());
 	Simulator::Run();
+	if(controller != nullptr)
+		controller->Finish();
+	if(tcpScheduler != nullptr)
+		tcpScheduler->GetFctCollector()->Finish();
+	if(rdmaScheduler != nullptr)
+		rdmaScheduler->GetFctCollector()->Finish();
+	if(deadlock_check)
+		std::cout << "PFC deadlocks: " << SwitchNode::GetDeadlockCount() << std::endl;
 	Simulator::Destroy();
+#ifdef NS3_MPI
+	if(mpi_version)
+		MpiInterface::Disable();
+#endif
 
 	auto end = std::chrono::system_clock::now();
 	std::chrono::duration<double> diff = end - start;
 	std::cout << "Used time: " << diff.count() << "s." << std::endl;
+
+	for(pid_t child : children)
+		waitpid(child, nullptr, 0);
 }
\ No newline at end of file
@@ -4,12 +4,38 @@
 #include <string>
 
 #define DEFAULT_PORT 80
-#define NUM_SOCKET 10
 
 int ip_version = 0; // 0 for ipv4, 1 for ipv6
 int compress_version = 1; // add mpls or not
 int vxlan_version = 0;
 int transport_version = 0; // 0 for tcp, 1 for rdma
+uint32_t socket_pool = 64; // TCP connections kept open per source
+int prewarm_version = 0; // 1 to connect every pair of the trace before it starts
+int pfc_version = 1; // 0 for lossy RDMA without PFC
+int irn_version = 0; // 1 for selective repeat loss recovery in RDMA
+int cc_version = 0; // RDMA congestion control, 0 for dcqcn, 1 for hpcc, 2 for swift
+int rate_trace = 0; // 1 to dump the rate history of every RDMA flow
+int verb_version = 0; // RDMA verb of a flow, 0 for send, 1 for write
+double read_ratio = 0; // fraction of RDMA flows pulled by the receiver with READ
+uint32_t rdma_mtu = 1400;
+uint32_t deadlock_check = 0; // PFC deadlock detection interval in us, 0 to disable
+int deadlock_recover = 0; // 1 to lift the pause on a hop of each deadlock found
+uint32_t threads = 0; // threads of the parallel simulator, one partition per pod, 0 to run sequentially
+int mpi_version = 0; // 1 to spread the pods over the ranks of an MPI run
+uint32_t system_id = 0; // MPI rank of this process
+uint32_t system_count = 1; // MPI ranks
+std::string variants = ""; // compress[:threshold[:label]],... forked from one warm-up, empty for a single run
+double checkpoint_time = 1.9; // end of the warm-up shared by the variants, before the first flow
+
+int workload_version = 0; // 0 for the trace file, 1 poisson, 2 incast, 3 ml ring, 4 ml all-to-all
+std::string cdf_name = "WebSearch"; // flow sizes from commands/traffic_cdf
+double traffic_load = 0.5;
+uint32_t incast_degree = 16;
+int dump_trace = 0; // 1 to write the generated workload to the flow file and exit
+
+uint32_t fat_k = 3; // edges and aggs per pod, servers per edge are fat_k * fat_ratio
+uint32_t fat_blocks = 6; // pods
+uint32_t fat_ratio = 4;
 
 uint32_t label_size = 16384;
 uint32_t threshold = 100;
@@ -17,6 +43,17 @@ uint32_t threshold = 100;
 double start_time = 2;
 double duration = 0.5;
 
+double fct_start = -1; // window of the FCT statistics (s), flows started in it, by default the whole run
+double fct_end = -1;
+uint32_t fct_interval = 0; // ms between FCT reports, 0 for the final one only
+int fct_raw = 1; // 1 to write every flow to the .fct file
+
+double converge = 0; // relative half-width of the p99 FCT and compression intervals to stop at, 0 to run the whole trace
+double converge_confidence = 0.95;
+uint32_t converge_interval = 10; // ms between checks
+uint64_t converge_min_flows = 1000; // flows of a bucket before its p99 counts
+
+std::string output_dir = "logs"; // directory of the output files
 std::string file_name = "";
 
 #endif
@@ -0,0 +1,338 @@
+#include "ns3/core-module.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+using namespace ns3;
+
+// Runs scratch/header-compress over a grid of settings as parallel processes,
+// each in its own directory under --dir, and gathers the FCT quantiles,
+// compression and control plane counters of every run in <dir>/summary.csv
+//
+//     ./ns3 run "scratch/sweep --compress=0,1,2,3 --load=0.3,0.5 --dataset=WebSearch,Hadoop"
+
+// Settings of a run, in the order of the grid
+struct Setting{
+	std::string dataset;
+	std::string load;
+	uint32_t ip;
+	uint32_t transport;
+	uint32_t compress;
+	uint32_t threshold;
+	uint32_t label;
+};
+
+// A process of the sweep: one run, or with --share_warmup all the variants
+// of compression of a load forked from one warm-up
+struct Job{
+	std::vector<Setting> settings;
+	std::string dir;
+	std::string command;
+	uint64_t memory;
+	pid_t pid{0};
+	std::chrono::steady_clock::time_point start;
+	double seconds{0};
+	int status{0};
+};
+
+std::string dir = "sweep";
+std::string time_str = "0.5";
+std::string hosts = "215";
+std::string bandwidth = "25G";
+uint32_t vxlan = 0;
+
+template <typename T>
+std::vector<T> ParseList(std::string list){
+	std::vector<T> result;
+	std::stringstream stream(list);
+	std::string item;
+	while(std::getline(stream, item, ',')){
+		std::stringstream value(item);
+		T t;
+		value >> t;
+		result.push_back(t);
+	}
+	return result;
+}
+
+std::string FlowName(const Setting& s){
+	return s.dataset + "_" + hosts + "_" + s.load + "_" + bandwidth + "_" + time_str;
+}
+
+// The name header-compress gives to the output files of a run
+std::string OutputName(const Setting& s){
+	std::string name = FlowName(s) + "s_IP" + std::to_string(s.ip) +
+					"_Compress" + std::to_string(s.compress) +
+					"_RDMA" + std::to_string(s.transport) +
+					"_Thres" + std::to_string(s.threshold) +
+					"_Label" + std::to_string(s.label);
+	if(vxlan)
+		name += "_vx";
+	return name;
+}
+
+// Memory the system can give to new processes, in MB
+uint64_t AvailableMemory(){
+	std::ifstream meminfo("/proc/meminfo");
+	std::string key;
+	uint64_t kb;
+	std::string unit;
+	while(meminfo >> key >> kb >> unit){
+		if(key == "MemAvailable:")
+			return kb / 1024;
+	}
+	return 0;
+}
+
+// Reads the comma separated unsigned columns of every line of a file
+std::vector<std::vector<uint64_t>> ReadCsv(std::string file){
+	std::vector<std::vector<uint64_t>> rows;
+	std::ifstream in(file);
+	std::string line;
+	while(std::getline(in, line)){
+		std::vector<uint64_t> row = ParseList<uint64_t>(line);
+		if(!row.empty())
+			rows.push_back(row);
+	}
+	return rows;
+}
+
+// How a run ended: its exit code, or the signal that killed it, by the
+// OOM killer for one
+std::string ExitText(int status){
+	if(WIFEXITED(status))
+		return std::to_string(WEXITSTATUS(status));
+	if(WIFSIGNALED(status))
+		return "signal " + std::to_string(WTERMSIG(status));
+	return "unknown";
+}
+
+bool Failed(int status){
+	return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+// One line of the summary: the settings, then the results read from the
+// .fctstat, .count, .collector and .node files of the run
+std::string Summarize(const Job& job, const Setting& s){
+	std::string base = job.dir + "/" + OutputName(s);
+
+	// time_ms,bucket,flows,fct_mean,fct_50,fct_99,fct_999,slowdown_50,slowdown_99,slowdown_999
+	// for every bucket at each report, the final report last
+	std::map<std::string, std::vector<std::string>> fct;
+	std::ifstream stat(base + ".fctstat");
+	std::string row;
+	std::getline(stat, row);
+	while(std::getline(stat, row)){
+		std::vector<std::string> fields = ParseList<std::string>(row);
+		if(fields.size() == 10)
+			fct[fields[1]] = fields;
+	}
+	std::vector<std::string>& all = fct["all"];
+	std::vector<std::string>& small = fct["<10000"];
+	all.resize(10, "0");
+	small.resize(10, "0");
+
+	// ms,user,mpls,compressed packets sent by the NICs, compressed by any
+	// of the compression modes
+	uint64_t user = 0, compressed = 0;
+	for(auto& row : ReadCsv(base + ".count")){
+		if(row.size() < 4)
+			continue;
+		user += row[1];
+		compressed += row[3];
+	}
+
+	// ms,data,insert,flowUpdate,ruleUpdate,delete since the previous line
+	std::vector<uint64_t> control(5, 0);
+	for(auto& row : ReadCsv(base + ".collector")){
+		for(uint32_t i = 0;i < control.size() && i + 1 < row.size();++i)
+			control[i] += row[i + 1];
+	}
+
+	// id,drops,ecn,pfc,pause,watchdog of every switch
+	uint64_t drops = 0, pfc = 0;
+	for(auto& row : ReadCsv(base + ".node")){
+		if(row.size() < 4)
+			continue;
+		drops += row[1];
+		pfc += row[3];
+	}
+
+	std::stringstream line;
+	line << s.dataset << "," << s.load << "," << s.ip << "," << s.transport << "," << s.compress << ","
+		<< s.threshold << "," << s.label << "," << ExitText(job.status) << "," << Failed(job.status) << ","
+		<< job.seconds << ",";
+	// The files of a killed run end anywhere, its results are left out
+	if(WIFSIGNALED(job.status))
+		return line.str() + std::string(14, ',');
+	line << all[2] << "," << all[3] << "," << all[4] << "," << all[5] << "," << all[6] << ","
+		<< all[8] << "," << small[5] << "," << (user == 0 ? 0 : double(compressed) / user) << ","
+		<< control[0] << "," << control[1] << "," << control[2] << "," << control[3] << "," << control[4] << ","
+		<< drops << "," << pfc;
+	return line.str();
+}
+
+int
+main(int argc, char* argv[])
+{
+	std::string datasets = "WebSearch";
+	std::string loads = "0.5";
+	std::string ips = "0";
+	std::string transports = "0";
+	std::string compresses = "0,1,2,3";
+	std::string thresholds = "100";
+	std::string labels = "16384";
+	std::string binary = "";
+	std::string extra = "";
+	uint32_t jobs = 0;
+	uint64_t memory = 4096;
+	bool shareWarmup = false;
+
+	CommandLine cmd(__FILE__);
+	cmd.AddValue("dataset", "datasets of the flow files, comma separated", datasets);
+	cmd.AddValue("load", "loads of the flow files, comma separated", loads);
+	cmd.AddValue("ip", "ip_version values, comma separated", ips);
+	cmd.AddValue("transport", "transport_version values, comma separated", transports);
+	cmd.AddValue("compress", "compress_version values, comma separated", compresses);
+	cmd.AddValue("threshold", "threshold values, comma separated", thresholds);
+	cmd.AddValue("label", "label_size values, comma separated", labels);
+	cmd.AddValue("time", "duration of the flow files (s), by default 0.5", time_str);
+	cmd.AddValue("hosts", "hosts in the flow file names, by default 215", hosts);
+	cmd.AddValue("bandwidth", "bandwidth in the flow file names, by default 25G", bandwidth);
+	cmd.AddValue("vxlan", "VxLAN of every run, by default 0", vxlan);
+	cmd.AddValue("extra", "other arguments of every run", extra);
+	cmd.AddValue("dir", "directory of the runs and the summary, by default sweep", dir);
+	cmd.AddValue("binary", "header-compress executable, by default next to this one", binary);
+	cmd.AddValue("jobs", "processes at once, by default one per core", jobs);
+	cmd.AddValue("memory", "memory of a run (MB), by default 4096", memory);
+	cmd.AddValue("share_warmup", "fork the compress/threshold/label variants of a load from one warm-up", shareWarmup);
+	cmd.Parse(argc, argv);
+
+	if(binary.empty()){
+		binary = argv[0];
+		size_t pos = binary.rfind("sweep");
+		if(pos == std::string::npos){
+			std::cerr << "Cannot find header-compress, use --binary" << std::endl;
+			return 1;
+		}
+		binary.replace(pos, 5, "header-compress");
+	}
+	if(jobs == 0)
+		jobs = std::max(1U, std::thread::hardware_concurrency());
+	uint64_t budget = AvailableMemory() * 9 / 10;
+
+	std::vector<Job> queue;
+	for(auto& dataset : ParseList<std::string>(datasets)){
+		for(auto& load : ParseList<std::string>(loads)){
+			for(auto ip : ParseList<uint32_t>(ips)){
+				for(auto transport : ParseList<uint32_t>(transports)){
+					std::vector<Setting> variants;
+					for(auto compress : ParseList<uint32_t>(compresses)){
+						for(auto threshold : ParseList<uint32_t>(thresholds)){
+							for(auto label : ParseList<uint32_t>(labels))
+								variants.push_back({dataset, load, ip, transport, compress, threshold, label});
+						}
+					}
+					if(shareWarmup){
+						Job job;
+						job.settings = variants;
+						queue.push_back(job);
+					}
+					else{
+						for(auto& variant : variants){
+							Job job;
+							job.settings.push_back(variant);
+							queue.push_back(job);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	for(auto& job : queue){
+		const Setting& s = job.settings[0];
+		job.dir = dir + "/" + (shareWarmup ? FlowName(s) + "_IP" + std::to_string(s.ip) +
+					"_RDMA" + std::to_string(s.transport) : OutputName(s));
+		std::stringstream args;
+		args << "--flow=" << FlowName(s) << " --time=" << time_str << " --vxlan=" << vxlan
+			<< " --ip_version=" << s.ip << " --transport_version=" << s.transport
+			<< " --output=" << job.dir << " " << extra;
+		if(shareWarmup){
+			args << " --variants=";
+			for(uint32_t i = 0;i < job.settings.size();++i){
+				const Setting& v = job.settings[i];
+				args << (i ? "," : "") << v.compress << ":" << v.threshold << ":" << v.label;
+			}
+		}
+		else
+			args << " --compress_version=" << s.compress << " --threshold=" << s.threshold
+				<< " --label_size=" << s.label;
+		// exec, so that wait sees the signal that kills the run and not the shell
+		job.command = "exec " + binary + " " + args.str() + " > " + job.dir + "/run.out 2>&1";
+		job.memory = memory * job.settings.size();
+		SystemPath::MakeDirectories(job.dir);
+	}
+
+	std::cout << queue.size() << " processes, " << jobs << " at once, " << budget << "MB of memory" << std::endl;
+
+	// Start the jobs in order while cores and memory are left; a job larger
+	// than the whole budget still runs, alone
+	uint32_t next = 0, running = 0, done = 0;
+	uint64_t reserved = 0;
+	std::map<pid_t, uint32_t> pids;
+	while(done < queue.size()){
+		while(next < queue.size() && running < jobs &&
+				(running == 0 || reserved + queue[next].memory <= budget)){
+			Job& job = queue[next];
+			job.start = std::chrono::steady_clock::now();
+			job.pid = fork();
+			if(job.pid < 0){
+				std::cerr << "Failed to fork " << job.command << std::endl;
+				return 1;
+			}
+			if(job.pid == 0){
+				execl("/bin/sh", "sh", "-c", job.command.c_str(), nullptr);
+				_exit(127);
+			}
+			pids[job.pid] = next++;
+			reserved += job.memory;
+			running++;
+		}
+
+		int status;
+		pid_t pid = wait(&status);
+		if(pid < 0){
+			std::cerr << "Failed to wait for the runs" << std::endl;
+			return 1;
+		}
+		if(pids.find(pid) == pids.end())
+			continue;
+		Job& job = queue[pids[pid]];
+		job.status = status;
+		job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - job.start).count();
+		reserved -= job.memory;
+		running--;
+		done++;
+		std::cout << "[" << done << "/" << queue.size() << "] " << job.dir << " exit "
+			<< ExitText(status) << " in " << job.seconds << "s" << (Failed(status) ? ", failed" : "") << std::endl;
+	}
+
+	std::ofstream summary(dir + "/summary.csv");
+	summary << "dataset,load,ip,transport,compress,threshold,label,exit,failed,seconds,"
+		"flows,fct_mean,fct_50,fct_99,fct_999,slowdown_99,short_fct_99,compressed,"
+		"data,insert,flow_update,rule_update,delete,drops,pfc" << std::endl;
+	for(auto& job : queue){
+		for(auto& s : job.settings)
+			summary << Summarize(job, s) << std::endl;
+	}
+	std::cout << "Summary in " << dir << "/summary.csv" << std::endl;
+	return 0;
+}
@@ -29,6 +29,9 @@ std::vector<Ptr<SwitchNode>> aggs;
 std::vector<Ptr<SwitchNode>> cores;
 
 FILE* countFile = nullptr;
+// Packets sent by the NICs since the start, or the checkpoint
+uint64_t userTotal = 0;
+uint64_t compressedTotal = 0;
 
 void SetVariables(){
 	Config::SetDefault("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::TcpDctcp"));
@@ -48,9 +51,19 @@ void SetVariables(){
 	Config::SetDefault("ns3::TcpSocketBase::ClockGranularity", TimeValue(NanoSeconds(10)));
 
 	if(transport_version == 0) // TCP
-		Config::SetDefault("ns3::PointToPointQueue::ECNThreshold", UintegerValue(200000));
+		Config::SetDefault("ns3::StepAqm::Threshold", UintegerValue(200000));
 	else if(transport_version == 1) // RDMA
-		Config::SetDefault("ns3::PointToPointQueue::ECNThreshold", UintegerValue(200000));
+		Config::SetDefault("ns3::StepAqm::Threshold", UintegerValue(200000));
+
+	Config::SetDefault("ns3::PointToPointNetDevice::RdmaSelectiveRepeat", BooleanValue(irn_version == 1));
+	Config::SetDefault("ns3::PointToPointNetDevice::RdmaLossless", BooleanValue(pfc_version != 0));
+	Config::SetDefault("ns3::PointToPointNetDevice::RdmaMtu", UintegerValue(rdma_mtu));
+	if(cc_version == 1){
+		Config::SetDefault("ns3::PointToPointNetDevice::RdmaCc", TypeIdValue(HpccCc::GetTypeId()));
+		Config::SetDefault("ns3::PointToPointNetDevice::IntEnabled", BooleanValue(true));
+	}
+	else if(cc_version == 2)
+		Config::SetDefault("ns3::PointToPointNetDevice::RdmaCc", TypeIdValue(SwiftCc::GetTypeId()));
 	
 	GlobalValue::Bind("ChecksumEnabled", BooleanValue(false));
 }
@@ -205,6 +218,17 @@ void BuildFatTreeRoute(
 	icmpv6->SetAttribute("DAD", BooleanValue(false));
 }
 
+// Nodes of a pod share a partition of the parallel simulator or an MPI rank
+uint32_t SystemOf(uint32_t pod){
+	if(threads)
+		return pod;
+	return pod % system_count;
+}
+
+bool IsLocal(Ptr<Node> node){
+	return node->GetSystemId() == system_id;
+}
+
 void BuildFatTree(
     uint32_t K = 3, 
     uint32_t NUM_BLOCK = 6,
@@ -223,37 +247,40 @@ void BuildFatTree(
 	cores.resize(K * K);
 
 	for(uint32_t i = 0;i < number_server - number_control;++i){
-		servers[i] = CreateObject<Node>();
+		servers[i] = CreateObject<Node>(SystemOf(i / (K * K * RATIO)));
 	}
 	for(uint32_t i = 0;i < number_control;++i){
-		controllers[i] = CreateObject<ControlNode>();
+		controllers[i] = CreateObject<ControlNode>(SystemOf(NUM_BLOCK - 1));
 		controllers[i]->SetID(CONTROL_ID);
 		controllers[i]->SetOutput(file_name);
 		controllers[i]->SetLabelSize(label_size);
 	}
 	for(uint32_t i = 0;i < K * NUM_BLOCK;++i){
-		edges[i] = CreateObject<SwitchNode>(); 
+		edges[i] = CreateObject<SwitchNode>(SystemOf(i / K));
 		edges[i]->SetECMPHash(1);
 		edges[i]->SetID(2000 + i);
 		edges[i]->SetOutput(file_name);
 		edges[i]->SetSetting(compress_version);
-		edges[i]->SetPFC(transport_version);
+		edges[i]->SetPFC(transport_version && pfc_version);
+		edges[i]->SetVxLAN(vxlan_version);
 	}
 	for(uint32_t i = 0;i < K * NUM_BLOCK;++i){
-		aggs[i] = CreateObject<SwitchNode>();
+		aggs[i] = CreateObject<SwitchNode>(SystemOf(i / K));
 		aggs[i]->SetECMPHash(2);
 		aggs[i]->SetID(3000 + i);
 		aggs[i]->SetOutput(file_name);
 		aggs[i]->SetSetting(compress_version);
-		aggs[i]->SetPFC(transport_version);
+		aggs[i]->SetPFC(transport_version && pfc_version);
+		aggs[i]->SetVxLAN(vxlan_version);
 	}
 	for(uint32_t i = 0;i < K * K;++i){
-		cores[i] = CreateObject<SwitchNode>();
+		cores[i] = CreateObject<SwitchNode>(SystemOf(i % NUM_BLOCK));
 		cores[i]->SetECMPHash(3);
 		cores[i]->SetID(4000 + i);
 		cores[i]->SetOutput(file_name);
 		cores[i]->SetSetting(compress_version);
-		cores[i]->SetPFC(transport_version);
+		cores[i]->SetPFC(transport_version && pfc_version);
+		cores[i]->SetVxLAN(vxlan_version);
 	}
 	for(uint32_t i = 0;i < number_control;++i){
 		controllers[i]->SetTopology(K, NUM_BLOCK, RATIO, servers, edges, aggs, cores);
@@ -387,19 +414,48 @@ void BuildFatTree(
 	BuildFatTreeRoute(K, NUM_BLOCK, RATIO);
 }
 
+// A run restored from the checkpoint: switch to its compression settings
+// and start its outputs over under its own file_name
+void RestoreSettings(){
+	for(auto controller : controllers){
+		controller->SetOutput(file_name);
+		controller->SetLabelSize(label_size);
+	}
+	for(auto sws : {&edges, &aggs, &cores}){
+		for(auto sw : *sws){
+			sw->SetOutput(file_name);
+			sw->SetSetting(compress_version);
+		}
+	}
+	for(auto nic : nics){
+		nic->SetSetting(compress_version);
+		nic->SetThreshold(threshold);
+	}
+
+	fclose(countFile);
+	countFile = fopen((file_name + ".count").c_str(), "w");
+	userTotal = 0;
+	compressedTotal = 0;
+}
+
 void CountPacket(){
 	uint64_t userCount = 0;
 	uint64_t mplsCount = 0;
+	uint64_t compressedCount = 0;
 
 	for(auto nic : nics){
 		userCount += nic->GetUserCount();
 		mplsCount += nic->GetMplsCount();
+		compressedCount += nic->GetCompressedCount();
 		nic->SetUserCount(0);
 		nic->SetMplsCount(0);
+		nic->SetCompressedCount(0);
 	}
+	userTotal += userCount;
+	compressedTotal += compressedCount;
 
 	if(userCount != 0 || mplsCount != 0){
-		fprintf(countFile, "%ld,%lu,%lu\n", Simulator::Now().GetMilliSeconds(), userCount, mplsCount);
+		fprintf(countFile, "%ld,%lu,%lu,%lu\n", Simulator::Now().GetMilliSeconds(), userCount, mplsCount, compressedCount);
 		fflush(countFile);
 	}
 
@@ -411,30 +467,58 @@ void CountPacket(){
 	Simulator::Schedule(NanoSeconds(1000000), CountPacket);
 }
 
-void StartSocket(Ptr<TcpScheduler> scheduler){
-	auto sockets = new std::map<std::pair<uint32_t, uint32_t>, std::vector<Ptr<SocketInfo>>>();
-	double delay = 0.000001;
-
-	for(uint16_t port = 10000; port < 10000 + NUM_SOCKET;++port){
-		for(uint32_t src = 0;src < servers.size();++src){
-			for(uint32_t dst = 0;dst < servers.size();++dst){
-				if(src == dst) continue;
-				auto conn = std::make_pair(src, dst);
-				if(ip_version == 0)
-					(*sockets)[conn].push_back(Create<SocketInfo>(servers[src], port, InetSocketAddress(server_v4addr[dst], DEFAULT_PORT)));
-				else
-					(*sockets)[conn].push_back(Create<SocketInfo>(servers[src], port, Inet6SocketAddress(server_v6addr[dst], DEFAULT_PORT)));
-				(*sockets)[conn].back()->Connect(delay);
-				delay += 0.000001;
-			}
-		}
-	}
+Ptr<WorkloadGenerator> BuildWorkload(){
+	if(workload_version == 0)
+		return nullptr;
+	WorkloadGenerator::Config config;
+	config.pattern = WorkloadGenerator::Pattern(workload_version - 1);
+	config.cdfFile = "commands/traffic_cdf/" + cdf_name + ".txt";
+	config.hostCount = servers.size();
+	config.load = traffic_load;
+	config.start = start_time * 1e9;
+	config.duration = duration * 1e9;
+	config.incastDegree = incast_degree;
+	return Create<WorkloadGenerator>(config);
+}
+
+void SetFctCollector(Ptr<FctCollector> fct){
+	fct->SetRaw(fct_raw);
+	fct->SetWindow((fct_start < 0 ? start_time : fct_start) * 1e9,
+		(fct_end < 0 ? start_time + duration + 5 : fct_end) * 1e9);
+	// Host links, and the round trip of the longest path of six 1us links
+	fct->SetIdeal(100e9, 12000);
+	if(fct_interval)
+		fct->SetInterval(MilliSeconds(fct_interval));
+}
+
+uint64_t GetUserTotal(){
+	return userTotal;
+}
+
+uint64_t GetCompressedTotal(){
+	return compressedTotal;
+}
 
-	scheduler->SetSockets(sockets);
+// Checks from the start of the FCT window that the p99 FCTs and the share
+// of packets sent with a label are within converge, then stops the flows
+Ptr<ConvergenceController> StartController(Ptr<FctCollector> fct, Callback<void> stop, Callback<uint64_t> inFlight){
+	Ptr<ConvergenceController> controller = Create<ConvergenceController>(fct);
+	controller->SetTolerance(converge, converge_confidence);
+	controller->SetMinFlows(converge_min_flows);
+	// Every compression mode counts its compressed packets, none without compression
+	if(compress_version != 0)
+		controller->TrackRatio("compressed", MakeCallback(&GetCompressedTotal), MakeCallback(&GetUserTotal));
+	else
+		std::cout << "No compression, the compressed share is not tracked" << std::endl;
+	controller->SetFlows(stop, inFlight);
+	controller->Start(Seconds(fct_start < 0 ? start_time : fct_start), MilliSeconds(converge_interval));
+	return controller;
 }
 
 void StartSinkApp(Ptr<TcpScheduler> scheduler){
 	for(uint32_t i = 0;i < servers.size();++i){
+		if(!IsLocal(servers[i]))
+			continue;
 		ApplicationContainer sinkApps;
 		if(ip_version == 0){
 			PacketSinkHelper sink("ns3::TcpSocketFactory",
@@ -450,7 +534,9 @@ void StartSinkApp(Ptr<TcpScheduler> scheduler){
 		sinkApps.Stop(Seconds(start_time + duration + 4));
 	}
 
-	Simulator::Schedule(Seconds(start_time - 1.6), StartSocket, scheduler);
+	scheduler->SetPoolSize(socket_pool);
+	if(prewarm_version)
+		Simulator::Schedule(Seconds(start_time - 1.6), &TcpScheduler::Prewarm, scheduler, 0.000001);
 }
 
 #endif 
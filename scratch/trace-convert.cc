@@ -0,0 +1,29 @@
+#include "ns3/core-module.h"
+#include "ns3/flow-trace.h"
+
+using namespace ns3;
+
+// Converts trace/<flow>.tr into the binary trace/<flow>.bin read by the schedulers
+int
+main(int argc, char* argv[])
+{
+	std::string flow_file = "test";
+	std::string workload = "";
+	uint32_t host_count = 0;
+
+	CommandLine cmd(__FILE__);
+	cmd.AddValue("flow", "the flow file", flow_file);
+	cmd.AddValue("workload", "workload name kept in the header, by default the flow file", workload);
+	cmd.AddValue("hosts", "number of hosts, by default the largest host id plus one", host_count);
+	cmd.Parse(argc, argv);
+
+	if(workload.empty())
+		workload = flow_file;
+	if(!FlowTrace::Convert("trace/" + flow_file + ".tr", "trace/" + flow_file + ".bin", workload, host_count))
+		return 1;
+
+	FlowTrace trace(flow_file);
+	std::cout << "Converted " << flow_file << ": " << trace.GetHostCount() << " hosts, workload "
+		<< trace.GetWorkload() << std::endl;
+	return 0;
+}
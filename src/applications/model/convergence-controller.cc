@@ -0,0 +1,204 @@
+#include "convergence-controller.h"
+
+#include "ns3/simulator.h"
+
+#include <cmath>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("ConvergenceController");
+
+NS_OBJECT_ENSURE_REGISTERED(ConvergenceController);
+
+TypeId
+ConvergenceController::GetTypeId()
+{
+	static TypeId tid = TypeId("ns3::ConvergenceController")
+							.SetParent<Object>()
+							.SetGroupName("Applications");
+	return tid;
+}
+
+ConvergenceController::ConvergenceController(Ptr<FctCollector> fct)
+	: m_fct(fct)
+{
+}
+
+void
+ConvergenceController::SetTolerance(double tolerance, double confidence)
+{
+	if(tolerance <= 0 || confidence <= 0 || confidence >= 1){
+		std::cerr << "Invalid tolerance " << tolerance << " at confidence " << confidence << std::endl;
+		exit(1);
+	}
+	m_tolerance = tolerance;
+	// Two-sided normal quantile, erf(z / sqrt(2)) = confidence
+	double low = 0, high = 10;
+	for(uint32_t i = 0;i < 64;++i){
+		m_z = (low + high) / 2;
+		if(std::erf(m_z / std::sqrt(2.0)) < confidence)
+			low = m_z;
+		else
+			high = m_z;
+	}
+}
+
+void
+ConvergenceController::SetMinFlows(uint64_t minFlows)
+{
+	m_minFlows = minFlows;
+}
+
+void
+ConvergenceController::SetMinBatches(uint32_t minBatches)
+{
+	m_minBatches = std::max(2U, minBatches);
+}
+
+void
+ConvergenceController::TrackRatio(std::string name, Callback<uint64_t> numerator, Callback<uint64_t> denominator)
+{
+	Ratio ratio;
+	ratio.name = name;
+	ratio.numerator = numerator;
+	ratio.denominator = denominator;
+	m_ratios.push_back(ratio);
+}
+
+void
+ConvergenceController::SetFlows(Callback<void> stop, Callback<uint64_t> inFlight)
+{
+	m_stop = stop;
+	m_inFlight = inFlight;
+}
+
+void
+ConvergenceController::Start(Time start, Time interval)
+{
+	m_interval = interval;
+	Simulator::Schedule(std::max(start - Simulator::Now(), Time(0)), &ConvergenceController::Check, this);
+}
+
+bool
+ConvergenceController::CheckFct(std::string& report)
+{
+	bool converged = true;
+	std::stringstream out;
+	for(uint32_t b = 0;b <= FctCollector::BUCKETS;++b){
+		QuantileSketch sketch = m_fct->GetFctSketch(b);
+		out << "  fct_99 " << FctCollector::GetBucketName(b) << ": ";
+		if(sketch.GetCount() < m_minFlows){
+			out << sketch.GetCount() << " flows, ";
+			// Rare buckets are left out, all the flows are not
+			if(b == FctCollector::BUCKETS){
+				converged = false;
+				out << "too few" << std::endl;
+			}
+			else
+				out << "skipped" << std::endl;
+			continue;
+		}
+		double estimate = sketch.Quantile(0.99);
+		double low, high;
+		sketch.Interval(0.99, m_z, low, high);
+		double halfWidth = std::max(estimate - low, high - estimate);
+		if(halfWidth > m_tolerance * estimate)
+			converged = false;
+		out << estimate << "ns in [" << low << ", " << high << "], +-"
+			<< (estimate == 0 ? 0 : 100 * halfWidth / estimate) << "% of "
+			<< sketch.GetCount() << " flows" << std::endl;
+	}
+	report += out.str();
+	return converged;
+}
+
+bool
+ConvergenceController::CheckRatios(std::string& report)
+{
+	bool converged = true;
+	std::stringstream out;
+	for(auto& ratio : m_ratios){
+		uint64_t numerator = ratio.numerator();
+		uint64_t denominator = ratio.denominator();
+		// The first check sets where the batches start; a batch with
+		// nothing sent adds nothing
+		if(ratio.started && denominator > ratio.lastDenominator){
+			double value = double(numerator - ratio.lastNumerator) / (denominator - ratio.lastDenominator);
+			ratio.batches++;
+			ratio.sum += value;
+			ratio.squareSum += value * value;
+		}
+		ratio.started = true;
+		ratio.lastNumerator = numerator;
+		ratio.lastDenominator = denominator;
+
+		out << "  " << ratio.name << ": ";
+		if(ratio.batches < m_minBatches){
+			converged = false;
+			out << ratio.batches << " batches, too few" << std::endl;
+			continue;
+		}
+		double mean = ratio.sum / ratio.batches;
+		double variance = std::max(0.0, (ratio.squareSum - ratio.batches * mean * mean) / (ratio.batches - 1));
+		double halfWidth = m_z * std::sqrt(variance / ratio.batches);
+		if(halfWidth > m_tolerance * mean)
+			converged = false;
+		out << mean << " +-" << halfWidth << " of " << ratio.batches << " batches" << std::endl;
+	}
+	report += out.str();
+	return converged;
+}
+
+void
+ConvergenceController::Check()
+{
+	uint64_t ms = Simulator::Now().GetMilliSeconds();
+	if(m_converged){
+		uint64_t inFlight = m_inFlight.IsNull() ? 0 : m_inFlight();
+		if(inFlight == 0){
+			std::cout << "Drained at " << ms << "ms, stop the run" << std::endl;
+			Simulator::Stop();
+			return;
+		}
+		Simulator::Schedule(m_interval, &ConvergenceController::Check, this);
+		return;
+	}
+
+	std::string report;
+	bool fct = CheckFct(report);
+	bool ratios = CheckRatios(report);
+	m_report = report;
+	if(fct && ratios){
+		m_converged = true;
+		std::cout << "Converged at " << ms << "ms within " << 100 * m_tolerance
+			<< "%, stop starting flows" << std::endl << report;
+		if(!m_stop.IsNull())
+			m_stop();
+		Check();
+		return;
+	}
+	Simulator::Schedule(m_interval, &ConvergenceController::Check, this);
+}
+
+void
+ConvergenceController::Finish()
+{
+	if(m_finished)
+		return;
+	m_finished = true;
+	if(!m_converged)
+		std::cout << "Not converged within " << 100 * m_tolerance << "% by "
+			<< Simulator::Now().GetMilliSeconds() << "ms" << std::endl << m_report;
+	else if(!m_inFlight.IsNull() && m_inFlight() != 0)
+		std::cout << m_inFlight() << " flows still in flight at the end of the run" << std::endl;
+}
+
+bool
+ConvergenceController::IsConverged() const
+{
+	return m_converged;
+}
+
+} // namespace ns3
@@ -0,0 +1,91 @@
+#ifndef CONVERGENCE_CONTROLLER_H
+#define CONVERGENCE_CONTROLLER_H
+
+#include "fct-collector.h"
+
+#include "ns3/callback.h"
+#include "ns3/nstime.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Ends a run once its results are known to the tolerance asked for
+ *
+ * Every interval the p99 FCT of every size bucket with enough flows, and
+ * of all the flows, gets a distribution-free confidence interval from the
+ * ranks around it in the sketch of the collector. Each tracked ratio of two
+ * cumulative counters, the compressed packets over those sent for one, gets
+ * one from the means of its intervals, as batches. Once every half-width
+ * is within the tolerance of its estimate, no new flow starts; the run
+ * stops when those in flight complete. The fixed end of the run still
+ * bounds it.
+ *
+ * Check reads the counters of every node, it runs in the global partition
+ * of a parallel run; a distributed run has no global view and is not
+ * supported.
+ */
+class ConvergenceController : public Object
+{
+	public:
+		static TypeId GetTypeId();
+
+		ConvergenceController(Ptr<FctCollector> fct);
+
+		// Relative half-width of the intervals at the confidence level
+		void SetTolerance(double tolerance, double confidence);
+		// Flows a bucket needs to count, all the flows need as many
+		void SetMinFlows(uint64_t minFlows);
+		// Batches a ratio needs to count
+		void SetMinBatches(uint32_t minBatches);
+		// Ratio of the increments of two cumulative counters
+		void TrackRatio(std::string name, Callback<uint64_t> numerator, Callback<uint64_t> denominator);
+		// Stops the flows from starting, and counts those not completed
+		void SetFlows(Callback<void> stop, Callback<uint64_t> inFlight);
+
+		// First check at start, then every interval
+		void Start(Time start, Time interval);
+		// Writes the intervals of the last check if the run did not converge
+		void Finish();
+		bool IsConverged() const;
+
+	private:
+		struct Ratio{
+			std::string name;
+			Callback<uint64_t> numerator;
+			Callback<uint64_t> denominator;
+			uint64_t lastNumerator{0};
+			uint64_t lastDenominator{0};
+			bool started{false};
+			// Of the ratios of the batches
+			uint32_t batches{0};
+			double sum{0};
+			double squareSum{0};
+		};
+
+		void Check();
+		// Appends a line per interval to report, false if one is too wide
+		bool CheckFct(std::string& report);
+		bool CheckRatios(std::string& report);
+
+		Ptr<FctCollector> m_fct;
+		double m_tolerance{0.05};
+		double m_z{1.96};
+		uint64_t m_minFlows{1000};
+		uint32_t m_minBatches{10};
+		std::vector<Ratio> m_ratios;
+		Callback<void> m_stop;
+		Callback<uint64_t> m_inFlight;
+
+		Time m_interval;
+		bool m_converged{false};
+		bool m_finished{false};
+		std::string m_report;
+};
+
+} // namespace ns3
+
+#endif /* CONVERGENCE_CONTROLLER_H */
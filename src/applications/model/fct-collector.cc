@@ -0,0 +1,303 @@
+#include "fct-collector.h"
+
+#include "ns3/simulator.h"
+
+#include <cmath>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("FctCollector");
+
+NS_OBJECT_ENSURE_REGISTERED(FctCollector);
+
+QuantileSketch::QuantileSketch(double accuracy)
+{
+	m_gamma = (1 + accuracy) / (1 - accuracy);
+	m_logGamma = std::log(m_gamma);
+}
+
+int32_t
+QuantileSketch::Index(double value) const
+{
+	return std::ceil(std::log(value) / m_logGamma);
+}
+
+void
+QuantileSketch::Add(double value)
+{
+	m_count++;
+	m_sum += value;
+	if(value <= 0){
+		m_zero++;
+		return;
+	}
+	int32_t index = Index(value);
+	if(m_bins.empty()){
+		m_offset = index;
+		m_bins.resize(1, 0);
+	}
+	else if(index < m_offset){
+		m_bins.insert(m_bins.begin(), m_offset - index, 0);
+		m_offset = index;
+	}
+	else if(index >= m_offset + int32_t(m_bins.size()))
+		m_bins.resize(index - m_offset + 1, 0);
+	m_bins[index - m_offset]++;
+}
+
+void
+QuantileSketch::Merge(const QuantileSketch& other)
+{
+	if(!other.m_bins.empty()){
+		if(m_bins.empty()){
+			m_offset = other.m_offset;
+			m_bins.resize(other.m_bins.size(), 0);
+		}
+		int32_t low = std::min(m_offset, other.m_offset);
+		int32_t high = std::max(m_offset + int32_t(m_bins.size()), other.m_offset + int32_t(other.m_bins.size()));
+		if(low < m_offset)
+			m_bins.insert(m_bins.begin(), m_offset - low, 0);
+		m_offset = low;
+		m_bins.resize(high - low, 0);
+		for(uint32_t i = 0;i < other.m_bins.size();++i)
+			m_bins[other.m_offset - m_offset + i] += other.m_bins[i];
+	}
+	m_zero += other.m_zero;
+	m_count += other.m_count;
+	m_sum += other.m_sum;
+}
+
+double
+QuantileSketch::Quantile(double q) const
+{
+	if(m_count == 0)
+		return 0;
+	return Value(q * (m_count - 1));
+}
+
+void
+QuantileSketch::Interval(double q, double z, double& low, double& high) const
+{
+	double center = m_count * q;
+	double spread = z * std::sqrt(m_count * q * (1 - q));
+	double last = m_count == 0 ? 0 : m_count - 1;
+	low = Value(std::max(0.0, std::floor(center - spread)));
+	high = Value(std::min(last, std::ceil(center + spread)));
+}
+
+double
+QuantileSketch::Value(uint64_t rank) const
+{
+	if(m_count == 0)
+		return 0;
+	if(rank < m_zero)
+		return 0;
+	uint64_t seen = m_zero;
+	for(uint32_t i = 0;i < m_bins.size();++i){
+		seen += m_bins[i];
+		if(seen > rank)
+			return 2 * std::pow(m_gamma, m_offset + int32_t(i)) / (m_gamma + 1);
+	}
+	return 2 * std::pow(m_gamma, m_offset + int32_t(m_bins.size()) - 1) / (m_gamma + 1);
+}
+
+uint64_t
+QuantileSketch::GetCount() const
+{
+	return m_count;
+}
+
+double
+QuantileSketch::GetMean() const
+{
+	return m_count == 0 ? 0 : m_sum / m_count;
+}
+
+const uint32_t FctCollector::BOUNDS[FctCollector::BUCKETS - 1] = {10000, 100000, 1000000};
+
+std::string
+FctCollector::GetBucketName(uint32_t bucket)
+{
+	if(bucket == BUCKETS)
+		return "all";
+	if(bucket == BUCKETS - 1)
+		return ">=" + std::to_string(BOUNDS[bucket - 1]);
+	return "<" + std::to_string(BOUNDS[bucket]);
+}
+
+TypeId
+FctCollector::GetTypeId()
+{
+	static TypeId tid = TypeId("ns3::FctCollector")
+							.SetParent<Object>()
+							.SetGroupName("Applications");
+	return tid;
+}
+
+FctCollector::FctCollector(std::string output)
+	: m_output(output),
+	  m_fct(BUCKETS),
+	  m_slowdown(BUCKETS)
+{
+	Open();
+}
+
+FctCollector::~FctCollector()
+{
+	Finish();
+	if(m_rawFile != nullptr)
+		fclose(m_rawFile);
+	fclose(m_statFile);
+}
+
+void
+FctCollector::Open()
+{
+	if(m_rawFile != nullptr){
+		fclose(m_rawFile);
+		m_rawFile = nullptr;
+	}
+	if(m_statFile != nullptr)
+		fclose(m_statFile);
+
+	if(m_raw){
+		if((m_rawFile = fopen((m_output + ".fct").c_str(), "w")) == nullptr){
+			std::cerr << "Failed to open fct file" << std::endl;
+			exit(1);
+		}
+		// Flushed when full or closed rather than per flow
+		m_rawBuffer.resize(1 << 20);
+		setvbuf(m_rawFile, m_rawBuffer.data(), _IOFBF, m_rawBuffer.size());
+	}
+	if((m_statFile = fopen((m_output + ".fctstat").c_str(), "w")) == nullptr){
+		std::cerr << "Failed to open fctstat file" << std::endl;
+		exit(1);
+	}
+	fprintf(m_statFile, "time_ms,bucket,flows,fct_mean,fct_50,fct_99,fct_999,slowdown_50,slowdown_99,slowdown_999\n");
+}
+
+void
+FctCollector::SetOutput(std::string output)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_output = output;
+	Open();
+	m_fct.assign(BUCKETS, QuantileSketch());
+	m_slowdown.assign(BUCKETS, QuantileSketch());
+	m_lastEnd = 0;
+	m_finished = false;
+}
+
+void
+FctCollector::SetRaw(bool raw)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(raw == m_raw)
+		return;
+	m_raw = raw;
+	Open();
+}
+
+void
+FctCollector::SetWindow(uint64_t start, uint64_t end)
+{
+	m_start = start;
+	m_end = end;
+}
+
+void
+FctCollector::SetIdeal(double bandwidth, uint64_t baseDelay)
+{
+	m_bandwidth = bandwidth;
+	m_baseDelay = baseDelay;
+}
+
+void
+FctCollector::SetInterval(Time interval)
+{
+	bool scheduled = m_interval.IsStrictlyPositive();
+	m_interval = interval;
+	if(!scheduled && m_interval.IsStrictlyPositive())
+		Simulator::Schedule(m_interval, &FctCollector::ReportInterval, this);
+}
+
+void
+FctCollector::Record(const FlowInfo& flow)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint64_t fct = flow.end - flow.start;
+	if(m_rawFile != nullptr)
+		fprintf(m_rawFile, "%u,%u,%u,%u,%lu,%lu,%lu\n",
+			flow.index, flow.src, flow.dst, flow.size, flow.start, flow.end, fct);
+	m_lastEnd = std::max(m_lastEnd, flow.end);
+	m_completed++;
+	if(flow.start < m_start || flow.start >= m_end)
+		return;
+
+	uint32_t bucket = 0;
+	while(bucket < BUCKETS - 1 && flow.size >= BOUNDS[bucket])
+		bucket++;
+	double ideal = m_baseDelay + flow.size * 8e9 / m_bandwidth;
+	m_fct[bucket].Add(fct);
+	m_slowdown[bucket].Add(fct / ideal);
+}
+
+void
+FctCollector::Report(uint64_t ms)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	QuantileSketch fctAll, slowdownAll;
+	for(uint32_t b = 0;b <= BUCKETS;++b){
+		// The last line of a report is of all the flows
+		const QuantileSketch& fct = (b < BUCKETS ? m_fct[b] : fctAll);
+		const QuantileSketch& slowdown = (b < BUCKETS ? m_slowdown[b] : slowdownAll);
+		if(b < BUCKETS){
+			fctAll.Merge(fct);
+			slowdownAll.Merge(slowdown);
+		}
+		fprintf(m_statFile, "%lu,%s,%lu,%.0f,%.0f,%.0f,%.0f,%.3f,%.3f,%.3f\n", ms, GetBucketName(b).c_str(),
+			fct.GetCount(), fct.GetMean(), fct.Quantile(0.5), fct.Quantile(0.99), fct.Quantile(0.999),
+			slowdown.Quantile(0.5), slowdown.Quantile(0.99), slowdown.Quantile(0.999));
+	}
+	fflush(m_statFile);
+}
+
+QuantileSketch
+FctCollector::GetFctSketch(uint32_t bucket)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(bucket < BUCKETS)
+		return m_fct[bucket];
+	QuantileSketch all;
+	for(auto& sketch : m_fct)
+		all.Merge(sketch);
+	return all;
+}
+
+uint64_t
+FctCollector::GetCompleted()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_completed;
+}
+
+void
+FctCollector::ReportInterval()
+{
+	Report(Simulator::Now().GetMilliSeconds());
+	Simulator::Schedule(m_interval, &FctCollector::ReportInterval, this);
+}
+
+void
+FctCollector::Finish()
+{
+	if(m_finished)
+		return;
+	m_finished = true;
+	Report(m_lastEnd / 1000000);
+	if(m_rawFile != nullptr)
+		fflush(m_rawFile);
+}
+
+} // namespace ns3
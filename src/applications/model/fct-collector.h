@@ -0,0 +1,130 @@
+#ifndef FCT_COLLECTOR_H
+#define FCT_COLLECTOR_H
+
+#include <stdio.h>
+
+#include "socket-info.h"
+
+#include "ns3/nstime.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief DDSketch of positive values
+ *
+ * Values fall in log-spaced bins of ratio (1 + accuracy) / (1 - accuracy),
+ * so every quantile is within accuracy of the exact one, relatively, with
+ * a few thousand bins from 1ns to hours. Sketches of the same accuracy
+ * merge by adding their bins, as those of the ranks of an MPI run.
+ */
+class QuantileSketch
+{
+	public:
+		QuantileSketch(double accuracy = 0.01);
+
+		void Add(double value);
+		void Merge(const QuantileSketch& other);
+		// Value of rank q * (count - 1), 0 when empty
+		double Quantile(double q) const;
+		// Distribution-free confidence interval of the q quantile: the
+		// values of the ranks z standard deviations of a binomial(count, q)
+		// around count * q
+		void Interval(double q, double z, double& low, double& high) const;
+
+		uint64_t GetCount() const;
+		double GetMean() const;
+
+	private:
+		int32_t Index(double value) const;
+		double Value(uint64_t rank) const;
+
+		double m_gamma;
+		double m_logGamma;
+		int32_t m_offset{0}; // index of m_bins[0]
+		std::vector<uint64_t> m_bins;
+		uint64_t m_zero{0};  // values <= 0
+		uint64_t m_count{0};
+		double m_sum{0};
+};
+
+/**
+ * \brief FCT statistics of the completed flows, kept as they complete
+ *
+ * Flows started in the window go to sketches of their FCT and slowdown
+ * (FCT over the ideal one, size at the bandwidth plus the base delay),
+ * per size bucket as in commands/fct.py. Report writes the p50/p99/p99.9
+ * of every bucket to <output>.fctstat, at the end and every interval if
+ * one is set. The raw per-flow lines go to <output>.fct when enabled,
+ * through a large buffer.
+ *
+ * Flows may complete in any partition of a parallel run, Record locks.
+ */
+class FctCollector : public Object
+{
+	public:
+		static TypeId GetTypeId();
+
+		// Size buckets, the last of which holds the largest flows
+		static const uint32_t BUCKETS = 4;
+		// Bucket BUCKETS stands for all the flows
+		static std::string GetBucketName(uint32_t bucket);
+
+		FctCollector(std::string output);
+		~FctCollector() override;
+
+		// Start the outputs over under another name, the statistics too
+		void SetOutput(std::string output);
+		void SetRaw(bool raw);
+		// Flows started in [start, end) ns
+		void SetWindow(uint64_t start, uint64_t end);
+		// Ideal FCT of a flow: size at bandwidth (bps) plus baseDelay (ns)
+		void SetIdeal(double bandwidth, uint64_t baseDelay);
+		void SetInterval(Time interval);
+
+		// flow.end is set
+		void Record(const FlowInfo& flow);
+		// Writes the quantiles of every bucket at time ms
+		void Report(uint64_t ms);
+		// The final report, at the last completion, once
+		void Finish();
+
+		// FCTs of the flows of a bucket in the window
+		QuantileSketch GetFctSketch(uint32_t bucket);
+		// Flows recorded, in the window or not
+		uint64_t GetCompleted();
+
+	private:
+		// Upper bounds of the buckets but the last, in bytes
+		static const uint32_t BOUNDS[BUCKETS - 1];
+
+		void Open();
+		void ReportInterval();
+
+		std::string m_output;
+		bool m_raw{true};
+		uint64_t m_start{0};
+		uint64_t m_end{UINT64_MAX};
+		double m_bandwidth{100e9};
+		uint64_t m_baseDelay{0};
+		Time m_interval;
+
+		FILE* m_rawFile{nullptr};
+		std::vector<char> m_rawBuffer;
+		FILE* m_statFile{nullptr};
+		bool m_finished{false};
+
+		std::mutex m_mutex;
+		std::vector<QuantileSketch> m_fct;
+		std::vector<QuantileSketch> m_slowdown;
+		uint64_t m_lastEnd{0};
+		uint64_t m_completed{0};
+};
+
+} // namespace ns3
+
+#endif /* FCT_COLLECTOR_H */
@@ -0,0 +1,206 @@
+#include "flow-trace.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+FlowSource::~FlowSource()
+{
+}
+
+FlowTrace::FlowTrace(std::string name)
+	: m_name(name)
+{
+	memset(&m_header, 0, sizeof(m_header));
+
+	std::string binFile = "trace/" + name + ".bin";
+	std::string textFile = "trace/" + name + ".tr";
+	int fd = open(binFile.c_str(), O_RDONLY);
+	struct stat st, textSt;
+	if(fd >= 0 && fstat(fd, &st) == 0 && stat(textFile.c_str(), &textSt) == 0 &&
+		(textSt.st_mtim.tv_sec > st.st_mtim.tv_sec ||
+		(textSt.st_mtim.tv_sec == st.st_mtim.tv_sec && textSt.st_mtim.tv_nsec > st.st_mtim.tv_nsec))){
+		// A regenerated trace, the runs of a sweep may share the directory so
+		// it is not converted here
+		std::cerr << textFile << " is newer than " << binFile << ", reading it instead;"
+			<< " run trace-convert again to use the binary file" << std::endl;
+		close(fd);
+		fd = -1;
+	}
+	if(fd < 0){
+		if((m_file = fopen(textFile.c_str(), "r")) == nullptr){
+			std::cerr << "Failed to open flow file" << std::endl;
+			exit(1);
+		}
+		strncpy(m_header.workload, name.c_str(), sizeof(m_header.workload) - 1);
+		return;
+	}
+
+	if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(Header)){
+		std::cerr << "Truncated flow file " << binFile << std::endl;
+		exit(1);
+	}
+	m_mapSize = st.st_size;
+	void* map = mmap(nullptr, m_mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED){
+		std::cerr << "Failed to map flow file " << binFile << std::endl;
+		exit(1);
+	}
+	m_map = (uint8_t*)map;
+	madvise(m_map, m_mapSize, MADV_SEQUENTIAL);
+
+	memcpy(&m_header, m_map, sizeof(Header));
+	if(m_header.magic != MAGIC || m_header.version != VERSION || m_header.recordSize != sizeof(Record)){
+		std::cerr << "Unknown flow file format " << binFile << std::endl;
+		exit(1);
+	}
+	if(sizeof(Header) + m_header.flowCount * sizeof(Record) > m_mapSize){
+		std::cerr << "Truncated flow file " << binFile << std::endl;
+		exit(1);
+	}
+	m_records = (const Record*)(m_map + sizeof(Header));
+}
+
+FlowTrace::~FlowTrace()
+{
+	if(m_map != nullptr)
+		munmap(m_map, m_mapSize);
+	if(m_file != nullptr)
+		fclose(m_file);
+}
+
+bool
+FlowTrace::Peek(FlowInfo& flow)
+{
+	if(m_records != nullptr){
+		if(m_index >= m_header.flowCount)
+			return false;
+		// Ask the kernel for the next window before the reader gets there
+		if(m_index >= m_prefetched){
+			uint64_t end = std::min<uint64_t>(m_header.flowCount, m_index + 2 * WINDOW);
+			size_t page = sysconf(_SC_PAGESIZE);
+			size_t from = (sizeof(Header) + m_index * sizeof(Record)) / page * page;
+			size_t to = sizeof(Header) + end * sizeof(Record);
+			madvise(m_map + from, to - from, MADV_WILLNEED);
+			m_prefetched = m_index + WINDOW;
+		}
+		const Record& record = m_records[m_index];
+		flow = FlowInfo(m_index + 1, record.src, record.dst, record.size, record.start);
+		return true;
+	}
+
+	if(m_cursor >= m_window.size())
+		Refill();
+	if(m_cursor >= m_window.size())
+		return false;
+	flow = m_window[m_cursor];
+	return true;
+}
+
+void
+FlowTrace::Pop()
+{
+	if(m_records != nullptr)
+		m_index += 1;
+	else
+		m_cursor += 1;
+}
+
+Ptr<FlowSource>
+FlowTrace::Copy() const
+{
+	return Create<FlowTrace>(m_name);
+}
+
+void
+FlowTrace::Refill()
+{
+	m_window.clear();
+	m_cursor = 0;
+	char line[100];
+	uint32_t src, dst, size;
+	uint64_t start;
+	while(m_window.size() < WINDOW && fgets(line, sizeof(line), m_file)){
+		if(sscanf(line, "%u %u %u %" SCNu64, &src, &dst, &size, &start) == 4){
+			m_index += 1;
+			m_window.emplace_back(m_index, src, dst, size, start);
+		}
+	}
+}
+
+uint32_t
+FlowTrace::GetHostCount() const
+{
+	return m_header.hostCount;
+}
+
+std::string
+FlowTrace::GetWorkload() const
+{
+	return std::string(m_header.workload, strnlen(m_header.workload, sizeof(m_header.workload)));
+}
+
+bool
+FlowTrace::Convert(std::string textFile, std::string binFile, std::string workload, uint32_t hostCount)
+{
+	FILE* in = fopen(textFile.c_str(), "r");
+	if(in == nullptr){
+		std::cerr << "Failed to open " << textFile << std::endl;
+		return false;
+	}
+	FILE* out = fopen(binFile.c_str(), "wb");
+	if(out == nullptr){
+		std::cerr << "Failed to open " << binFile << std::endl;
+		fclose(in);
+		return false;
+	}
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.recordSize = sizeof(Record);
+	strncpy(header.workload, workload.c_str(), sizeof(header.workload) - 1);
+	// Rewritten with the counts once all records are out
+	fwrite(&header, sizeof(header), 1, out);
+
+	uint32_t maxHost = 0;
+	char line[100];
+	std::vector<Record> records;
+	records.reserve(WINDOW);
+	while(fgets(line, sizeof(line), in)){
+		Record record;
+		memset(&record, 0, sizeof(record));
+		if(sscanf(line, "%u %u %u %" SCNu64, &record.src, &record.dst, &record.size, &record.start) != 4)
+			continue;
+		maxHost = std::max(maxHost, std::max(record.src, record.dst));
+		records.push_back(record);
+		header.flowCount += 1;
+		if(records.size() == WINDOW){
+			fwrite(records.data(), sizeof(Record), records.size(), out);
+			records.clear();
+		}
+	}
+	fwrite(records.data(), sizeof(Record), records.size(), out);
+	fclose(in);
+
+	header.hostCount = (hostCount != 0) ? hostCount : maxHost + 1;
+	fseek(out, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, out);
+	bool ok = (ferror(out) == 0);
+	fclose(out);
+	if(!ok)
+		std::cerr << "Failed to write " << binFile << std::endl;
+	return ok;
+}
+
+} // namespace ns3
@@ -0,0 +1,101 @@
+#ifndef FLOW_TRACE_H
+#define FLOW_TRACE_H
+
+#include "socket-info.h"
+
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Flows in start time order, consumed by the schedulers
+ */
+class FlowSource : public SimpleRefCount<FlowSource>
+{
+	public:
+		virtual ~FlowSource();
+
+		// False once the source is exhausted
+		virtual bool Peek(FlowInfo& flow) = 0;
+		virtual void Pop() = 0;
+		// A new source that replays the same flows from the start
+		virtual Ptr<FlowSource> Copy() const = 0;
+};
+
+/**
+ * \brief Sequential reader of a flow trace
+ *
+ * "trace/<name>.bin" is mapped into memory when it exists, otherwise the
+ * text trace "trace/<name>.tr" with lines "src dst size start" is parsed a
+ * window of flows at a time. Flow indices start at 1 in trace order.
+ *
+ * The binary file is a Header followed by flowCount records.
+ * All fields are little endian and start times are 64-bit nanoseconds.
+ */
+class FlowTrace : public FlowSource
+{
+	public:
+		static const uint32_t MAGIC = 0x43525446; // "FTRC"
+		static const uint32_t VERSION = 1;
+		static const uint32_t WINDOW = 4096;
+
+		struct Header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t hostCount;
+			uint32_t recordSize;
+			uint64_t flowCount;
+			char workload[40];
+		};
+
+		struct Record
+		{
+			uint64_t start;
+			uint32_t src;
+			uint32_t dst;
+			uint32_t size;
+			uint32_t reserved;
+		};
+
+		FlowTrace(std::string name);
+		~FlowTrace() override;
+
+		bool Peek(FlowInfo& flow) override;
+		void Pop() override;
+		Ptr<FlowSource> Copy() const override;
+
+		uint32_t GetHostCount() const;
+		std::string GetWorkload() const;
+
+		// Text trace to binary, hostCount 0 takes the largest host id plus one
+		static bool Convert(std::string textFile, std::string binFile,
+			std::string workload, uint32_t hostCount = 0);
+
+	private:
+		void Refill();
+
+		std::string m_name;
+		Header m_header;
+		uint64_t m_index{0};
+
+		// Binary trace
+		uint8_t* m_map{nullptr};
+		size_t m_mapSize{0};
+		const Record* m_records{nullptr};
+		uint64_t m_prefetched{0};
+
+		// Text trace
+		FILE* m_file{nullptr};
+		std::vector<FlowInfo> m_window;
+		uint32_t m_cursor{0};
+};
+
+} // namespace ns3
+
+#endif /* FLOW_TRACE_H */
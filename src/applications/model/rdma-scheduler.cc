@@ -22,52 +22,124 @@ RdmaScheduler::GetTypeId()
 
 RdmaScheduler::RdmaScheduler(std::string file, std::string fctFile, uint32_t ipVersion, std::vector<Ptr<PointToPointNetDevice>> nics, 
 					std::vector<Ipv4Address> v4addr, std::vector<Ipv6Address> v6addr)
+	: m_traceName(file)
 {
 	m_ipVersion = ipVersion;
 	m_nics = nics;
 	m_v4addr = v4addr;
 	m_v6addr = v6addr;
-	if((m_file = fopen(("trace/" + file + ".tr").c_str(), "r")) == NULL) {
-		std::cerr << "Failed to open flow file" << std::endl;
-		exit(1);
-	}
-	if((m_fctFile = fopen((fctFile + ".fct").c_str(), "w")) == nullptr){
-		std::cerr << "Failed to open fct file" << std::endl;
+	m_fct = Create<FctCollector>(fctFile);
+}
+
+RdmaScheduler::~RdmaScheduler()
+{
+	if(m_rateFile != nullptr)
+		fclose(m_rateFile);
+}
+
+void
+RdmaScheduler::SetOutput(std::string fctFile)
+{
+	m_fct->SetOutput(fctFile);
+}
+
+Ptr<FctCollector>
+RdmaScheduler::GetFctCollector()
+{
+	return m_fct;
+}
+
+void
+RdmaScheduler::EnableRateTrace(std::string rateFile)
+{
+	if(m_rateFile != nullptr)
+		fclose(m_rateFile);
+	if((m_rateFile = fopen((rateFile + ".rate").c_str(), "w")) == nullptr){
+		std::cerr << "Failed to open rate file" << std::endl;
 		exit(1);
 	}
 }
 
-RdmaScheduler::~RdmaScheduler()
+void
+RdmaScheduler::SetVerbs(RdmaQueuePair::Verb verb, double readRatio)
 {
-	fclose(m_file);
-	fclose(m_fctFile);
+	m_verb = verb;
+	m_readRatio = readRatio;
+	if(m_random == nullptr)
+		m_random = CreateObject<UniformRandomVariable>();
+}
+
+void
+RdmaScheduler::SetFlowSource(Ptr<FlowSource> source)
+{
+	m_source = source;
+}
+
+void
+RdmaScheduler::SetSystemId(uint32_t systemId)
+{
+	m_distributed = true;
+	m_systemId = systemId;
 }
 
 void
 RdmaScheduler::Run()
 {
+	if(m_stopped)
+		return;
+	// Every flow due by now starts in this one event
+	while(m_source->Peek(m_flow) && NanoSeconds(m_flow.start) <= Simulator::Now()){
+		m_source->Pop();
+		StartFlow();
+	}
+	m_starting.clear();
+	Schedule();
+}
+
+void
+RdmaScheduler::StartFlow()
+{
+	// A READ moves the same data, pulled by the destination
+	bool read = (m_readRatio > 0 && m_random->GetValue() < m_readRatio);
+	uint32_t src = read ? m_flow.dst : m_flow.src;
+	if(m_distributed && m_nics[src]->GetNode()->GetSystemId() != m_systemId)
+		return;
+	m_started++;
 	m_fctMp[m_flow.index] = m_flow;
-	auto qp = GetAvailableQP(m_flow.src, m_flow.dst);
+	auto qp = read ? GetAvailableQP(m_flow.dst, m_flow.src) : GetAvailableQP(m_flow.src, m_flow.dst);
 	if(qp == nullptr){
 		std::cerr << "NULL RDMA queue pair " << std::endl;
 		exit(1);
 	}
-	qp->SetFlow(m_flow.index, m_flow.size, &m_fctMp, m_fctFile);
-	Schedule();
+	qp->SetRateFile(m_rateFile);
+	// The queue pair runs in the context of its NIC, which may be another thread
+	m_starting.insert(PeekPointer(qp));
+	Simulator::ScheduleWithContext(m_nics[src]->GetNode()->GetId(), Time(0), &RdmaQueuePair::SetFlow, qp,
+		m_flow.index, m_flow.size, &m_fctMp, PeekPointer(m_fct), read ? RdmaQueuePair::READ : m_verb);
 }
 
 void
 RdmaScheduler::Schedule()
 {
-	char line[100];
-	if (fgets(line, sizeof(line), m_file)) {
-        if (sscanf(line, "%u %u %u %u", &m_flow.src, &m_flow.dst, &m_flow.size, &m_flow.start) == 4) {
-			m_flow.index += 1;
-            if(NanoSeconds(m_flow.start) != Simulator::Now())
-				Simulator::Schedule(NanoSeconds(m_flow.start) - Simulator::Now(), &RdmaScheduler::Run, this);
-			else Run();
-        }
-    }
+	if(m_source == nullptr)
+		m_source = Create<FlowTrace>(m_traceName);
+	if(!m_source->Peek(m_flow))
+		return;
+	if(NanoSeconds(m_flow.start) > Simulator::Now())
+		Simulator::Schedule(NanoSeconds(m_flow.start) - Simulator::Now(), &RdmaScheduler::Run, this);
+	else Run();
+}
+
+void
+RdmaScheduler::StopFlows()
+{
+	m_stopped = true;
+}
+
+uint64_t
+RdmaScheduler::GetInFlight()
+{
+	return m_started - m_fct->GetCompleted();
 }
 
 Ptr<RdmaQueuePair> 
@@ -75,7 +147,7 @@ RdmaScheduler::GetAvailableQP(uint32_t src, uint32_t dst)
 {
 	auto conn = std::make_pair(src, dst);
 	for(auto qp :m_qp[conn]){
-		if(!qp->GetSending()){
+		if(!qp->GetSending() && m_starting.count(PeekPointer(qp)) == 0){
 			return qp;
 		}
 	}
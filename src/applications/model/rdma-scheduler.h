@@ -3,9 +3,15 @@
 
 #include <stdio.h>
 
+#include "fct-collector.h"
+#include "flow-trace.h"
+
 #include "ns3/node.h"
+#include "ns3/random-variable-stream.h"
 #include "ns3/rdma-queue-pair.h"
 
+#include <unordered_set>
+
 namespace ns3
 {
 
@@ -18,11 +24,30 @@ class RdmaScheduler : public Object
 					std::vector<Ipv4Address> v4addr, std::vector<Ipv6Address> v6addr);
 		~RdmaScheduler();
 
+		// Start the FCT file over under another name
+		void SetOutput(std::string fctFile);
+		Ptr<FctCollector> GetFctCollector();
+		void EnableRateTrace(std::string rateFile);
+		// Flows are posted as verb, or as a READ by the receiver with probability readRatio
+		void SetVerbs(RdmaQueuePair::Verb verb, double readRatio);
+
+		// Flows come from the trace file unless another source is set before Schedule
+		void SetFlowSource(Ptr<FlowSource> source);
+		// MPI runs: every rank reads all the flows but only starts those
+		// sent from its own nodes
+		void SetSystemId(uint32_t systemId);
+
 		void Run();
 		void Schedule();
+		// No flow starts from now on, those started run to completion
+		void StopFlows();
+		// Flows started by this rank and not completed yet
+		uint64_t GetInFlight();
 		Ptr<RdmaQueuePair> GetAvailableQP(uint32_t src, uint32_t dst);
 
 	private:
+		void StartFlow();
+
 		uint32_t m_ipVersion{0};
 		uint32_t m_id{10000};
 		std::vector<Ptr<PointToPointNetDevice>> m_nics;
@@ -31,9 +56,20 @@ class RdmaScheduler : public Object
 
 		std::map<std::pair<uint32_t, uint32_t>, std::vector<Ptr<RdmaQueuePair>>> m_qp;
 		std::unordered_map<uint32_t, FlowInfo> m_fctMp;
+		// Given a flow in this Run, SetFlow has not run yet
+		std::unordered_set<RdmaQueuePair*> m_starting;
 
-		FILE* m_file;
-		FILE* m_fctFile;
+		std::string m_traceName;
+		Ptr<FlowSource> m_source;
+		bool m_distributed{false};
+		bool m_stopped{false};
+		uint64_t m_started{0};
+		uint32_t m_systemId{0};
+		Ptr<FctCollector> m_fct;
+		FILE* m_rateFile{nullptr};
+		RdmaQueuePair::Verb m_verb{RdmaQueuePair::SEND};
+		double m_readRatio{0};
+		Ptr<UniformRandomVariable> m_random;
 		FlowInfo m_flow;
 };
 
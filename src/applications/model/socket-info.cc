@@ -8,6 +8,7 @@
 #include "ns3/tcp-socket.h"
 
 #include "socket-info.h"
+#include "fct-collector.h"
 
 namespace ns3
 {
@@ -56,7 +57,18 @@ SocketInfo::Init(){
 
 void 
 SocketInfo::Connect(double delay){
-	Simulator::Schedule(Seconds(delay), &SocketInfo::Init, this);
+	m_connectEvent = Simulator::Schedule(Seconds(delay), &SocketInfo::Init, this);
+}
+
+void
+SocketInfo::Close(){
+	m_connectEvent.Cancel();
+	if(m_socket == nullptr)
+		return;
+	// The socket outlives this object until its FIN handshake is over
+	m_socket->SetSendCallback(MakeNullCallback<void, Ptr<Socket>, uint32_t>());
+	m_socket->Close();
+	m_socket = nullptr;
 }
 
 bool
@@ -64,10 +76,26 @@ SocketInfo::GetSending(){
 	return m_sending;
 }
 
+Time
+SocketInfo::GetLastUse() const{
+	return m_lastUse;
+}
+
+uint16_t
+SocketInfo::GetSrcPort() const{
+	return m_srcPort;
+}
+
 void
 SocketInfo::SetFlow(uint32_t id, uint32_t totalBytes, 
-	std::unordered_map<uint32_t, FlowInfo>* fctMp, FILE* fctFile){
+	std::unordered_map<uint32_t, FlowInfo>* fctMp, FctCollector* fct){
+	// Connect now if the socket was not opened in advance
+	if(m_socket == nullptr){
+		m_connectEvent.Cancel();
+		Init();
+	}
 	m_sending = true;
+	m_lastUse = Simulator::Now();
 	m_id = id;
 	m_bytesSent = 0;
 	m_totalBytes = totalBytes;
@@ -75,19 +103,14 @@ SocketInfo::SetFlow(uint32_t id, uint32_t totalBytes,
 	m_socket->SetSendCallback(MakeCallback(&SocketInfo::SendData, this));
 
 	m_fctMp = fctMp;
-	m_fctFile = fctFile;
+	m_fct = fct;
 }
 
 void 
 SocketInfo::WriteFCT(){
 	if((*m_fctMp)[m_id].end == 0){
 		(*m_fctMp)[m_id].end = Simulator::Now().GetNanoSeconds();
-		fprintf(m_fctFile, "%u,%u,%u,%u,%u,%u,%u\n",
-			(*m_fctMp)[m_id].index, (*m_fctMp)[m_id].src, (*m_fctMp)[m_id].dst,
-			(*m_fctMp)[m_id].size, (*m_fctMp)[m_id].start, (*m_fctMp)[m_id].end,
-			(*m_fctMp)[m_id].end - (*m_fctMp)[m_id].start
-		);
-		fflush(m_fctFile);
+		m_fct->Record((*m_fctMp)[m_id]);
 	}
 }
 
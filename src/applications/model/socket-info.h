@@ -1,23 +1,27 @@
 #ifndef SOCKET_INFO_H
 #define SOCKET_INFO_H
 
+#include "ns3/event-id.h"
 #include "ns3/node.h"
+#include "ns3/nstime.h"
 #include "ns3/socket.h"
 
 namespace ns3
 {
 
+class FctCollector;
+
 struct FlowInfo
 {
 	uint32_t index;
 	uint32_t src;
 	uint32_t dst;
 	uint32_t size;
-	uint32_t start;
-	uint32_t end;
+	uint64_t start; // ns
+	uint64_t end;
 
 	FlowInfo(uint32_t _index = 0, uint32_t _src = 0, uint32_t _dst = 0,
-		uint32_t _size = 0, uint32_t _start = 0, uint32_t _end = 0):
+		uint32_t _size = 0, uint64_t _start = 0, uint64_t _end = 0):
 		index(_index), src(_src), dst(_dst), size(_size), start(_start), end(_end){};
 };
 
@@ -31,10 +35,13 @@ class SocketInfo : public Object
 	
 		void Init();
 		void Connect(double delay);
+		void Close();
 
 		bool GetSending();
+		Time GetLastUse() const;
+		uint16_t GetSrcPort() const;
 		void SetFlow(uint32_t id, uint32_t totalBytes, 
-			std::unordered_map<uint32_t, FlowInfo>* fctMp, FILE* fctFile);
+			std::unordered_map<uint32_t, FlowInfo>* fctMp, FctCollector* fct);
 
 		void SendData(Ptr<Socket>, uint32_t);
 
@@ -44,8 +51,10 @@ class SocketInfo : public Object
 		Address m_dstAddr;
 
 		Ptr<Socket> m_socket;
+		EventId m_connectEvent;
 
-		bool m_sending;
+		bool m_sending{false};
+		Time m_lastUse;
 
 		uint32_t m_id;
 		uint32_t m_bytesSent;
@@ -54,7 +63,7 @@ class SocketInfo : public Object
 
 		Ptr<Packet> m_unsentPacket;
 
-		FILE* m_fctFile;
+		FctCollector* m_fct{nullptr};
 		std::unordered_map<uint32_t, FlowInfo>* m_fctMp{nullptr};
 
 		void WriteFCT();
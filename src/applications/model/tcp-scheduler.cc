@@ -1,9 +1,13 @@
 #include "tcp-scheduler.h"
 
+#include "ns3/inet-socket-address.h"
+#include "ns3/inet6-socket-address.h"
 #include "ns3/node.h"
 #include "ns3/nstime.h"
 #include "ns3/simulator.h"
 
+#include <set>
+
 namespace ns3
 {
 
@@ -20,70 +24,198 @@ TcpScheduler::GetTypeId()
     return tid;
 }
 
-TcpScheduler::TcpScheduler(std::string file, std::string fctFile)
+TcpScheduler::TcpScheduler(std::string file, std::string fctFile, uint32_t ipVersion, std::vector<Ptr<Node>> nodes, 
+					std::vector<Ipv4Address> v4addr, std::vector<Ipv6Address> v6addr, uint16_t dstPort)
+	: m_traceName(file)
 {
-	if((m_file = fopen(("trace/" + file + ".tr").c_str(), "r")) == NULL) {
-		std::cerr << "Failed to open flow file" << std::endl;
-		exit(1);
-	}
-	if((m_fctFile = fopen((fctFile + ".fct").c_str(), "w")) == nullptr){
-		std::cerr << "Failed to open fct file" << std::endl;
-		exit(1);
-	}
+	m_ipVersion = ipVersion;
+	m_nodes = nodes;
+	m_v4addr = v4addr;
+	m_v6addr = v6addr;
+	m_dstPort = dstPort;
+	m_fct = Create<FctCollector>(fctFile);
 }
 
 TcpScheduler::~TcpScheduler()
 {
-	fclose(m_file);
-	fclose(m_fctFile);
-	if(m_sockets)
-		delete m_sockets;
+}
+
+void
+TcpScheduler::SetOutput(std::string fctFile)
+{
+	m_fct->SetOutput(fctFile);
+}
+
+Ptr<FctCollector>
+TcpScheduler::GetFctCollector()
+{
+	return m_fct;
 }
 
 void 
-TcpScheduler::SetSockets(std::map<std::pair<uint32_t, uint32_t>, std::vector<Ptr<SocketInfo>>>* sockets)
+TcpScheduler::SetPoolSize(uint32_t poolSize)
+{
+	m_poolSize = poolSize;
+}
+
+void
+TcpScheduler::Prewarm(double delay)
+{
+	if(m_source == nullptr)
+		m_source = Create<FlowTrace>(m_traceName);
+	Ptr<FlowSource> source = m_source->Copy();
+	std::set<std::pair<uint32_t, uint32_t>> pairs;
+	FlowInfo flow;
+	while(source->Peek(flow)){
+		pairs.insert(std::make_pair(flow.src, flow.dst));
+		source->Pop();
+	}
+
+	for(auto conn : pairs){
+		if(m_distributed && m_nodes[conn.first]->GetSystemId() != m_systemId)
+			continue;
+		if(m_open[conn.first] >= m_poolSize || !m_sockets[conn].empty())
+			continue;
+		OpenSocketInfo(conn.first, conn.second)->Connect(delay);
+		delay += 0.000001;
+	}
+}
+
+void
+TcpScheduler::SetFlowSource(Ptr<FlowSource> source)
+{
+	m_source = source;
+}
+
+void
+TcpScheduler::SetSystemId(uint32_t systemId)
 {
-	m_sockets = sockets;
+	m_distributed = true;
+	m_systemId = systemId;
 }
 
 void
 TcpScheduler::Run()
 {
+	if(m_stopped)
+		return;
+	// Every flow due by now starts in this one event
+	while(m_source->Peek(m_flow) && NanoSeconds(m_flow.start) <= Simulator::Now()){
+		m_source->Pop();
+		StartFlow();
+	}
+	m_starting.clear();
+	Schedule();
+}
+
+void
+TcpScheduler::StartFlow()
+{
+	if(m_distributed && m_nodes[m_flow.src]->GetSystemId() != m_systemId)
+		return;
+	m_started++;
 	m_fctMp[m_flow.index] = m_flow;
 	auto socket = GetAvailableSocketInfo(m_flow.src, m_flow.dst);
 	if(socket == nullptr){
 		std::cerr << "NULL socket " << std::endl;
 		exit(1);
 	}
-	socket->SetFlow(m_flow.index, m_flow.size, &m_fctMp, m_fctFile);
-	socket->SendData(nullptr, m_flow.size);
-	Schedule();
+	// The socket runs in the context of its node, which may be another thread
+	m_starting.insert(PeekPointer(socket));
+	uint32_t context = m_nodes[m_flow.src]->GetId();
+	Simulator::ScheduleWithContext(context, Time(0), &SocketInfo::SetFlow, socket,
+		m_flow.index, m_flow.size, &m_fctMp, PeekPointer(m_fct));
+	Simulator::ScheduleWithContext(context, Time(0), &SocketInfo::SendData, socket, Ptr<Socket>(), m_flow.size);
 }
 
 void
 TcpScheduler::Schedule()
 {
-	char line[100];
-	if (fgets(line, sizeof(line), m_file)) {
-        if (sscanf(line, "%u %u %u %u", &m_flow.src, &m_flow.dst, &m_flow.size, &m_flow.start) == 4) {
-			m_flow.index += 1;
-            if(NanoSeconds(m_flow.start) != Simulator::Now())
-				Simulator::Schedule(NanoSeconds(m_flow.start) - Simulator::Now(), &TcpScheduler::Run, this);
-			else Run();
-        }
-    }
+	if(m_source == nullptr)
+		m_source = Create<FlowTrace>(m_traceName);
+	if(!m_source->Peek(m_flow))
+		return;
+	if(NanoSeconds(m_flow.start) > Simulator::Now())
+		Simulator::Schedule(NanoSeconds(m_flow.start) - Simulator::Now(), &TcpScheduler::Run, this);
+	else Run();
+}
+
+void
+TcpScheduler::StopFlows()
+{
+	m_stopped = true;
+}
+
+uint64_t
+TcpScheduler::GetInFlight()
+{
+	return m_started - m_fct->GetCompleted();
 }
 
 Ptr<SocketInfo> 
 TcpScheduler::GetAvailableSocketInfo(uint32_t src, uint32_t dst)
 {
-	for(auto socketInfo :(*m_sockets)[std::make_pair(src, dst)]){
-		if(!socketInfo->GetSending()){
+	for(auto socketInfo : m_sockets[std::make_pair(src, dst)]){
+		if(!socketInfo->GetSending() && m_starting.count(PeekPointer(socketInfo)) == 0){
 			return socketInfo;
 		}
 	}
-	std::cerr << "No available socket. NUM_SOCKET is too small for src " << src << " dst " << dst << std::endl;
-	exit(1);
+	if(m_open[src] >= m_poolSize)
+		CloseIdleSocketInfo(src);
+	return OpenSocketInfo(src, dst);
+}
+
+Ptr<SocketInfo>
+TcpScheduler::OpenSocketInfo(uint32_t src, uint32_t dst)
+{
+	// Ports go round 10000-65535 past those of open connections, a closed
+	// one is long out of TIME_WAIT when it comes round again
+	uint16_t& port = m_nextPort[src];
+	std::unordered_set<uint16_t>& ports = m_ports[src];
+	if(ports.size() >= 65536 - 10000){
+		std::cerr << "No free port in node " << src << std::endl;
+		exit(1);
+	}
+	if(port < 10000)
+		port = 10000;
+	while(ports.count(port) != 0)
+		port = (port == 65535) ? 10000 : port + 1;
+	ports.insert(port);
+	Ptr<SocketInfo> ret;
+	if(m_ipVersion == 0)
+		ret = Create<SocketInfo>(m_nodes[src], port, InetSocketAddress(m_v4addr[dst], m_dstPort));
+	else
+		ret = Create<SocketInfo>(m_nodes[src], port, Inet6SocketAddress(m_v6addr[dst], m_dstPort));
+	port = (port == 65535) ? 10000 : port + 1;
+	m_sockets[std::make_pair(src, dst)].push_back(ret);
+	m_open[src] += 1;
+	return ret;
+}
+
+void
+TcpScheduler::CloseIdleSocketInfo(uint32_t src)
+{
+	// Pairs of one source are adjacent in the map
+	auto lru = m_sockets.end();
+	uint32_t index = 0;
+	for(auto it = m_sockets.lower_bound(std::make_pair(src, 0u)); 
+			it != m_sockets.end() && it->first.first == src; ++it){
+		for(uint32_t i = 0; i < it->second.size(); ++i){
+			auto socketInfo = it->second[i];
+			if(socketInfo->GetSending() || m_starting.count(PeekPointer(socketInfo)) != 0)
+				continue;
+			if(lru == m_sockets.end() || socketInfo->GetLastUse() < lru->second[index]->GetLastUse()){
+				lru = it;
+				index = i;
+			}
+		}
+	}
+	if(lru == m_sockets.end())
+		return;
+	lru->second[index]->Close();
+	m_ports[src].erase(lru->second[index]->GetSrcPort());
+	lru->second.erase(lru->second.begin() + index);
+	m_open[src] -= 1;
 }
 
 } // namespace ns3
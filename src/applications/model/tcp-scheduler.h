@@ -3,34 +3,87 @@
 
 #include <stdio.h>
 
+#include "fct-collector.h"
+#include "flow-trace.h"
 #include "socket-info.h"
 
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
 #include "ns3/node.h"
 
+#include <unordered_set>
+
 namespace ns3
 {
 
+/**
+ * \brief Replays a flow trace over TCP connections opened on demand
+ *
+ * A flow reuses an idle connection of its (src, dst) pair, otherwise a new
+ * one is opened when the flow starts so the handshake counts in its FCT.
+ * Each source keeps at most poolSize connections, the least recently used
+ * idle one is closed to make room. The bound is soft: flows never wait,
+ * so a source with more concurrent flows than poolSize grows past it.
+ */
 class TcpScheduler : public Object
 {
 	public:
 		static TypeId GetTypeId();
 
-    	TcpScheduler(std::string file, std::string fctFile);
+    	TcpScheduler(std::string file, std::string fctFile, uint32_t ipVersion, std::vector<Ptr<Node>> nodes, 
+					std::vector<Ipv4Address> v4addr, std::vector<Ipv6Address> v6addr, uint16_t dstPort);
 		~TcpScheduler();
 
-		void SetSockets(std::map<std::pair<uint32_t, uint32_t>, std::vector<Ptr<SocketInfo>>>* sockets);
+		// Write the FCTs to another file, as a run restored from a checkpoint does
+		void SetOutput(std::string fctFile);
+		Ptr<FctCollector> GetFctCollector();
+		void SetPoolSize(uint32_t poolSize);
+		// Connect one socket for every pair in the trace, spaced by 1us from delay
+		void Prewarm(double delay);
+
+		// Flows come from the trace file unless another source is set before Schedule
+		void SetFlowSource(Ptr<FlowSource> source);
+		// MPI runs: every rank reads all the flows but only starts those
+		// sent from its own nodes
+		void SetSystemId(uint32_t systemId);
 
 		void Run();
 		void Schedule();
+		// No flow starts from now on, those started run to completion
+		void StopFlows();
+		// Flows started by this rank and not completed yet
+		uint64_t GetInFlight();
 		Ptr<SocketInfo> GetAvailableSocketInfo(uint32_t src, uint32_t dst);
 
 	private:
-		std::map<std::pair<uint32_t, uint32_t>, std::vector<Ptr<SocketInfo>>>* m_sockets{nullptr};
+		void StartFlow();
+		Ptr<SocketInfo> OpenSocketInfo(uint32_t src, uint32_t dst);
+		void CloseIdleSocketInfo(uint32_t src);
+
+		uint32_t m_ipVersion{0};
+		uint16_t m_dstPort{0};
+		std::vector<Ptr<Node>> m_nodes;
+		std::vector<Ipv4Address> m_v4addr;
+		std::vector<Ipv6Address> m_v6addr;
+
+		uint32_t m_poolSize{64};
+		std::map<std::pair<uint32_t, uint32_t>, std::vector<Ptr<SocketInfo>>> m_sockets;
+		std::unordered_map<uint32_t, uint32_t> m_open;
+		std::unordered_map<uint32_t, uint16_t> m_nextPort;
+		// Ports of the open connections of each source
+		std::unordered_map<uint32_t, std::unordered_set<uint16_t>> m_ports;
 
 		std::unordered_map<uint32_t, FlowInfo> m_fctMp;
+		// Given a flow in this Run, SetFlow has not run yet
+		std::unordered_set<SocketInfo*> m_starting;
 
-		FILE* m_file;
-		FILE* m_fctFile;
+		std::string m_traceName;
+		Ptr<FlowSource> m_source;
+		bool m_distributed{false};
+		bool m_stopped{false};
+		uint64_t m_started{0};
+		uint32_t m_systemId{0};
+		Ptr<FctCollector> m_fct;
 		FlowInfo m_flow;
 };
 
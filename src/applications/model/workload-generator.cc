@@ -0,0 +1,285 @@
+#include "workload-generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace ns3
+{
+
+bool
+FlowSizeCdf::Load(std::string file)
+{
+	std::ifstream in(file);
+	if(!in){
+		std::cerr << "Failed to open cdf file " << file << std::endl;
+		return false;
+	}
+	m_cdf.clear();
+	double x, y;
+	while(in >> x >> y)
+		m_cdf.emplace_back(x, y);
+
+	if(m_cdf.size() < 2 || m_cdf.front().second != 0){
+		std::cerr << "Not valid cdf " << file << std::endl;
+		return false;
+	}
+	// Some files are in percent
+	double scale = m_cdf.back().second;
+	for(uint32_t i = 0; i < m_cdf.size(); ++i){
+		m_cdf[i].second /= scale;
+		if(i > 0 && (m_cdf[i].first <= m_cdf[i - 1].first || m_cdf[i].second <= m_cdf[i - 1].second)){
+			std::cerr << "Not valid cdf " << file << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+double
+FlowSizeCdf::Sample(double u) const
+{
+	uint32_t low = 1, high = m_cdf.size() - 1;
+	while(low < high){
+		uint32_t mid = (low + high) / 2;
+		if(m_cdf[mid].second > u)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	auto& p0 = m_cdf[low - 1];
+	auto& p1 = m_cdf[low];
+	return p0.first + (p1.first - p0.first) / (p1.second - p0.second) * (u - p0.second);
+}
+
+double
+FlowSizeCdf::GetAverage() const
+{
+	double sum = 0;
+	for(uint32_t i = 1; i < m_cdf.size(); ++i)
+		sum += (m_cdf[i].first + m_cdf[i - 1].first) / 2.0 * (m_cdf[i].second - m_cdf[i - 1].second);
+	return sum;
+}
+
+WorkloadGenerator::WorkloadGenerator(const Config& config)
+	: m_config(config)
+{
+	if(m_config.hostCount < 2){
+		std::cerr << "Workload needs at least two hosts" << std::endl;
+		exit(1);
+	}
+	// Host 0 is the incast receiver, the background needs two more
+	if(m_config.pattern == INCAST && m_config.hostCount < 3){
+		std::cerr << "Incast workload needs at least three hosts" << std::endl;
+		exit(1);
+	}
+	m_background.random = CreateObject<UniformRandomVariable>();
+	m_background.random->SetStream(m_config.stream);
+	m_incast.random = CreateObject<UniformRandomVariable>();
+	m_incast.random->SetStream(m_config.stream + 1);
+
+	double bytes = m_config.bandwidth / 8.0 / 1e9; // per ns
+	if(m_config.pattern == ML_RING || m_config.pattern == ML_ALLTOALL){
+		m_config.groupSize = std::max<uint32_t>(m_config.groupSize, 2);
+		m_background.interArrival = (m_config.mlSize + 0.5) / (bytes * m_config.load);
+		InitMl();
+		NextMl();
+		return;
+	}
+
+	if(!m_cdf.Load(m_config.cdfFile))
+		exit(1);
+	double avg = m_cdf.GetAverage();
+	m_background.interArrival = avg / (bytes * m_config.load) / m_config.hostCount;
+	m_background.time = m_config.start;
+	NextPoisson();
+
+	if(m_config.pattern == INCAST){
+		m_incast.interArrival = avg / (bytes * m_config.oversubscription * 0.95);
+		m_incast.time = m_config.start;
+		// Fan-in from a random subset of the hosts other than 0
+		std::vector<uint32_t> hosts;
+		for(uint32_t i = 1; i < m_config.hostCount; ++i)
+			hosts.push_back(i);
+		for(uint32_t i = hosts.size() - 1; i > 0; --i)
+			std::swap(hosts[i], hosts[m_incast.random->GetInteger(0, i)]);
+		hosts.resize(std::max<uint32_t>(1, std::min<uint32_t>(m_config.incastDegree, hosts.size())));
+		m_incastSources = hosts;
+		NextIncast();
+	}
+}
+
+WorkloadGenerator::~WorkloadGenerator()
+{
+}
+
+uint64_t
+WorkloadGenerator::Exponential(Stream& stream)
+{
+	double gap = -std::log(1 - stream.random->GetValue()) * stream.interArrival;
+	return std::max<uint64_t>(1, gap);
+}
+
+uint32_t
+WorkloadGenerator::SampleSize(Stream& stream)
+{
+	return std::max<uint32_t>(1, m_cdf.Sample(stream.random->GetValue()));
+}
+
+void
+WorkloadGenerator::NextPoisson()
+{
+	Stream& s = m_background;
+	s.time += Exponential(s);
+	s.valid = (s.time <= m_config.start + m_config.duration);
+	if(!s.valid)
+		return;
+	// Host 0 only receives incast traffic
+	uint32_t low = (m_config.pattern == INCAST) ? 1 : 0;
+	uint32_t high = m_config.hostCount - 1;
+	uint32_t src = s.random->GetInteger(low, high);
+	uint32_t dst = s.random->GetInteger(low, high);
+	while(dst == src)
+		dst = s.random->GetInteger(low, high);
+	s.flow = FlowInfo(0, src, dst, SampleSize(s), s.time);
+}
+
+void
+WorkloadGenerator::NextIncast()
+{
+	Stream& s = m_incast;
+	s.time += Exponential(s);
+	s.valid = (s.time <= m_config.start + m_config.duration);
+	if(!s.valid)
+		return;
+	uint32_t src = m_incastSources[m_incastNext % m_incastSources.size()];
+	m_incastNext += 1;
+	s.flow = FlowInfo(0, src, 0, SampleSize(s), s.time);
+}
+
+void
+WorkloadGenerator::InitMl()
+{
+	uint32_t n = m_config.hostCount;
+	for(uint32_t i = 0; i < n; ++i)
+		m_hosts.push_back(i);
+	for(uint32_t i = n - 1; i > 0; --i)
+		std::swap(m_hosts[i], m_hosts[m_background.random->GetInteger(0, i)]);
+
+	// Groups start within one period of each other so rounds never overlap
+	uint64_t period = std::max<uint64_t>(1, m_background.interArrival);
+	m_groupStart.resize((n + m_config.groupSize - 1) / m_config.groupSize);
+	for(auto& start : m_groupStart){
+		uint64_t gap;
+		do{
+			gap = Exponential(m_background);
+		} while(gap > period);
+		start = m_config.start + gap;
+	}
+	std::sort(m_groupStart.begin(), m_groupStart.end());
+	m_mlHost = 0;
+	m_mlPeer = 0;
+}
+
+void
+WorkloadGenerator::NextMl()
+{
+	uint32_t n = m_config.hostCount;
+	uint32_t g = m_config.groupSize;
+	m_background.valid = false;
+	while(!m_mlDone){
+		if(m_mlHost >= n){
+			uint64_t period = std::max<uint64_t>(1, m_background.interArrival);
+			for(auto& start : m_groupStart){
+				start += period;
+				if(start > m_config.start + m_config.duration)
+					m_mlDone = true;
+			}
+			m_mlHost = 0;
+			m_mlPeer = 0;
+			continue;
+		}
+
+		uint32_t i = m_mlHost;
+		uint32_t base = i / g * g;
+		uint32_t members = std::min(n, base + g) - base;
+		uint32_t dst;
+		uint32_t size = m_config.mlSize;
+		if(m_config.pattern == ML_RING){
+			dst = (i % g == g - 1 || i == n - 1) ? base : i + 1;
+			m_mlHost += 1;
+		}
+		else{
+			if(m_mlPeer >= members){
+				m_mlHost += 1;
+				m_mlPeer = 0;
+				continue;
+			}
+			dst = base + m_mlPeer;
+			m_mlPeer += 1;
+			size = std::max<uint32_t>(1, m_config.mlSize / std::max<uint32_t>(1, members - 1));
+		}
+		if(dst == i)
+			continue;
+		m_background.flow = FlowInfo(0, m_hosts[i], m_hosts[dst], size, m_groupStart[i / g]);
+		m_background.valid = true;
+		return;
+	}
+}
+
+bool
+WorkloadGenerator::Peek(FlowInfo& flow)
+{
+	// Ties go to the background stream
+	Stream* s = &m_background;
+	if(m_incast.valid && (!s->valid || m_incast.time < s->time))
+		s = &m_incast;
+	if(!s->valid)
+		return false;
+	flow = s->flow;
+	flow.index = m_index + 1;
+	return true;
+}
+
+void
+WorkloadGenerator::Pop()
+{
+	if(!m_background.valid && !m_incast.valid)
+		return;
+	m_index += 1;
+	if(m_incast.valid && (!m_background.valid || m_incast.time < m_background.time))
+		NextIncast();
+	else if(m_config.pattern == ML_RING || m_config.pattern == ML_ALLTOALL)
+		NextMl();
+	else
+		NextPoisson();
+}
+
+Ptr<FlowSource>
+WorkloadGenerator::Copy() const
+{
+	return Create<WorkloadGenerator>(m_config);
+}
+
+uint64_t
+WorkloadGenerator::Dump(std::string textFile)
+{
+	FILE* file = fopen(textFile.c_str(), "w");
+	if(file == nullptr){
+		std::cerr << "Failed to open " << textFile << std::endl;
+		exit(1);
+	}
+	uint64_t count = 0;
+	Ptr<FlowSource> source = Copy();
+	FlowInfo flow;
+	while(source->Peek(flow)){
+		fprintf(file, "%u %u %u %lu\n", flow.src, flow.dst, flow.size, flow.start);
+		source->Pop();
+		count += 1;
+	}
+	fclose(file);
+	return count;
+}
+
+} // namespace ns3
@@ -0,0 +1,120 @@
+#ifndef WORKLOAD_GENERATOR_H
+#define WORKLOAD_GENERATOR_H
+
+#include "flow-trace.h"
+
+#include "ns3/random-variable-stream.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Flow size distribution read from a traffic_cdf file
+ *
+ * Lines are "size cdf" with the cdf rising from 0 to 1 (or to 100).
+ * Sizes are drawn by inverse transform with linear interpolation.
+ */
+class FlowSizeCdf
+{
+	public:
+		bool Load(std::string file);
+
+		double Sample(double u) const;
+		double GetAverage() const;
+
+	private:
+		std::vector<std::pair<double, double>> m_cdf;
+};
+
+/**
+ * \brief Flows generated on the fly, replacing the traffic_gen.py,
+ * incast_gen.py and ML_gen.py traces
+ *
+ * POISSON:     random pairs, sizes from the CDF, Poisson arrivals per host
+ * INCAST:      POISSON among hosts 1..N-1 plus fan-in from incastDegree
+ *              random hosts to host 0 at oversubscription * link rate
+ * ML_RING:     hosts in random groups of groupSize, each sends mlSize to the
+ *              next one in its group every round
+ * ML_ALLTOALL: as ML_RING, each host spreads mlSize over all of its group
+ *
+ * Only the next flow of each stream is kept. The same configuration and
+ * RNG run always give the same flows, Dump writes them as a .tr trace.
+ */
+class WorkloadGenerator : public FlowSource
+{
+	public:
+		enum Pattern
+		{
+			POISSON,
+			INCAST,
+			ML_RING,
+			ML_ALLTOALL,
+		};
+
+		struct Config
+		{
+			Pattern pattern{POISSON};
+			std::string cdfFile;
+			uint32_t hostCount{0};
+			double load{0.5};
+			double bandwidth{25e9};       // bps of a host link
+			uint64_t start{2000000000};   // ns
+			uint64_t duration{500000000}; // ns
+			uint32_t incastDegree{16};
+			double oversubscription{4};
+			uint32_t mlSize{10000000};
+			uint32_t groupSize{8};
+			int64_t stream{0};            // first RNG stream, two are used
+		};
+
+		WorkloadGenerator(const Config& config);
+		~WorkloadGenerator() override;
+
+		bool Peek(FlowInfo& flow) override;
+		void Pop() override;
+		Ptr<FlowSource> Copy() const override;
+
+		// Writes every flow to textFile, returns the number of flows
+		uint64_t Dump(std::string textFile);
+
+	private:
+		struct Stream
+		{
+			Ptr<UniformRandomVariable> random;
+			double interArrival{0}; // mean, ns
+			uint64_t time{0};
+			bool valid{false};
+			FlowInfo flow;
+		};
+
+		uint64_t Exponential(Stream& stream);
+		uint32_t SampleSize(Stream& stream);
+
+		void NextPoisson();
+		void NextIncast();
+		void NextMl();
+		void InitMl();
+
+		Config m_config;
+		FlowSizeCdf m_cdf;
+		uint32_t m_index{0};
+
+		Stream m_background;
+		Stream m_incast;
+		std::vector<uint32_t> m_incastSources;
+		uint32_t m_incastNext{0};
+
+		// ML rounds, m_hosts is the shuffled host order
+		std::vector<uint32_t> m_hosts;
+		std::vector<uint64_t> m_groupStart;
+		uint32_t m_mlHost{0};
+		uint32_t m_mlPeer{0};
+		bool m_mlDone{false};
+};
+
+} // namespace ns3
+
+#endif /* WORKLOAD_GENERATOR_H */
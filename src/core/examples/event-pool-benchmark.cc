@@ -0,0 +1,180 @@
+#include "ns3/command-line.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object-factory.h"
+#include "ns3/pool-allocator.h"
+#include "ns3/simulator.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup core-examples
+ * Heap allocations per event on a transmit-and-deliver event pattern.
+ *
+ * Every port sends a packet per serialization delay: the transmit-complete
+ * event schedules the next one, a delivery one propagation delay later and
+ * a retransmission timer that the delivery cancels. Run it with a build
+ * with and without NS3_POOL_ALLOCATOR, and with each scheduler, e.g.
+ *
+ *     ./ns3 run "event-pool-benchmark --scheduler=ns3::CalendarScheduler"
+ */
+
+using namespace ns3;
+
+/** Calls to the global operator new. */
+static uint64_t g_heapAllocations = 0;
+
+void*
+operator new(std::size_t size)
+{
+    g_heapAllocations++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+/**
+ * \ingroup core-examples
+ * A port sending back-to-back packets.
+ */
+class Port
+{
+  public:
+    /**
+     * \param index the port index
+     * \param serialization time to send one packet
+     * \param propagation delay of the link
+     * \param packets packets to send
+     */
+    Port(uint32_t index, Time serialization, Time propagation, uint32_t packets)
+        : m_index(index),
+          m_serialization(serialization),
+          m_propagation(propagation),
+          m_left(packets)
+    {
+    }
+
+    /** Start sending, with an offset so that the ports are not in lockstep. */
+    void Start()
+    {
+        Simulator::Schedule(NanoSeconds(m_index), &Port::TransmitComplete, this);
+    }
+
+    /** \returns the number of packets delivered */
+    uint64_t GetDelivered() const
+    {
+        return m_delivered;
+    }
+
+  private:
+    /** The last packet is on the wire: deliver it and send the next. */
+    void TransmitComplete()
+    {
+        EventId timer = Simulator::Schedule(m_propagation * 10, &Port::Timeout, this);
+        Simulator::Schedule(m_propagation, &Port::Deliver, this, timer);
+        if (--m_left > 0)
+        {
+            Simulator::Schedule(m_serialization, &Port::TransmitComplete, this);
+        }
+    }
+
+    /**
+     * \param timer the retransmission timer of the packet
+     */
+    void Deliver(EventId timer)
+    {
+        timer.Cancel();
+        m_delivered++;
+    }
+
+    /** Never runs, the packets are never lost. */
+    void Timeout()
+    {
+        std::cerr << "Timeout on port " << m_index << std::endl;
+    }
+
+    uint32_t m_index;        //!< Port index
+    Time m_serialization;    //!< Time to send one packet
+    Time m_propagation;      //!< Delay of the link
+    uint32_t m_left;         //!< Packets still to send
+    uint64_t m_delivered{0}; //!< Packets delivered
+};
+
+int
+main(int argc, char* argv[])
+{
+    std::string scheduler = "ns3::MapScheduler";
+    uint32_t ports = 512;
+    uint32_t packets = 2000;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("scheduler", "Event scheduler type", scheduler);
+    cmd.AddValue("ports", "Number of sending ports", ports);
+    cmd.AddValue("packets", "Packets sent by each port", packets);
+    cmd.Parse(argc, argv);
+
+    ObjectFactory factory;
+    factory.SetTypeId(scheduler);
+    Simulator::SetScheduler(factory);
+
+    std::vector<Port*> all;
+    for (uint32_t i = 0; i < ports; ++i)
+    {
+        all.push_back(new Port(i, NanoSeconds(320), MicroSeconds(1), packets));
+        all.back()->Start();
+    }
+
+    uint64_t heapBefore = g_heapAllocations;
+    PoolAllocator::Stats poolBefore = PoolAllocator::GetStats();
+    auto start = std::chrono::steady_clock::now();
+    Simulator::Run();
+    double ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    uint64_t heap = g_heapAllocations - heapBefore;
+    PoolAllocator::Stats pool = PoolAllocator::GetStats();
+
+    uint64_t delivered = 0;
+    for (Port* port : all)
+    {
+        delivered += port->GetDelivered();
+        delete port;
+    }
+    // Transmit complete, delivery and timer per packet
+    double events = 3.0 * ports * packets;
+    Simulator::Destroy();
+
+    std::cout << "Scheduler      : " << scheduler << std::endl;
+    std::cout << "Pool allocator : " << (PoolAllocator::IsEnabled() ? "on" : "off") << std::endl;
+    std::cout << "Heap allocs    : " << heap / events << " per event" << std::endl;
+    std::cout << "Pool allocs    : " << (pool.allocations - poolBefore.allocations) / events
+              << " per event, " << (pool.heap - poolBefore.heap) / events << " from the heap"
+              << std::endl;
+    std::cout << "Run time       : " << ns / events << " ns/event" << std::endl;
+    if (delivered != uint64_t(ports) * packets)
+    {
+        std::cout << "Lost packets" << std::endl;
+        return 1;
+    }
+    return 0;
+}
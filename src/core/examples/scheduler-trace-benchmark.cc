@@ -0,0 +1,216 @@
+#include "ns3/command-line.h"
+#include "ns3/object-factory.h"
+#include "ns3/ptr.h"
+#include "ns3/scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup core-examples
+ * Replay an event timestamp trace through the schedulers.
+ *
+ * The trace is the JSON file written by DesMetrics (configure with
+ * --enable-des-metrics), one record per scheduled event with the time it
+ * was scheduled at and the time it runs at. Every event scheduled at time
+ * t is inserted after the events before t are removed, as in the run it
+ * was captured from. Without a trace, one is generated with the shape of
+ * a datacenter run: back-to-back packets of about 100ns on every port,
+ * deliveries 1us later, 1ns PFC events and retransmission timers, and the
+ * end of the run scheduled far ahead at the start, as Simulator::Stop is.
+ *
+ *     ./ns3 run "scheduler-trace-benchmark --trace=header-compress.json"
+ */
+
+using namespace ns3;
+
+/** An event of the trace. */
+struct Record
+{
+    uint64_t now; //!< Time it was scheduled at
+    uint64_t ts;  //!< Time it runs at
+};
+
+/**
+ * \param file a DesMetrics JSON file
+ * \param records the events of the trace, in scheduling order
+ * \returns false if the file cannot be read
+ */
+static bool
+ReadTrace(std::string file, std::vector<Record>& records)
+{
+    FILE* in = fopen(file.c_str(), "r");
+    if (in == nullptr)
+    {
+        std::cerr << "Failed to open " << file << std::endl;
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), in) != nullptr)
+    {
+        int send;
+        int recv;
+        unsigned long long now;
+        unsigned long long ts;
+        if (sscanf(line, " [\"%d\",\"%llu\",\"%d\",\"%llu\"]", &send, &now, &recv, &ts) == 4)
+        {
+            records.push_back({now, ts});
+        }
+    }
+    fclose(in);
+    // Only the events of a single thread are in order
+    std::stable_sort(records.begin(), records.end(), [](const Record& a, const Record& b) {
+        return a.now < b.now;
+    });
+    return true;
+}
+
+/**
+ * Generate the events of ports sending packets back to back.
+ * \param ports the number of ports
+ * \param duration the simulated time, in ns
+ * \param records the generated events, in scheduling order
+ */
+static void
+Generate(uint32_t ports, uint64_t duration, std::vector<Record>& records)
+{
+    enum Kind
+    {
+        TRANSMIT,
+        DELIVER,
+        PFC,
+        TIMER,
+    };
+
+    // The end of the run, pending the whole time
+    records.push_back({0, duration * 1000});
+
+    std::mt19937_64 rng(1);
+    // Packets of 1000 to 1500 bytes at 100Gbps
+    std::uniform_int_distribution<uint64_t> serialization(80, 120);
+    std::uniform_int_distribution<uint32_t> percent(0, 99);
+    typedef std::pair<uint64_t, uint32_t> Item; // ts, port * 4 + kind
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+    auto schedule = [&](uint64_t now, uint64_t delay, uint32_t port, Kind kind) {
+        records.push_back({now, now + delay});
+        queue.push({now + delay, port * 4 + kind});
+    };
+
+    for (uint32_t p = 0; p < ports; ++p)
+    {
+        schedule(0, p, p, TRANSMIT);
+    }
+    while (!queue.empty())
+    {
+        Item item = queue.top();
+        queue.pop();
+        uint64_t now = item.first;
+        uint32_t port = item.second / 4;
+        if (item.second % 4 == TRANSMIT && now < duration)
+        {
+            schedule(now, serialization(rng), port, TRANSMIT);
+            schedule(now, 1000, port, DELIVER);
+            if (percent(rng) < 10)
+            {
+                schedule(now, 100000, port, TIMER);
+            }
+        }
+        else if (item.second % 4 == DELIVER && percent(rng) < 2)
+        {
+            schedule(now, 1, port, PFC);
+        }
+    }
+}
+
+/**
+ * Replay a trace.
+ * \param type the scheduler type
+ * \param records the events of the trace
+ * \param order set to a hash of the dequeue order
+ * \returns the run time in ns
+ */
+static double
+Replay(std::string type, const std::vector<Record>& records, uint64_t& order)
+{
+    ObjectFactory factory;
+    factory.SetTypeId(type);
+    Ptr<Scheduler> scheduler = factory.Create<Scheduler>();
+
+    order = 0;
+    uint32_t uid = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const Record& r : records)
+    {
+        while (!scheduler->IsEmpty() && scheduler->PeekNext().key.m_ts < r.now)
+        {
+            order = order * 31 + scheduler->RemoveNext().key.m_uid;
+        }
+        Scheduler::Event ev;
+        ev.impl = nullptr;
+        ev.key.m_ts = r.ts;
+        ev.key.m_uid = uid++;
+        ev.key.m_context = 0;
+        scheduler->Insert(ev);
+    }
+    while (!scheduler->IsEmpty())
+    {
+        order = order * 31 + scheduler->RemoveNext().key.m_uid;
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string trace;
+    std::string types =
+        "ns3::MapScheduler,ns3::HeapScheduler,ns3::CalendarScheduler,ns3::LadderScheduler";
+    uint32_t ports = 2048;
+    uint64_t duration = 200000;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("trace", "DesMetrics JSON trace, generated if empty", trace);
+    cmd.AddValue("schedulers", "Comma separated scheduler types", types);
+    cmd.AddValue("ports", "Ports of the generated trace", ports);
+    cmd.AddValue("duration", "Length of the generated trace, in ns", duration);
+    cmd.Parse(argc, argv);
+
+    std::vector<Record> records;
+    if (trace.empty())
+    {
+        Generate(ports, duration, records);
+    }
+    else if (!ReadTrace(trace, records))
+    {
+        return 1;
+    }
+    std::cout << records.size() << " events" << std::endl;
+
+    std::istringstream list(types);
+    std::string type;
+    uint64_t reference = 0;
+    bool first = true;
+    while (std::getline(list, type, ','))
+    {
+        uint64_t order;
+        double ns = Replay(type, records, order);
+        std::cout << type << " : " << ns / records.size() << " ns/event" << std::endl;
+        if (!first && order != reference)
+        {
+            std::cout << type << " dequeues in a different order" << std::endl;
+            return 1;
+        }
+        reference = order;
+        first = false;
+    }
+    return 0;
+}
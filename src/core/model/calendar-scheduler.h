@@ -21,6 +21,7 @@
 #ifndef CALENDAR_SCHEDULER_H
 #define CALENDAR_SCHEDULER_H
 
+#include "pool-allocator.h"
 #include "scheduler.h"
 
 #include <list>
@@ -165,8 +166,8 @@ class CalendarScheduler : public Scheduler
      */
     void DoInsert(const Scheduler::Event& ev);
 
-    /** Calendar bucket type: a list of Events. */
-    typedef std::list<Scheduler::Event> Bucket;
+    /** Calendar bucket type: a list of Events, with pooled nodes. */
+    typedef std::list<Scheduler::Event, PoolStlAllocator<Scheduler::Event>> Bucket;
 
     /** Array of buckets. */
     Bucket* m_buckets;
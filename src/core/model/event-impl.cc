@@ -20,6 +20,7 @@
 #include "event-impl.h"
 
 #include "log.h"
+#include "pool-allocator.h"
 
 /**
  * \file
@@ -67,4 +68,16 @@ EventImpl::IsCancelled()
     return m_cancel;
 }
 
+void*
+EventImpl::operator new(std::size_t size)
+{
+    return PoolAllocator::Allocate(size);
+}
+
+void
+EventImpl::operator delete(void* p, std::size_t size)
+{
+    PoolAllocator::Free(p, size);
+}
+
 } // namespace ns3
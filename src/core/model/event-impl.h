@@ -21,6 +21,7 @@
 
 #include "simple-ref-count.h"
 
+#include <cstddef>
 #include <stdint.h>
 
 /**
@@ -67,6 +68,18 @@ class EventImpl : public SimpleRefCount<EventImpl>
      */
     bool IsCancelled();
 
+    /**
+     * Events are allocated from the PoolAllocator freelists.
+     * \param [in] size The size of the event.
+     * \returns Storage for the event.
+     */
+    static void* operator new(std::size_t size);
+    /**
+     * \param [in] p Storage returned by operator new.
+     * \param [in] size The size of the event.
+     */
+    static void operator delete(void* p, std::size_t size);
+
   protected:
     /**
      * Implementation for Invoke().
@@ -0,0 +1,307 @@
+#include "ladder-scheduler.h"
+
+#include "assert.h"
+#include "event-impl.h"
+#include "log.h"
+#include "uinteger.h"
+
+#include <algorithm>
+#include <limits>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * ns3::LadderScheduler implementation.
+ */
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("LadderScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED(LadderScheduler);
+
+namespace
+{
+
+/**
+ * Order of Bottom, the earliest event last.
+ * \param a an event
+ * \param b another event
+ * \returns true if a comes after b
+ */
+bool
+Later(const Scheduler::Event& a, const Scheduler::Event& b)
+{
+    return b < a;
+}
+
+} // namespace
+
+TypeId
+LadderScheduler::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::LadderScheduler")
+            .SetParent<Scheduler>()
+            .SetGroupName("Core")
+            .AddConstructor<LadderScheduler>()
+            .AddAttribute("Threshold",
+                          "Largest bucket sorted into the bottom without a new rung",
+                          UintegerValue(50),
+                          MakeUintegerAccessor(&LadderScheduler::m_threshold),
+                          MakeUintegerChecker<uint32_t>(1));
+    return tid;
+}
+
+LadderScheduler::LadderScheduler()
+    : m_threshold(50),
+      m_size(0),
+      m_topStart(0),
+      m_topMin(std::numeric_limits<uint64_t>::max()),
+      m_topMax(0),
+      m_rungCount(0),
+      m_bottomLimit(50),
+      m_bottomWidth(0)
+{
+    NS_LOG_FUNCTION(this);
+    // Never reallocated, Refill holds references to the buckets
+    m_rungs.resize(MAX_RUNGS);
+}
+
+LadderScheduler::~LadderScheduler()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+uint64_t
+LadderScheduler::CurrentStart(const Rung& rung)
+{
+    return rung.start + rung.current * rung.width;
+}
+
+void
+LadderScheduler::Insert(const Scheduler::Event& ev)
+{
+    NS_LOG_FUNCTION(this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+    m_size++;
+    uint64_t ts = ev.key.m_ts;
+    if (ts >= m_topStart)
+    {
+        m_top.push_back(ev);
+        m_topMin = std::min(m_topMin, ts);
+        m_topMax = std::max(m_topMax, ts);
+    }
+    else
+    {
+        Events* bucket = Locate(ev);
+        if (bucket != nullptr)
+        {
+            bucket->push_back(ev);
+        }
+        else
+        {
+            m_bottom.insert(std::upper_bound(m_bottom.begin(), m_bottom.end(), ev, Later), ev);
+            if (m_bottom.size() > m_bottomLimit)
+            {
+                SpillBottom();
+            }
+        }
+    }
+    if (m_bottom.empty())
+    {
+        Refill();
+    }
+}
+
+bool
+LadderScheduler::IsEmpty() const
+{
+    return m_size == 0;
+}
+
+Scheduler::Event
+LadderScheduler::PeekNext() const
+{
+    NS_LOG_FUNCTION(this);
+    NS_ASSERT(!m_bottom.empty());
+    return m_bottom.back();
+}
+
+Scheduler::Event
+LadderScheduler::RemoveNext()
+{
+    NS_LOG_FUNCTION(this);
+    NS_ASSERT(!m_bottom.empty());
+    Scheduler::Event ev = m_bottom.back();
+    m_bottom.pop_back();
+    m_size--;
+    if (m_bottom.empty())
+    {
+        Refill();
+    }
+    return ev;
+}
+
+void
+LadderScheduler::Remove(const Scheduler::Event& ev)
+{
+    NS_LOG_FUNCTION(this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+    Events* events = Locate(ev);
+    if (events == nullptr)
+    {
+        auto i = std::lower_bound(m_bottom.begin(), m_bottom.end(), ev, Later);
+        NS_ASSERT(i != m_bottom.end() && i->key.m_uid == ev.key.m_uid);
+        m_bottom.erase(i);
+    }
+    else
+    {
+        auto i = std::find_if(events->begin(), events->end(), [&ev](const Scheduler::Event& e) {
+            return e.key.m_uid == ev.key.m_uid;
+        });
+        NS_ASSERT(i != events->end());
+        *i = events->back();
+        events->pop_back();
+    }
+    m_size--;
+    if (m_bottom.empty())
+    {
+        Refill();
+    }
+}
+
+LadderScheduler::Events*
+LadderScheduler::Locate(const Scheduler::Event& ev)
+{
+    uint64_t ts = ev.key.m_ts;
+    if (ts >= m_topStart)
+    {
+        return &m_top;
+    }
+    // Each rung spans a dequeued bucket of the one above
+    for (uint32_t r = 0; r < m_rungCount; ++r)
+    {
+        Rung& rung = m_rungs[r];
+        if (ts >= CurrentStart(rung))
+        {
+            uint64_t index = (ts - rung.start) / rung.width;
+            NS_ASSERT(index < rung.count);
+            return &rung.buckets[index];
+        }
+    }
+    return nullptr;
+}
+
+void
+LadderScheduler::Spawn(Events& events, uint64_t minTs, uint64_t end)
+{
+    NS_LOG_FUNCTION(this << events.size() << minTs << end);
+    NS_ASSERT(m_rungCount < MAX_RUNGS);
+    uint32_t count = std::min<uint64_t>(events.size(), MAX_BUCKETS);
+    Rung& rung = m_rungs[m_rungCount++];
+    rung.start = minTs;
+    // Cover up to end, where the next bucket of the rung above starts
+    rung.width = (end - minTs + count - 1) / count;
+    rung.current = 0;
+    rung.count = count;
+    if (rung.buckets.size() < count)
+    {
+        rung.buckets.resize(count);
+    }
+    for (const Scheduler::Event& ev : events)
+    {
+        rung.buckets[(ev.key.m_ts - minTs) / rung.width].push_back(ev);
+    }
+    events.clear();
+}
+
+void
+LadderScheduler::MoveToBottom(Events& events)
+{
+    NS_ASSERT(m_bottom.empty());
+    m_bottom.swap(events);
+    std::sort(m_bottom.begin(), m_bottom.end(), Later);
+    // Spilling only once Bottom doubles keeps inserts amortized constant
+    // when its events cannot be split
+    m_bottomLimit = std::max<uint64_t>(m_threshold, 2 * m_bottom.size());
+}
+
+void
+LadderScheduler::SpillBottom()
+{
+    NS_LOG_FUNCTION(this << m_bottom.size());
+    m_bottomLimit = std::max<uint64_t>(m_threshold, 2 * m_bottom.size());
+    uint64_t minTs = m_bottom.back().key.m_ts;
+    if (m_rungCount == MAX_RUNGS || minTs == m_bottom.front().key.m_ts)
+    {
+        return;
+    }
+    // Bottom holds the events before the ladder, or before Top
+    uint64_t end = m_rungCount == 0 ? m_topStart : CurrentStart(m_rungs[m_rungCount - 1]);
+    Spawn(m_bottom, minTs, end);
+}
+
+void
+LadderScheduler::Refill()
+{
+    NS_LOG_FUNCTION(this);
+    while (m_bottom.empty())
+    {
+        if (m_rungCount == 0)
+        {
+            if (m_top.empty())
+            {
+                m_topStart = 0;
+                return;
+            }
+            uint64_t minTs = m_topMin;
+            uint64_t maxTs = m_topMax;
+            m_topMin = std::numeric_limits<uint64_t>::max();
+            m_topMax = 0;
+            if (minTs == maxTs || (m_top.size() <= m_threshold && maxTs - minTs < m_bottomWidth))
+            {
+                m_topStart = maxTs + 1;
+                MoveToBottom(m_top);
+                return;
+            }
+            Spawn(m_top, minTs, maxTs + 1);
+            m_topStart = m_rungs[0].start + m_rungs[0].count * m_rungs[0].width;
+            continue;
+        }
+
+        Rung& rung = m_rungs[m_rungCount - 1];
+        while (rung.current < rung.count && rung.buckets[rung.current].empty())
+        {
+            rung.current++;
+        }
+        if (rung.current == rung.count)
+        {
+            m_rungCount--;
+            continue;
+        }
+        Events& bucket = rung.buckets[rung.current];
+        rung.current++;
+        uint64_t end = CurrentStart(rung);
+        if (bucket.size() <= m_threshold || rung.width == 1 || m_rungCount == MAX_RUNGS)
+        {
+            m_bottomWidth = rung.width;
+            MoveToBottom(bucket);
+            return;
+        }
+        uint64_t minTs = std::numeric_limits<uint64_t>::max();
+        uint64_t maxTs = 0;
+        for (const Scheduler::Event& ev : bucket)
+        {
+            minTs = std::min(minTs, ev.key.m_ts);
+            maxTs = std::max(maxTs, ev.key.m_ts);
+        }
+        if (minTs == maxTs)
+        {
+            MoveToBottom(bucket);
+            return;
+        }
+        Spawn(bucket, minTs, end);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,154 @@
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * ns3::LadderScheduler declaration.
+ */
+
+namespace ns3
+{
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This event scheduler implements the ladder queue of
+ * ["Ladder Queue: An O(1) Priority Queue Structure for Large-Scale
+ * Discrete Event Simulation" by Tang, Goh and Thng][Tang]. It suits event
+ * sets such as those of datacenter networks, where most of the events are
+ * packed within a few microseconds of the current time.
+ *
+ * [Tang]: https://doi.org/10.1145/1103323.1103324 "Tang"
+ *
+ * Events are kept in three tiers:
+ *  - Top: an unsorted vector of the events far in the future, at or after
+ *    the end of the ladder.
+ *  - Ladder: rungs of buckets of equal width. The first rung is built from
+ *    Top when Bottom runs dry; a bucket with more than Threshold events is
+ *    spread over the buckets of a new, finer rung.
+ *  - Bottom: the sorted events of the earliest bucket, dequeued from the
+ *    back of a vector. When inserts before the ladder double it past
+ *    Threshold, it is spread over a new rung as a bucket would be.
+ *
+ * Top goes straight to Bottom only when it is small and no wider than
+ * the last bucket sorted into Bottom, so that a lone far event, such as
+ * the end of the run, does not leave every later insert to Bottom.
+ *
+ * Every event is sorted once, in a bucket small enough to be cheap, and
+ * moved at most once per rung. The buckets are vectors kept from one use
+ * to the next, so that a steady state does not allocate.
+ *
+ * \par Time Complexity
+ *
+ * Operation    | Amortized %Time | Reason
+ * :----------- | :-------------- | :-----
+ * Insert()     | ~Constant       | Append to Top or a bucket; sorted insert in Bottom
+ * IsEmpty()    | Constant        | Explicit queue size
+ * PeekNext()   | Constant        | Back of Bottom
+ * Remove()     | Linear          | Search in Top or a bucket
+ * RemoveNext() | ~Constant       | Back of Bottom; refill from the ladder
+ *
+ * \par Memory Complexity
+ *
+ * Category  | Memory                           | Reason
+ * :-------- | :------------------------------- | :-----
+ * Overhead  | Buckets of the rungs             | `std::vector` per bucket
+ * Per Event | `sizeof (Scheduler::Event)`<br/>(24 bytes) | `std::vector`
+ */
+class LadderScheduler : public Scheduler
+{
+  public:
+    /**
+     *  Register this type.
+     *  \return The object TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /** Constructor. */
+    LadderScheduler();
+    /** Destructor. */
+    ~LadderScheduler() override;
+
+    // Inherited
+    void Insert(const Scheduler::Event& ev) override;
+    bool IsEmpty() const override;
+    Scheduler::Event PeekNext() const override;
+    Scheduler::Event RemoveNext() override;
+    void Remove(const Scheduler::Event& ev) override;
+
+  private:
+    /** Most rungs on the ladder. */
+    static const uint32_t MAX_RUNGS = 8;
+    /** Most buckets in a rung. */
+    static const uint32_t MAX_BUCKETS = 65536;
+
+    /** Events in a bucket or in Top, in no order. */
+    typedef std::vector<Scheduler::Event> Events;
+
+    /** A rung of the ladder. */
+    struct Rung
+    {
+        uint64_t start;              //!< Timestamp of the start of bucket 0
+        uint64_t width;              //!< Time span of a bucket
+        uint32_t current;            //!< First bucket not yet dequeued
+        uint32_t count;              //!< Buckets in use
+        std::vector<Events> buckets; //!< The buckets, kept between uses
+    };
+
+    /**
+     * \param rung a rung in use
+     * \returns the timestamp of the start of its first bucket not yet dequeued
+     */
+    static uint64_t CurrentStart(const Rung& rung);
+    /**
+     * \param ev the event
+     * \returns the events holding ev in Top or on the ladder, or nullptr
+     *          for Bottom
+     */
+    Events* Locate(const Scheduler::Event& ev);
+    /**
+     * Build a new rung from some events, starting at the earliest of them.
+     * Later events before the start go to Bottom, which is where they
+     * belong.
+     * \param events the events, left empty
+     * \param minTs the earliest timestamp in the events
+     * \param end a timestamp after the events, where the rung ends
+     */
+    void Spawn(Events& events, uint64_t minTs, uint64_t end);
+    /**
+     * Sort some events into Bottom.
+     * \param events the events, left empty
+     */
+    void MoveToBottom(Events& events);
+    /** Move the next events to Bottom when it is empty. */
+    void Refill();
+    /** Spread Bottom over a new rung, up to the start of the ladder. */
+    void SpillBottom();
+
+    uint32_t m_threshold; //!< Largest bucket moved to Bottom without a new rung
+    uint64_t m_size;      //!< Number of events
+
+    Events m_top;        //!< Events at or after m_topStart
+    uint64_t m_topStart; //!< Earliest timestamp of Top
+    uint64_t m_topMin;   //!< Earliest timestamp in Top
+    uint64_t m_topMax;   //!< Latest timestamp in Top
+
+    std::vector<Rung> m_rungs; //!< The rungs, kept between uses
+    uint32_t m_rungCount;      //!< Rungs in use
+
+    /** The earliest events, sorted in decreasing order. */
+    std::vector<Scheduler::Event> m_bottom;
+    uint64_t m_bottomLimit; //!< Size of Bottom past which an insert spills it
+    uint64_t m_bottomWidth; //!< Time span of the last bucket moved to Bottom
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
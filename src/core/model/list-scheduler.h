@@ -20,6 +20,7 @@
 #ifndef LIST_SCHEDULER_H
 #define LIST_SCHEDULER_H
 
+#include "pool-allocator.h"
 #include "scheduler.h"
 
 #include <list>
@@ -84,10 +85,10 @@ class ListScheduler : public Scheduler
     void Remove(const Scheduler::Event& ev) override;
 
   private:
-    /** Event list type: a simple list of Events. */
-    typedef std::list<Scheduler::Event> Events;
+    /** Event list type: a simple list of Events, with pooled nodes. */
+    typedef std::list<Scheduler::Event, PoolStlAllocator<Scheduler::Event>> Events;
     /** Events iterator. */
-    typedef std::list<Scheduler::Event>::iterator EventsI;
+    typedef Events::iterator EventsI;
 
     /** The event list. */
     Events m_events;
@@ -20,6 +20,7 @@
 #ifndef MAP_SCHEDULER_H
 #define MAP_SCHEDULER_H
 
+#include "pool-allocator.h"
 #include "scheduler.h"
 
 #include <map>
@@ -82,12 +83,16 @@ class MapScheduler : public Scheduler
     void Remove(const Scheduler::Event& ev) override;
 
   private:
-    /** Event list type: a Map from EventKey to EventImpl. */
-    typedef std::map<Scheduler::EventKey, EventImpl*> EventMap;
+    /** Event list type: a Map from EventKey to EventImpl, with pooled nodes. */
+    typedef std::map<Scheduler::EventKey,
+                     EventImpl*,
+                     std::less<Scheduler::EventKey>,
+                     PoolStlAllocator<std::pair<const Scheduler::EventKey, EventImpl*>>>
+        EventMap;
     /** EventMap iterator. */
-    typedef std::map<Scheduler::EventKey, EventImpl*>::iterator EventMapI;
+    typedef EventMap::iterator EventMapI;
     /** EventMap const iterator. */
-    typedef std::map<Scheduler::EventKey, EventImpl*>::const_iterator EventMapCI;
+    typedef EventMap::const_iterator EventMapCI;
 
     /** The event list. */
     EventMap m_list;
@@ -0,0 +1,139 @@
+#include "pool-allocator.h"
+
+#include <new>
+
+/**
+ * \file
+ * \ingroup core
+ * ns3::PoolAllocator implementation.
+ */
+
+namespace ns3
+{
+
+namespace
+{
+
+/** Number of size classes. */
+const std::size_t CLASSES = PoolAllocator::MAX_SIZE / PoolAllocator::GRANULE;
+
+/** A free block, linked through its first word. */
+struct Block
+{
+    Block* next; //!< Next free block of the class
+};
+
+/**
+ * Freelists of a thread. Trivial so that it is usable at any time, also
+ * while the thread_local destructors of the thread run.
+ */
+struct Cache
+{
+    Block* head[CLASSES];             //!< Free blocks by size class
+    uint32_t count[CLASSES];          //!< Length of each list
+    PoolAllocator::Stats stats;       //!< Counters of the thread
+    bool armed;                       //!< The Reaper of the thread exists
+    bool closed;                      //!< The thread is exiting
+};
+
+thread_local Cache t_cache;
+
+/** Gives the blocks of a thread back to the heap when it exits. */
+struct Reaper
+{
+    /** Registers the destructor for the calling thread. */
+    void Arm()
+    {
+    }
+
+    ~Reaper()
+    {
+        t_cache.closed = true;
+        for (std::size_t c = 0; c < CLASSES; ++c)
+        {
+            while (t_cache.head[c] != nullptr)
+            {
+                Block* b = t_cache.head[c];
+                t_cache.head[c] = b->next;
+                ::operator delete(b);
+            }
+            t_cache.count[c] = 0;
+        }
+    }
+};
+
+thread_local Reaper t_reaper;
+
+} // namespace
+
+void*
+PoolAllocator::Allocate(std::size_t size)
+{
+    Cache& cache = t_cache;
+    cache.stats.allocations++;
+#ifdef NS3_POOL_ALLOCATOR
+    if (size != 0 && size <= MAX_SIZE)
+    {
+        std::size_t c = (size - 1) / GRANULE;
+        Block* b = cache.head[c];
+        if (b != nullptr)
+        {
+            cache.head[c] = b->next;
+            cache.count[c]--;
+            return b;
+        }
+        cache.stats.heap++;
+        return ::operator new((c + 1) * GRANULE);
+    }
+#endif
+    cache.stats.heap++;
+    return ::operator new(size);
+}
+
+void
+PoolAllocator::Free(void* p, std::size_t size)
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+#ifdef NS3_POOL_ALLOCATOR
+    Cache& cache = t_cache;
+    if (size != 0 && size <= MAX_SIZE && !cache.closed)
+    {
+        std::size_t c = (size - 1) / GRANULE;
+        if (cache.count[c] < MAX_CACHED_BYTES / ((c + 1) * GRANULE))
+        {
+            if (!cache.armed)
+            {
+                cache.armed = true;
+                t_reaper.Arm();
+            }
+            Block* b = static_cast<Block*>(p);
+            b->next = cache.head[c];
+            cache.head[c] = b;
+            cache.count[c]++;
+            return;
+        }
+    }
+#endif
+    ::operator delete(p);
+}
+
+PoolAllocator::Stats
+PoolAllocator::GetStats()
+{
+    return t_cache.stats;
+}
+
+bool
+PoolAllocator::IsEnabled()
+{
+#ifdef NS3_POOL_ALLOCATOR
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace ns3
@@ -0,0 +1,134 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * \file
+ * \ingroup core
+ * ns3::PoolAllocator and ns3::PoolStlAllocator declarations.
+ */
+
+namespace ns3
+{
+
+/**
+ * \ingroup core
+ * \brief Per-thread size-class freelists for small, short-lived objects.
+ *
+ * Blocks up to MAX_SIZE bytes are rounded up to a multiple of GRANULE and,
+ * once freed, kept on a freelist of the calling thread for the next
+ * allocation of the same class. A block may be freed by another thread
+ * than the one that allocated it; it then joins the freelists of the
+ * freeing thread. Each list keeps at most MAX_CACHED_BYTES, the other
+ * blocks and larger ones go back to the global heap, as do the lists of a
+ * thread when it exits. MAX_SIZE covers the data of a full-sized packet.
+ *
+ * Pooling is compiled in when NS3_POOL_ALLOCATOR is defined (CMake option
+ * NS3_POOL_ALLOCATOR); otherwise every call goes to the global heap and
+ * only the statistics are kept.
+ */
+class PoolAllocator
+{
+  public:
+    /** Size classes are multiples of this many bytes. */
+    static const std::size_t GRANULE = 16;
+    /** Largest block size kept on a freelist. */
+    static const std::size_t MAX_SIZE = 2048;
+    /** Largest number of bytes on one freelist. */
+    static const std::size_t MAX_CACHED_BYTES = 4 << 20;
+
+    /** Allocation counters of the calling thread. */
+    struct Stats
+    {
+        uint64_t allocations{0}; //!< Calls to Allocate
+        uint64_t heap{0};        //!< Of which served by the global heap
+    };
+
+    /**
+     * \param size the block size in bytes
+     * \returns a block of at least size bytes
+     */
+    static void* Allocate(std::size_t size);
+    /**
+     * \param p a block returned by Allocate, or nullptr
+     * \param size the size passed to Allocate
+     */
+    static void Free(void* p, std::size_t size);
+
+    /** \returns the counters of the calling thread */
+    static Stats GetStats();
+    /** \returns true if the freelists are compiled in */
+    static bool IsEnabled();
+};
+
+/**
+ * \ingroup core
+ * \brief Standard allocator on top of PoolAllocator, for the nodes of
+ * node-based containers.
+ *
+ * \tparam T the allocated type
+ */
+template <typename T>
+class PoolStlAllocator
+{
+  public:
+    /** Allocated type. */
+    typedef T value_type;
+
+    PoolStlAllocator() = default;
+
+    /**
+     * Rebinding constructor.
+     * \tparam U the other allocated type
+     */
+    template <typename U>
+    PoolStlAllocator(const PoolStlAllocator<U>&)
+    {
+    }
+
+    /**
+     * \param n number of objects
+     * \returns storage for n objects
+     */
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(PoolAllocator::Allocate(n * sizeof(T)));
+    }
+
+    /**
+     * \param p storage returned by allocate
+     * \param n number of objects
+     */
+    void deallocate(T* p, std::size_t n)
+    {
+        PoolAllocator::Free(p, n * sizeof(T));
+    }
+};
+
+/**
+ * All the PoolStlAllocator instances are interchangeable.
+ * \returns true
+ */
+template <typename T, typename U>
+bool
+operator==(const PoolStlAllocator<T>&, const PoolStlAllocator<U>&)
+{
+    return true;
+}
+
+/**
+ * All the PoolStlAllocator instances are interchangeable.
+ * \returns false
+ */
+template <typename T, typename U>
+bool
+operator!=(const PoolStlAllocator<T>&, const PoolStlAllocator<U>&)
+{
+    return false;
+}
+
+} // namespace ns3
+
+#endif /* POOL_ALLOCATOR_H */
@@ -289,11 +289,14 @@ class ThreadedSimulatorTestSuite : public TestSuite
     ThreadedSimulatorTestSuite()
         : TestSuite("threaded-simulator")
     {
-        std::string simulatorTypes[] = {"ns3::RealtimeSimulatorImpl", "ns3::DefaultSimulatorImpl"};
+        std::string simulatorTypes[] = {"ns3::RealtimeSimulatorImpl",
+                                        "ns3::DefaultSimulatorImpl",
+                                        "ns3::MultithreadedSimulatorImpl"};
         std::string schedulerTypes[] = {"ns3::ListScheduler",
                                         "ns3::HeapScheduler",
                                         "ns3::MapScheduler",
-                                        "ns3::CalendarScheduler"};
+                                        "ns3::CalendarScheduler",
+                                        "ns3::LadderScheduler"};
         unsigned int threadCounts[] = {0, 2, 10, 20};
         ObjectFactory factory;
 
@@ -0,0 +1,151 @@
+#include "ns3/command-line.h"
+#include "ns3/ethernet-header.h"
+#include "ns3/llc-snap-header.h"
+#include "ns3/packet.h"
+#include "ns3/pool-allocator.h"
+#include "ns3/socket.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup network
+ * Heap allocations per packet on the life of an RDMA data packet.
+ *
+ * The sender creates the packet with a priority tag and its headers, every
+ * hop copies it on the channel and rewrites its link header, the receiver
+ * answers with a header-only ACK and every pfcEvery packets a switch sends
+ * a PFC frame. A window of packets stays in flight, as in the queues of a
+ * simulation. Run it with a build with and without NS3_POOL_ALLOCATOR.
+ */
+
+using namespace ns3;
+
+/** Calls to the global operator new. */
+static uint64_t g_heapAllocations = 0;
+
+void*
+operator new(std::size_t size)
+{
+    g_heapAllocations++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+/**
+ * Send one data packet over the hops.
+ * \param payload the payload size
+ * \param hops the number of links
+ * \returns the packet as received
+ */
+static Ptr<Packet>
+SendData(uint32_t payload, uint32_t hops)
+{
+    Ptr<Packet> p = Create<Packet>(payload);
+    SocketPriorityTag priority;
+    priority.SetPriority(3);
+    p->AddPacketTag(priority);
+    LlcSnapHeader llc;
+    p->AddHeader(llc);
+    EthernetHeader eth;
+    p->AddHeader(eth);
+    for (uint32_t h = 0; h < hops; ++h)
+    {
+        p = p->Copy();
+        p->RemoveHeader(eth);
+        p->AddHeader(eth);
+    }
+    return p;
+}
+
+/**
+ * Answer a data packet.
+ * \param data the received packet
+ * \returns the ACK
+ */
+static Ptr<Packet>
+SendAck(Ptr<Packet> data)
+{
+    EthernetHeader eth;
+    data->RemoveHeader(eth);
+    Ptr<Packet> ack = Create<Packet>();
+    ack->AddHeader(eth);
+    return ack;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t packets = 500000;
+    uint32_t payload = 1400;
+    uint32_t hops = 4;
+    uint32_t window = 1024;
+    uint32_t pfcEvery = 64;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("packets", "Number of data packets to send", packets);
+    cmd.AddValue("payload", "Payload size of a data packet", payload);
+    cmd.AddValue("hops", "Links crossed by a data packet", hops);
+    cmd.AddValue("window", "Packets in flight", window);
+    cmd.AddValue("pfcEvery", "Data packets per PFC frame, 0 for none", pfcEvery);
+    cmd.Parse(argc, argv);
+
+    std::vector<Ptr<Packet>> inFlight(window);
+    uint64_t bytes = 0;
+
+    // Warm up so that the buffer sizes and the freelists settle
+    for (uint32_t i = 0; i < window * 2; ++i)
+    {
+        inFlight[i % window] = SendAck(SendData(payload, hops));
+    }
+
+    uint64_t heapBefore = g_heapAllocations;
+    PoolAllocator::Stats poolBefore = PoolAllocator::GetStats();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < packets; ++i)
+    {
+        Ptr<Packet> data = SendData(payload, hops);
+        bytes += data->GetSize();
+        inFlight[i % window] = SendAck(data);
+        if (pfcEvery != 0 && i % pfcEvery == 0)
+        {
+            Ptr<Packet> pfc = Create<Packet>(46);
+            EthernetHeader eth;
+            pfc->AddHeader(eth);
+            bytes += pfc->GetSize();
+        }
+    }
+    double ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    uint64_t heap = g_heapAllocations - heapBefore;
+    PoolAllocator::Stats pool = PoolAllocator::GetStats();
+
+    std::cout << "Pool allocator : " << (PoolAllocator::IsEnabled() ? "on" : "off") << std::endl;
+    std::cout << "Heap allocs    : " << double(heap) / packets << " per packet" << std::endl;
+    std::cout << "Pool allocs    : " << double(pool.allocations - poolBefore.allocations) / packets
+              << " per packet, " << double(pool.heap - poolBefore.heap) / packets
+              << " from the heap" << std::endl;
+    std::cout << "Run time       : " << ns / packets << " ns/packet" << std::endl;
+    std::cout << "Bytes          : " << bytes << std::endl;
+    return 0;
+}
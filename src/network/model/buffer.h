@@ -769,7 +769,7 @@ class Buffer
      * writing data. i.e., m_start should be initialized to this
      * value.
      */
-    static uint32_t g_recommendedStart;
+    static thread_local uint32_t g_recommendedStart;
 
     /**
      * offset to the start of the virtual zero area from the start
@@ -793,18 +793,14 @@ class Buffer
     uint32_t m_end;
 
 #ifdef BUFFER_FREE_LIST
-    /// Container for buffer data
-    typedef std::vector<struct Buffer::Data*> FreeList;
-
-    /// Local static destructor structure
-    struct LocalStaticDestructor
-    {
-        ~LocalStaticDestructor();
-    };
-
-    static uint32_t g_maxSize;                                   //!< Max observed data size
-    static FreeList* g_freeList;                                 //!< Buffer data container
-    static struct LocalStaticDestructor g_localStaticDestructor; //!< Local static destructor
+    // Per thread so that the threads of a parallel simulation never
+    // share it, the data blocks come from the PoolAllocator freelists
+    static thread_local uint32_t g_maxSize; //!< Max observed data size
+    /**
+     * \returns the largest data size whose storage comes from the
+     * PoolAllocator; larger buffers get their exact size from the heap
+     */
+    static uint32_t GetMaxPooledSize();
 #endif
 };
 
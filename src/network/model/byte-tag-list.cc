@@ -60,9 +60,9 @@ static class ByteTagListDataFreeList : public std::vector<struct ByteTagListData
 {
   public:
     ~ByteTagListDataFreeList();
-} g_freeList; //!< Container for struct ByteTagListData
+} thread_local g_freeList; //!< Container for struct ByteTagListData, one per thread
 
-static uint32_t g_maxSize = 0; //!< maximum data size (used for allocation)
+static thread_local uint32_t g_maxSize = 0; //!< maximum data size (used for allocation)
 
 ByteTagListDataFreeList::~ByteTagListDataFreeList()
 {
@@ -0,0 +1,747 @@
+#include "multithreaded-simulator-impl.h"
+
+#include "channel.h"
+#include "net-device.h"
+#include "node-list.h"
+#include "node.h"
+
+#include "ns3/abort.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <map>
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::MultithreadedSimulatorImpl implementation.
+ */
+
+namespace ns3
+{
+
+// Logging is avoided on the hot paths for the same reason as in
+// DefaultSimulatorImpl, and because the threads would interleave
+NS_LOG_COMPONENT_DEFINE("MultithreadedSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED(MultithreadedSimulatorImpl);
+
+thread_local MultithreadedSimulatorImpl::Partition* MultithreadedSimulatorImpl::m_current = nullptr;
+
+TypeId
+MultithreadedSimulatorImpl::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::MultithreadedSimulatorImpl")
+            .SetParent<SimulatorImpl>()
+            .SetGroupName("Network")
+            .AddConstructor<MultithreadedSimulatorImpl>()
+            .AddAttribute("ThreadCount",
+                          "Threads running the partitions, 0 for one per core",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&MultithreadedSimulatorImpl::m_threadCount),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("Lookahead",
+                          "Length of a window, 0 for the smallest delay of a channel "
+                          "between two partitions",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&MultithreadedSimulatorImpl::m_lookahead),
+                          MakeTimeChecker());
+    return tid;
+}
+
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl()
+{
+    NS_LOG_FUNCTION(this);
+    m_threadCount = 0;
+    m_global = new Partition;
+    m_global->index = 0xffffffff;
+    m_stop = false;
+    m_running = false;
+    m_done = false;
+    m_serial = false;
+    m_parity = 0;
+    m_window = 0;
+    m_windowEnd = 0;
+    m_eventsWithContextEmpty = true;
+    m_mainThreadId = std::this_thread::get_id();
+}
+
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+MultithreadedSimulatorImpl::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    for (auto& ev : m_eventsWithContext)
+    {
+        ev.event->Unref();
+    }
+    m_eventsWithContext.clear();
+    std::vector<Partition*> all = m_partitions;
+    all.push_back(m_global);
+    for (Partition* p : all)
+    {
+        for (auto& inbox : p->inbox)
+        {
+            Message* m = inbox.exchange(nullptr);
+            while (m != nullptr)
+            {
+                Message* next = m->next;
+                m->event->Unref();
+                delete m;
+                m = next;
+            }
+        }
+        while (p->events && !p->events->IsEmpty())
+        {
+            Scheduler::Event next = p->events->RemoveNext();
+            next.impl->Unref();
+        }
+        p->events = nullptr;
+        delete p;
+    }
+    m_partitions.clear();
+    m_threadPartitions.clear();
+    m_global = nullptr;
+    SimulatorImpl::DoDispose();
+}
+
+void
+MultithreadedSimulatorImpl::Destroy()
+{
+    NS_LOG_FUNCTION(this);
+    m_current = nullptr;
+    while (!m_destroyEvents.empty())
+    {
+        Ptr<EventImpl> ev = m_destroyEvents.front().PeekEventImpl();
+        m_destroyEvents.pop_front();
+        NS_LOG_LOGIC("handle destroy " << ev);
+        if (!ev->IsCancelled())
+        {
+            ev->Invoke();
+        }
+    }
+}
+
+void
+MultithreadedSimulatorImpl::SetScheduler(ObjectFactory schedulerFactory)
+{
+    NS_LOG_FUNCTION(this << schedulerFactory);
+    m_schedulerFactory = schedulerFactory;
+
+    std::vector<Partition*> all = m_partitions;
+    all.push_back(m_global);
+    for (Partition* p : all)
+    {
+        Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler>();
+        if (p->events)
+        {
+            while (!p->events->IsEmpty())
+            {
+                scheduler->Insert(p->events->RemoveNext());
+            }
+        }
+        p->events = scheduler;
+    }
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetSystemId() const
+{
+    return Current()->systemId;
+}
+
+MultithreadedSimulatorImpl::Partition*
+MultithreadedSimulatorImpl::Current() const
+{
+    return m_current != nullptr ? m_current : m_global;
+}
+
+MultithreadedSimulatorImpl::Partition*
+MultithreadedSimulatorImpl::PartitionOf(uint32_t context) const
+{
+    if (context < m_partitionOf.size())
+    {
+        return m_partitions[m_partitionOf[context]];
+    }
+    return m_global;
+}
+
+void
+MultithreadedSimulatorImpl::BuildPartitions()
+{
+    if (!m_partitions.empty())
+    {
+        return;
+    }
+
+    std::map<uint32_t, uint32_t> systems;
+    for (auto i = NodeList::Begin(); i != NodeList::End(); ++i)
+    {
+        systems.emplace((*i)->GetSystemId(), 0);
+    }
+    for (auto& system : systems)
+    {
+        system.second = m_partitions.size();
+        Partition* p = new Partition;
+        p->index = m_partitions.size();
+        p->systemId = system.first;
+        p->events = m_schedulerFactory.Create<Scheduler>();
+        m_partitions.push_back(p);
+    }
+    if (m_partitions.empty())
+    {
+        // No node, everything runs in the global partition
+        Partition* p = new Partition;
+        p->events = m_schedulerFactory.Create<Scheduler>();
+        m_partitions.push_back(p);
+    }
+
+    m_partitionOf.assign(NodeList::GetNNodes(), 0);
+    uint64_t lookahead = UINT64_MAX;
+    for (auto i = NodeList::Begin(); i != NodeList::End(); ++i)
+    {
+        Ptr<Node> node = *i;
+        m_partitionOf[node->GetId()] = systems[node->GetSystemId()];
+        for (uint32_t j = 0; j < node->GetNDevices(); ++j)
+        {
+            Ptr<Channel> channel = node->GetDevice(j)->GetChannel();
+            if (!channel)
+            {
+                continue;
+            }
+            for (std::size_t k = 0; k < channel->GetNDevices(); ++k)
+            {
+                Ptr<NetDevice> peer = channel->GetDevice(k);
+                if (peer->GetNode()->GetSystemId() == node->GetSystemId())
+                {
+                    continue;
+                }
+                TimeValue delay;
+                if (!channel->GetAttributeFailSafe("Delay", delay))
+                {
+                    NS_FATAL_ERROR("Channel " << channel->GetInstanceTypeId().GetName()
+                                              << " between partitions has no Delay");
+                }
+                lookahead = std::min<uint64_t>(lookahead, delay.Get().GetTimeStep());
+            }
+        }
+    }
+
+    if (m_lookahead.IsStrictlyPositive())
+    {
+        NS_ABORT_MSG_IF((uint64_t)m_lookahead.GetTimeStep() > lookahead,
+                        "Lookahead " << m_lookahead << " is longer than the delay "
+                                     << TimeStep(lookahead) << " between two partitions");
+        lookahead = m_lookahead.GetTimeStep();
+    }
+    NS_ABORT_MSG_IF(lookahead == 0, "Zero delay channel between two partitions");
+    m_window = lookahead;
+
+    uint32_t threads = m_threadCount;
+    if (threads == 0)
+    {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = std::min<uint32_t>(threads, m_partitions.size());
+    m_threadPartitions.assign(threads, std::vector<Partition*>());
+    for (Partition* p : m_partitions)
+    {
+        m_threadPartitions[p->index % threads].push_back(p);
+    }
+    NS_LOG_INFO(m_partitions.size() << " partitions on " << threads << " threads, lookahead "
+                                    << TimeStep(m_window));
+}
+
+void
+MultithreadedSimulatorImpl::Distribute()
+{
+    // Events scheduled with a context before Run wait in the global queue
+    std::vector<Scheduler::Event> events;
+    while (!m_global->events->IsEmpty())
+    {
+        events.push_back(m_global->events->RemoveNext());
+    }
+    uint32_t uid = m_global->uid;
+    for (Partition* p : m_partitions)
+    {
+        uid = std::max(uid, p->uid);
+    }
+    for (auto& ev : events)
+    {
+        PartitionOf(ev.key.m_context)->events->Insert(ev);
+    }
+    // Uids stay unique within every queue
+    m_global->uid = uid;
+    for (Partition* p : m_partitions)
+    {
+        p->uid = uid;
+    }
+}
+
+void
+MultithreadedSimulatorImpl::ProcessEventsWithContext()
+{
+    if (m_eventsWithContextEmpty)
+    {
+        return;
+    }
+
+    std::list<EventWithContext> eventsWithContext;
+    {
+        std::unique_lock lock{m_eventsWithContextMutex};
+        m_eventsWithContext.swap(eventsWithContext);
+        m_eventsWithContextEmpty = true;
+    }
+    // All partitions are paused, the delays count from the time reached
+    uint64_t now = std::max(m_global->currentTs, m_windowEnd);
+    for (Partition* p : m_partitions)
+    {
+        now = std::max(now, p->currentTs);
+    }
+    for (auto& ev : eventsWithContext)
+    {
+        Insert(PartitionOf(ev.context), now + ev.delay, ev.context, ev.event);
+    }
+}
+
+uint32_t
+MultithreadedSimulatorImpl::Insert(Partition* partition,
+                                   uint64_t ts,
+                                   uint32_t context,
+                                   EventImpl* event)
+{
+    Scheduler::Event ev;
+    ev.impl = event;
+    ev.key.m_ts = ts;
+    ev.key.m_context = context;
+    ev.key.m_uid = partition->uid++;
+    partition->events->Insert(ev);
+    return ev.key.m_uid;
+}
+
+void
+MultithreadedSimulatorImpl::Drain(Partition* partition, uint32_t parity)
+{
+    Message* m = partition->inbox[parity].exchange(nullptr, std::memory_order_acquire);
+    if (m == nullptr)
+    {
+        return;
+    }
+    std::vector<Message*>& drain = partition->drain;
+    for (; m != nullptr; m = m->next)
+    {
+        drain.push_back(m);
+    }
+    // Arrival order depends on the threads, this one does not
+    std::sort(drain.begin(), drain.end(), [](const Message* a, const Message* b) {
+        if (a->ts != b->ts)
+        {
+            return a->ts < b->ts;
+        }
+        if (a->source != b->source)
+        {
+            return a->source < b->source;
+        }
+        return a->seq < b->seq;
+    });
+    for (Message* msg : drain)
+    {
+        Insert(partition, msg->ts, msg->context, msg->event);
+        delete msg;
+    }
+    drain.clear();
+}
+
+void
+MultithreadedSimulatorImpl::ProcessWindow(Partition* partition)
+{
+    m_current = partition;
+    // Only the messages of the last window, whatever the other threads send
+    Drain(partition, m_parity ^ 1);
+    Ptr<Scheduler> events = partition->events;
+    while (!events->IsEmpty() && events->PeekNext().key.m_ts < m_windowEnd)
+    {
+        Scheduler::Event next = events->RemoveNext();
+        NS_ASSERT(next.key.m_ts >= partition->currentTs);
+        partition->eventCount++;
+        partition->currentTs = next.key.m_ts;
+        partition->currentContext = next.key.m_context;
+        partition->currentUid = next.key.m_uid;
+        next.impl->Invoke();
+        next.impl->Unref();
+    }
+    m_current = nullptr;
+}
+
+bool
+MultithreadedSimulatorImpl::NextWindow()
+{
+    m_current = m_global;
+    Drain(m_global, m_parity);
+    while (true)
+    {
+        if (m_stop)
+        {
+            return false;
+        }
+        ProcessEventsWithContext();
+        uint64_t next = UINT64_MAX;
+        for (Partition* p : m_partitions)
+        {
+            next = std::min(next, p->sentMin);
+            if (!p->events->IsEmpty())
+            {
+                next = std::min(next, p->events->PeekNext().key.m_ts);
+            }
+        }
+        uint64_t global = m_global->events->IsEmpty() ? UINT64_MAX
+                                                       : m_global->events->PeekNext().key.m_ts;
+        if (global == UINT64_MAX && next == UINT64_MAX)
+        {
+            return false;
+        }
+        if (global > next)
+        {
+            m_windowEnd = std::min(global, next > UINT64_MAX - m_window ? UINT64_MAX : next + m_window);
+            m_serial = (next == 0);
+            break;
+        }
+        // Global events come first at equal times, with every partition paused
+        Scheduler::Event ev = m_global->events->RemoveNext();
+        m_global->eventCount++;
+        m_global->currentTs = ev.key.m_ts;
+        m_global->currentContext = ev.key.m_context;
+        m_global->currentUid = ev.key.m_uid;
+        ev.impl->Invoke();
+        ev.impl->Unref();
+    }
+    for (Partition* p : m_partitions)
+    {
+        p->sentMin = UINT64_MAX;
+    }
+    m_parity ^= 1;
+    m_current = nullptr;
+    return true;
+}
+
+void
+MultithreadedSimulatorImpl::Worker(uint32_t index)
+{
+    while (true)
+    {
+        if (index == 0)
+        {
+            m_done = !NextWindow();
+        }
+        m_barrier.Wait();
+        if (m_done)
+        {
+            break;
+        }
+        if (!m_serial)
+        {
+            for (Partition* p : m_threadPartitions[index])
+            {
+                ProcessWindow(p);
+            }
+        }
+        else if (index == 0)
+        {
+            // Nodes are initialized at time zero, creating objects through the
+            // attribute system, which is not thread-safe
+            for (Partition* p : m_partitions)
+            {
+                ProcessWindow(p);
+            }
+        }
+        m_barrier.Wait();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Run()
+{
+    NS_LOG_FUNCTION(this);
+    BuildPartitions();
+    Distribute();
+    m_stop = false;
+    m_running = true;
+    m_mainThreadId = std::this_thread::get_id();
+
+    uint32_t threads = m_threadPartitions.size();
+    m_barrier.Reset(threads);
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < threads; ++i)
+    {
+        workers.emplace_back(&MultithreadedSimulatorImpl::Worker, this, i);
+    }
+    Worker(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    m_running = false;
+    m_current = nullptr;
+    // Later calls from the main thread see the time the simulation reached
+    for (Partition* p : m_partitions)
+    {
+        m_global->currentTs = std::max(m_global->currentTs, p->currentTs);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Barrier::Reset(uint32_t count)
+{
+    m_count = count;
+    m_waiting = 0;
+}
+
+void
+MultithreadedSimulatorImpl::Barrier::Wait()
+{
+    uint32_t generation = m_generation.load(std::memory_order_acquire);
+    if (m_waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == m_count)
+    {
+        m_waiting.store(0, std::memory_order_relaxed);
+        m_generation.fetch_add(1, std::memory_order_release);
+        return;
+    }
+    // Windows are short, spin before giving the core away
+    for (uint32_t spin = 0; m_generation.load(std::memory_order_acquire) == generation; ++spin)
+    {
+        if (spin > 4096)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsFinished() const
+{
+    if (m_stop)
+    {
+        return true;
+    }
+    if (!m_eventsWithContextEmpty)
+    {
+        return false;
+    }
+    std::vector<Partition*> all = m_partitions;
+    all.push_back(m_global);
+    for (Partition* p : all)
+    {
+        if (!p->events->IsEmpty() || p->inbox[0].load() != nullptr ||
+            p->inbox[1].load() != nullptr)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+MultithreadedSimulatorImpl::Stop()
+{
+    NS_LOG_FUNCTION(this);
+    m_stop = true;
+}
+
+void
+MultithreadedSimulatorImpl::Stop(const Time& delay)
+{
+    NS_LOG_FUNCTION(this << delay.GetTimeStep());
+    Simulator::Schedule(delay, &Simulator::Stop);
+}
+
+EventId
+MultithreadedSimulatorImpl::Schedule(const Time& delay, EventImpl* event)
+{
+    NS_ASSERT_MSG(delay.IsPositive(), "MultithreadedSimulatorImpl::Schedule(): Negative delay");
+    Partition* p = Current();
+    uint64_t ts = p->currentTs + delay.GetTimeStep();
+    uint32_t uid = Insert(p, ts, p->currentContext, event);
+    return EventId(event, ts, p->currentContext, uid);
+}
+
+void
+MultithreadedSimulatorImpl::ScheduleWithContext(uint32_t context, const Time& delay, EventImpl* event)
+{
+    if (m_current == nullptr && std::this_thread::get_id() != m_mainThreadId)
+    {
+        std::unique_lock lock{m_eventsWithContextMutex};
+        m_eventsWithContext.push_back({context, (uint64_t)delay.GetTimeStep(), event});
+        m_eventsWithContextEmpty = false;
+        return;
+    }
+
+    Partition* from = Current();
+    Partition* to = PartitionOf(context);
+    uint64_t ts = from->currentTs + delay.GetTimeStep();
+
+    // Safe whenever the other partitions are paused
+    if (to == from || !m_running || from == m_global)
+    {
+        Insert(to, ts, context, event);
+        return;
+    }
+
+    if (to == m_global)
+    {
+        ts = std::max(ts, m_windowEnd);
+    }
+    else if (ts < m_windowEnd)
+    {
+        NS_FATAL_ERROR("Event for context " << context << " at " << TimeStep(ts)
+                                            << " within the lookahead of the window ending at "
+                                            << TimeStep(m_windowEnd));
+    }
+    Message* m = new Message;
+    m->ts = ts;
+    m->context = context;
+    m->source = from->index;
+    m->seq = from->sent++;
+    m->event = event;
+    from->sentMin = std::min(from->sentMin, ts);
+    std::atomic<Message*>& inbox = to->inbox[m_parity];
+    m->next = inbox.load(std::memory_order_relaxed);
+    while (!inbox.compare_exchange_weak(m->next,
+                                            m,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed))
+    {
+    }
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleNow(EventImpl* event)
+{
+    return Schedule(Time(0), event);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleDestroy(EventImpl* event)
+{
+    EventId id(Ptr<EventImpl>(event, false), Current()->currentTs, 0xffffffff, 2);
+    std::unique_lock lock{m_destroyMutex};
+    m_destroyEvents.push_back(id);
+    return id;
+}
+
+Time
+MultithreadedSimulatorImpl::Now() const
+{
+    // Do not add function logging here, to avoid stack overflow
+    return TimeStep(Current()->currentTs);
+}
+
+Time
+MultithreadedSimulatorImpl::GetDelayLeft(const EventId& id) const
+{
+    if (IsExpired(id))
+    {
+        return TimeStep(0);
+    }
+    return TimeStep(id.GetTs() - PartitionOf(id.GetContext())->currentTs);
+}
+
+void
+MultithreadedSimulatorImpl::Remove(const EventId& id)
+{
+    if (id.GetUid() == EventId::UID::DESTROY)
+    {
+        std::unique_lock lock{m_destroyMutex};
+        for (auto i = m_destroyEvents.begin(); i != m_destroyEvents.end(); i++)
+        {
+            if (*i == id)
+            {
+                m_destroyEvents.erase(i);
+                break;
+            }
+        }
+        return;
+    }
+    if (IsExpired(id))
+    {
+        return;
+    }
+    Scheduler::Event event;
+    event.impl = id.PeekEventImpl();
+    event.key.m_ts = id.GetTs();
+    event.key.m_context = id.GetContext();
+    event.key.m_uid = id.GetUid();
+    PartitionOf(id.GetContext())->events->Remove(event);
+    event.impl->Cancel();
+    // whenever we remove an event from the event list, we have to unref it.
+    event.impl->Unref();
+}
+
+void
+MultithreadedSimulatorImpl::Cancel(const EventId& id)
+{
+    if (!IsExpired(id))
+    {
+        id.PeekEventImpl()->Cancel();
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsExpired(const EventId& id) const
+{
+    if (id.GetUid() == EventId::UID::DESTROY)
+    {
+        if (id.PeekEventImpl() == nullptr || id.PeekEventImpl()->IsCancelled())
+        {
+            return true;
+        }
+        std::unique_lock lock{m_destroyMutex};
+        for (auto i = m_destroyEvents.begin(); i != m_destroyEvents.end(); i++)
+        {
+            if (*i == id)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    // An event lives in the queue of its context
+    const Partition* p = PartitionOf(id.GetContext());
+    return id.PeekEventImpl() == nullptr || id.GetTs() < p->currentTs ||
+           (id.GetTs() == p->currentTs && id.GetUid() <= p->currentUid) ||
+           id.PeekEventImpl()->IsCancelled();
+}
+
+Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime() const
+{
+    return TimeStep(0x7fffffffffffffffLL);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetContext() const
+{
+    return Current()->currentContext;
+}
+
+uint64_t
+MultithreadedSimulatorImpl::GetEventCount() const
+{
+    uint64_t count = m_global->eventCount;
+    for (Partition* p : m_partitions)
+    {
+        count += p->eventCount;
+    }
+    return count;
+}
+
+} // namespace ns3
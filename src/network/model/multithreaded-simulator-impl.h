@@ -0,0 +1,248 @@
+#ifndef MULTITHREADED_SIMULATOR_IMPL_H
+#define MULTITHREADED_SIMULATOR_IMPL_H
+
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/pool-allocator.h"
+#include "ns3/scheduler.h"
+#include "ns3/simulator-impl.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::MultithreadedSimulatorImpl declaration.
+ */
+
+namespace ns3
+{
+
+/**
+ * \ingroup simulator
+ *
+ * \brief Conservative parallel simulator on the threads of one process.
+ *
+ * Nodes are split into partitions by their system id, as for the MPI
+ * simulators, and each partition has its own event queue. Time advances
+ * in windows no longer than the lookahead, by default the smallest delay
+ * of a channel between two partitions. Within a window the partitions run
+ * in parallel; an event for another partition is pushed to its lock-free
+ * inbox and, being at least one lookahead away, only runs in a later
+ * window. Threads meet at a barrier at the end of every window.
+ *
+ * Events without a node context (NO_CONTEXT or not a node id) belong to a
+ * global partition that runs on the main thread between windows, with all
+ * partitions paused. Such events scheduled from a partition run at the
+ * start of the next window at the earliest.
+ *
+ * Events scheduled with a context from a thread outside the simulation
+ * wait in a locked list and are moved to their partition between two
+ * windows, at the start of the next window at the earliest.
+ *
+ * The results do not depend on the number of threads: the messages of a
+ * window are drained in a fixed order at the start of the next one, and the first window, when
+ * nodes are initialized, runs the partitions one after the other.
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+  public:
+    /**
+     *  Register this type.
+     *  \return The object TypeId.
+     */
+    static TypeId GetTypeId();
+
+    /** Constructor. */
+    MultithreadedSimulatorImpl();
+    /** Destructor. */
+    ~MultithreadedSimulatorImpl() override;
+
+    // Inherited
+    void Destroy() override;
+    bool IsFinished() const override;
+    void Stop() override;
+    void Stop(const Time& delay) override;
+    EventId Schedule(const Time& delay, EventImpl* event) override;
+    void ScheduleWithContext(uint32_t context, const Time& delay, EventImpl* event) override;
+    EventId ScheduleNow(EventImpl* event) override;
+    EventId ScheduleDestroy(EventImpl* event) override;
+    void Remove(const EventId& id) override;
+    void Cancel(const EventId& id) override;
+    bool IsExpired(const EventId& id) const override;
+    void Run() override;
+    Time Now() const override;
+    Time GetDelayLeft(const EventId& id) const override;
+    Time GetMaximumSimulationTime() const override;
+    void SetScheduler(ObjectFactory schedulerFactory) override;
+    uint32_t GetSystemId() const override;
+    uint32_t GetContext() const override;
+    uint64_t GetEventCount() const override;
+
+  private:
+    void DoDispose() override;
+
+    /** An event sent to the inbox of another partition. */
+    struct Message
+    {
+        Message* next;    //!< Next message of the inbox
+        uint64_t ts;      //!< Absolute timestamp
+        uint32_t context; //!< Event context
+        uint32_t source;  //!< Index of the sending partition
+        uint64_t seq;     //!< Send order within the sending partition
+        EventImpl* event; //!< The event implementation
+
+        /**
+         * \param size the size of a message
+         * \returns storage from the pool of the sending thread
+         */
+        static void* operator new(std::size_t size)
+        {
+            return PoolAllocator::Allocate(size);
+        }
+
+        /**
+         * \param p storage returned by operator new
+         * \param size the size of a message
+         */
+        static void operator delete(void* p, std::size_t size)
+        {
+            PoolAllocator::Free(p, size);
+        }
+    };
+
+    /** The event queue and clock of a group of nodes. */
+    struct alignas(64) Partition
+    {
+        uint32_t index{0};                        //!< Position in m_partitions
+        uint32_t systemId{0};                     //!< System id of its nodes
+        Ptr<Scheduler> events;                    //!< The event priority queue
+        uint64_t currentTs{0};                    //!< Timestamp of the current event
+        uint32_t currentUid{EventId::UID::INVALID}; //!< Unique id of the current event
+        uint32_t currentContext{0xffffffff};      //!< Context of the current event
+        uint32_t uid{EventId::UID::VALID};        //!< Next event unique id
+        uint64_t eventCount{0};                   //!< Events executed
+        uint64_t sent{0};                         //!< Messages sent
+        uint64_t sentMin{UINT64_MAX};             //!< Earliest message sent in this window
+        std::atomic<Message*> inbox[2]{};         //!< Messages from other partitions, by window parity
+        std::vector<Message*> drain;              //!< Scratch space to sort the inbox
+    };
+
+    /** Sense-reversing spin barrier. */
+    class Barrier
+    {
+      public:
+        /**
+         * \param count the number of threads to wait for
+         */
+        void Reset(uint32_t count);
+        /** Wait for all the threads. */
+        void Wait();
+
+      private:
+        uint32_t m_count{1};                   //!< Threads to wait for
+        std::atomic<uint32_t> m_waiting{0};    //!< Threads arrived
+        std::atomic<uint32_t> m_generation{0}; //!< Incremented when all arrive
+    };
+
+    /** \returns the partition running on the calling thread */
+    Partition* Current() const;
+    /**
+     * \param context an event context
+     * \returns the partition of the node, the global one otherwise
+     */
+    Partition* PartitionOf(uint32_t context) const;
+    /** Build the partitions from the node system ids, once. */
+    void BuildPartitions();
+    /** Move the events with a node context to the partition of the node. */
+    void Distribute();
+    /** Move the events scheduled from other threads to their partition. */
+    void ProcessEventsWithContext();
+    /**
+     * Add an event to a partition owned by the calling thread.
+     * \param partition the partition
+     * \param ts absolute timestamp
+     * \param context event context
+     * \param event the event implementation
+     * \returns the unique id of the event
+     */
+    uint32_t Insert(Partition* partition, uint64_t ts, uint32_t context, EventImpl* event);
+    /**
+     * Move an inbox of a partition to its event queue.
+     * \param partition the partition
+     * \param parity the parity of the window the messages were sent in
+     */
+    void Drain(Partition* partition, uint32_t parity);
+    /**
+     * Run the events of a partition up to the end of the window.
+     * \param partition the partition
+     */
+    void ProcessWindow(Partition* partition);
+    /**
+     * Run the due global events and choose the next window.
+     * \returns false when the simulation is over
+     */
+    bool NextWindow();
+    /**
+     * Body of a simulation thread.
+     * \param index the thread index, 0 is the thread calling Run
+     */
+    void Worker(uint32_t index);
+
+    /** An event scheduled from a thread outside the simulation. */
+    struct EventWithContext
+    {
+        uint32_t context; //!< Event context
+        uint64_t delay;   //!< Delay in time steps
+        EventImpl* event; //!< The event implementation
+    };
+
+    /** Events scheduled from other threads, moved by the main thread. */
+    std::list<EventWithContext> m_eventsWithContext;
+    /** Flag to avoid taking the mutex when there is no such event. */
+    std::atomic<bool> m_eventsWithContextEmpty;
+    /** Mutex of m_eventsWithContext. */
+    std::mutex m_eventsWithContextMutex;
+    /** The thread that runs the global partition. */
+    std::thread::id m_mainThreadId;
+
+    /** Container type for the events to run at Simulator::Destroy() */
+    typedef std::list<EventId> DestroyEvents;
+    /** The container of events to run at Destroy. */
+    DestroyEvents m_destroyEvents;
+    /** Mutex of m_destroyEvents. */
+    mutable std::mutex m_destroyMutex;
+
+    ObjectFactory m_schedulerFactory; //!< Builds the event queues
+    uint32_t m_threadCount;           //!< Threads, 0 for one per core
+    Time m_lookahead;                 //!< Window length, 0 for the smallest delay
+
+    /** Events without a node context, run between windows. */
+    Partition* m_global;
+    /** One partition per system id. */
+    std::vector<Partition*> m_partitions;
+    /** Partition index by node id. */
+    std::vector<uint32_t> m_partitionOf;
+    /** Partitions run by each thread. */
+    std::vector<std::vector<Partition*>> m_threadPartitions;
+
+    std::atomic<bool> m_stop; //!< Flag calling for the end of the simulation
+    bool m_running;           //!< Between the start and the end of Run
+    bool m_done;              //!< Set by the main thread to end the workers
+    bool m_serial;            //!< The window runs on the main thread only
+    uint32_t m_parity;        //!< Parity of the current window, selects the inbox
+    uint64_t m_window;        //!< Lookahead in time steps
+    uint64_t m_windowEnd;     //!< End (excluded) of the current window
+    Barrier m_barrier;        //!< Separates the windows
+
+    /** Partition of the calling thread, the global one if null. */
+    static thread_local Partition* m_current;
+};
+
+} // namespace ns3
+
+#endif /* MULTITHREADED_SIMULATOR_IMPL_H */
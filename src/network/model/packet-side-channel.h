@@ -0,0 +1,40 @@
+#ifndef PACKET_SIDE_CHANNEL_H
+#define PACKET_SIDE_CHANNEL_H
+
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup packet
+ *
+ * \brief Parsed per-packet state carried next to the packet bytes
+ *
+ * Unlike a packet Tag, a side channel is never serialized: subclasses
+ * keep their fields as plain C++ members and are shared by reference
+ * between copies of a Packet. A side channel must therefore be treated
+ * as immutable once attached; to change it, build a new one and call
+ * Packet::SetSideChannel again.
+ *
+ * Side channels are not carried across Packet::Serialize, so they do
+ * not survive distributed (MPI) links. Packet::DeepCopy clones them
+ * with Copy.
+ */
+class PacketSideChannel : public SimpleRefCount<PacketSideChannel>
+{
+  public:
+    virtual ~PacketSideChannel()
+    {
+    }
+
+    /**
+     * \returns a new side channel with the same content
+     */
+    virtual Ptr<PacketSideChannel> Copy() const = 0;
+};
+
+} // namespace ns3
+
+#endif /* PACKET_SIDE_CHANNEL_H */
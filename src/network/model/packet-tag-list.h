@@ -252,6 +252,12 @@ class PacketTagList
      * \returns The newly constructed TagData object.
      */
     static TagData* CreateTagData(size_t dataSize);
+    /**
+     * Destroy a TagData struct and give its memory back to the pool.
+     *
+     * \param [in] tag The TagData object returned by CreateTagData.
+     */
+    static void DeleteTagData(TagData* tag);
 
     /**
      * Typedef of method function pointer for copy-on-write operations
@@ -365,15 +371,13 @@ PacketTagList::RemoveAll()
         }
         if (prev != nullptr)
         {
-            prev->~TagData();
-            std::free(prev);
+            DeleteTagData(prev);
         }
         prev = cur;
     }
     if (prev != nullptr)
     {
-        prev->~TagData();
-        std::free(prev);
+        DeleteTagData(prev);
     }
     m_next = nullptr;
 }
@@ -20,17 +20,20 @@
 
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include "ns3/pool-allocator.h"
 #include "ns3/simulator.h"
 
+#include <algorithm>
 #include <cstdarg>
 #include <string>
+#include <vector>
 
 namespace ns3
 {
 
 NS_LOG_COMPONENT_DEFINE("Packet");
 
-uint32_t Packet::m_globalUid = 0;
+thread_local uint32_t Packet::m_globalUid = 0;
 
 TypeId
 ByteTagIterator::Item::GetTypeId() const
@@ -136,6 +139,27 @@ Packet::Copy() const
     return Ptr<Packet>(new Packet(*this), false);
 }
 
+Ptr<Packet>
+Packet::DeepCopy() const
+{
+    static thread_local std::vector<uint8_t> buffer;
+    uint32_t size = GetSerializedSize();
+    if (buffer.size() < size)
+    {
+        buffer.resize(size);
+    }
+    [[maybe_unused]] uint32_t ok = Serialize(buffer.data(), size);
+    NS_ASSERT(ok);
+    Ptr<Packet> ret = Ptr<Packet>(new Packet(buffer.data(), size, true), false);
+    if (m_sideChannel)
+    {
+        ret->m_sideChannel = m_sideChannel->Copy();
+    }
+    ret->m_slotMask = m_slotMask;
+    std::copy(m_slots, m_slots + SLOT_COUNT, ret->m_slots);
+    return ret;
+}
+
 Packet::Packet()
     : m_buffer(),
       m_byteTagList(),
@@ -156,8 +180,11 @@ Packet::Packet(const Packet& o)
     : m_buffer(o.m_buffer),
       m_byteTagList(o.m_byteTagList),
       m_packetTagList(o.m_packetTagList),
-      m_metadata(o.m_metadata)
+      m_metadata(o.m_metadata),
+      m_sideChannel(o.m_sideChannel),
+      m_slotMask(o.m_slotMask)
 {
+    std::copy(o.m_slots, o.m_slots + SLOT_COUNT, m_slots);
     o.m_nixVector ? m_nixVector = o.m_nixVector->Copy() : m_nixVector = nullptr;
 }
 
@@ -172,10 +199,25 @@ Packet::operator=(const Packet& o)
     m_byteTagList = o.m_byteTagList;
     m_packetTagList = o.m_packetTagList;
     m_metadata = o.m_metadata;
+    m_sideChannel = o.m_sideChannel;
+    m_slotMask = o.m_slotMask;
+    std::copy(o.m_slots, o.m_slots + SLOT_COUNT, m_slots);
     o.m_nixVector ? m_nixVector = o.m_nixVector->Copy() : m_nixVector = nullptr;
     return *this;
 }
 
+void*
+Packet::operator new(std::size_t size)
+{
+    return PoolAllocator::Allocate(size);
+}
+
+void
+Packet::operator delete(void* p, std::size_t size)
+{
+    PoolAllocator::Free(p, size);
+}
+
 Packet::Packet(uint32_t size)
     : m_buffer(size),
       m_byteTagList(),
@@ -249,6 +291,9 @@ Packet::CreateFragment(uint32_t start, uint32_t length) const
     Ptr<Packet> ret =
         Ptr<Packet>(new Packet(buffer, byteTagList, m_packetTagList, metadata), false);
     ret->SetNixVector(GetNixVector());
+    ret->SetSideChannel(GetSideChannel());
+    ret->m_slotMask = m_slotMask;
+    std::copy(m_slots, m_slots + SLOT_COUNT, ret->m_slots);
     return ret;
 }
 
@@ -264,6 +309,18 @@ Packet::GetNixVector() const
     return m_nixVector;
 }
 
+void
+Packet::SetSideChannel(Ptr<const PacketSideChannel> sideChannel)
+{
+    m_sideChannel = sideChannel;
+}
+
+Ptr<const PacketSideChannel>
+Packet::GetSideChannel() const
+{
+    return m_sideChannel;
+}
+
 void
 Packet::AddHeader(const Header& header)
 {
@@ -402,6 +459,18 @@ Packet::CopyData(uint8_t* buffer, uint32_t size) const
     return m_buffer.CopyData(buffer, size);
 }
 
+void
+Packet::OverwriteAtStart(const uint8_t* buffer, uint32_t size)
+{
+    NS_LOG_FUNCTION(this << &buffer << size);
+    NS_ASSERT(size <= m_buffer.GetSize());
+    // Removing then re-adding the bytes lets Buffer::AddAtStart decide
+    // whether the data is shared and must be copied before writing.
+    m_buffer.RemoveAtStart(size);
+    m_buffer.AddAtStart(size);
+    m_buffer.Begin().Write(buffer, size);
+}
+
 void
 Packet::CopyData(std::ostream* os, uint32_t size) const
 {
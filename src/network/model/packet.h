@@ -24,6 +24,7 @@
 #include "header.h"
 #include "nix-vector.h"
 #include "packet-metadata.h"
+#include "packet-side-channel.h"
 #include "packet-tag-list.h"
 #include "tag.h"
 #include "trailer.h"
@@ -34,6 +35,7 @@
 #include "ns3/mac48-address.h"
 #include "ns3/ptr.h"
 
+#include <cstddef>
 #include <stdint.h>
 
 namespace ns3
@@ -256,6 +258,18 @@ class Packet : public SimpleRefCount<Packet>
      * \return the copied object
      */
     Packet& operator=(const Packet& o);
+    /**
+     * \brief Packets are allocated from the PoolAllocator freelists
+     * \param size the size of a packet
+     * \returns storage for the packet
+     */
+    static void* operator new(std::size_t size);
+    /**
+     * \brief Give the storage of a packet back to the pool
+     * \param p storage returned by operator new
+     * \param size the size of a packet
+     */
+    static void operator delete(void* p, std::size_t size);
     /**
      * \brief Create a packet with a zero-filled payload.
      *
@@ -440,6 +454,18 @@ class Packet : public SimpleRefCount<Packet>
      */
     uint32_t CopyData(uint8_t* buffer, uint32_t size) const;
 
+    /**
+     * \brief Overwrite the first bytes of the packet in place.
+     *
+     * The packet size, headers metadata and tags are unchanged. The
+     * underlying buffer is copied first only if it is shared with
+     * another packet, so this is safe to use on copies.
+     *
+     * \param buffer the new bytes
+     * \param size the number of bytes to overwrite, at most GetSize ()
+     */
+    void OverwriteAtStart(const uint8_t* buffer, uint32_t size);
+
     /**
      * \brief Copy the packet contents to an output stream.
      *
@@ -461,6 +487,19 @@ class Packet : public SimpleRefCount<Packet>
      */
     Ptr<Packet> Copy() const;
 
+    /**
+     * \brief performs a deep copy of the packet.
+     *
+     * \returns a copy that shares no buffer, tag, nix-vector or side
+     * channel data with this packet.
+     *
+     * Packet data is shared through non-atomic reference counts, so a
+     * packet handed to another thread must be a deep copy. The packet
+     * is passed through Serialize and Deserialize as on an MPI link,
+     * then its side channel is cloned and its slots are copied.
+     */
+    Ptr<Packet> DeepCopy() const;
+
     /**
      * \brief Returns the packet's Uid.
      *
@@ -718,6 +757,58 @@ class Packet : public SimpleRefCount<Packet>
      */
     Ptr<NixVector> GetNixVector() const;
 
+    /**
+     * \brief Attach parsed metadata to this packet.
+     *
+     * The side channel is shared, not copied, by Packet::Copy and
+     * must not be modified after it is attached. Passing nullptr
+     * removes the current side channel.
+     *
+     * \param sideChannel the side channel
+     */
+    void SetSideChannel(Ptr<const PacketSideChannel> sideChannel);
+    /**
+     * \brief Get the side channel attached to this packet.
+     *
+     * \returns the side channel, or nullptr if none is attached
+     */
+    Ptr<const PacketSideChannel> GetSideChannel() const;
+
+    /**
+     * \brief Fixed metadata slots for hot per-hop state.
+     *
+     * Slots are plain integers stored inside the Packet, so reading or
+     * writing one is constant time and never allocates or triggers the
+     * copy-on-write of the packet tag list. They are copied with the
+     * packet but, like the side channel, are not serialized.
+     */
+    enum MetadataSlot : uint8_t
+    {
+        SLOT_PRIORITY = 0, //!< traffic class used by the device queue
+        SLOT_INGRESS_PORT, //!< ifIndex of the device the packet arrived on
+        SLOT_ENQUEUE_SIZE, //!< bytes charged to the switch buffer on ingress
+        SLOT_COUNT
+    };
+
+    /**
+     * \brief Set a metadata slot.
+     * \param slot the slot
+     * \param value the value
+     */
+    inline void SetSlot(MetadataSlot slot, uint32_t value);
+    /**
+     * \brief Read a metadata slot.
+     * \param slot the slot
+     * \param value the value, unchanged if the slot is not set
+     * \returns true if the slot is set
+     */
+    inline bool PeekSlot(MetadataSlot slot, uint32_t& value) const;
+    /**
+     * \brief Clear a metadata slot.
+     * \param slot the slot
+     */
+    inline void RemoveSlot(MetadataSlot slot);
+
     /**
      * TracedCallback signature for Ptr<Packet>
      *
@@ -797,7 +888,12 @@ class Packet : public SimpleRefCount<Packet>
     /* Please see comments above about nix-vector */
     mutable Ptr<NixVector> m_nixVector; //!< the packet's Nix vector
 
-    static uint32_t m_globalUid; //!< Global counter of packets Uid
+    Ptr<const PacketSideChannel> m_sideChannel; //!< parsed metadata, never serialized
+
+    uint32_t m_slots[SLOT_COUNT]; //!< metadata slot values
+    uint8_t m_slotMask{0};        //!< bit i set if slot i holds a value
+
+    static thread_local uint32_t m_globalUid; //!< Per-thread counter of packets Uid
 };
 
 /**
@@ -865,6 +961,30 @@ Packet::GetSize() const
     return m_buffer.GetSize();
 }
 
+void
+Packet::SetSlot(MetadataSlot slot, uint32_t value)
+{
+    m_slots[slot] = value;
+    m_slotMask |= (1 << slot);
+}
+
+bool
+Packet::PeekSlot(MetadataSlot slot, uint32_t& value) const
+{
+    if (!(m_slotMask & (1 << slot)))
+    {
+        return false;
+    }
+    value = m_slots[slot];
+    return true;
+}
+
+void
+Packet::RemoveSlot(MetadataSlot slot)
+{
+    m_slotMask &= ~(1 << slot);
+}
+
 } // namespace ns3
 
 #endif /* PACKET_H */
@@ -19,6 +19,7 @@
 
 #include "ns3/buffer.h"
 #include "ns3/double.h"
+#include "ns3/pool-allocator.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/test.h"
 
@@ -396,6 +397,69 @@ BufferTest::DoRun()
     NS_TEST_ASSERT_MSG_EQ(val1, val2, "Bad ReadNtohU16()");
 }
 
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * Buffer data stays in the PoolAllocator after a buffer larger than the
+ * pool holds.
+ */
+class BufferPoolTest : public TestCase
+{
+  private:
+    /**
+     * Allocates and frees packet-sized buffers
+     * \param count the number of buffers
+     */
+    void Churn(uint32_t count);
+
+  public:
+    void DoRun() override;
+    BufferPoolTest();
+};
+
+BufferPoolTest::BufferPoolTest()
+    : TestCase("Buffer pool")
+{
+}
+
+void
+BufferPoolTest::Churn(uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Buffer buffer;
+        buffer.AddAtStart(1400);
+        buffer.AddAtStart(58);
+        Buffer copy = buffer;
+        copy.AddAtStart(4);
+    }
+}
+
+void
+BufferPoolTest::DoRun()
+{
+    if (!PoolAllocator::IsEnabled())
+    {
+        return;
+    }
+    Churn(16);
+    uint64_t heap = PoolAllocator::GetStats().heap;
+    Churn(1000);
+    NS_TEST_ASSERT_MSG_EQ(PoolAllocator::GetStats().heap, heap, "Buffers not pooled");
+
+    {
+        // A merged segment, larger than a pool block
+        Buffer buffer;
+        buffer.AddAtStart(64000);
+    }
+    heap = PoolAllocator::GetStats().heap;
+    Churn(1000);
+    NS_TEST_ASSERT_MSG_EQ(PoolAllocator::GetStats().heap,
+                          heap,
+                          "Buffers not pooled after an oversized one");
+}
+
 /**
  * \ingroup network-test
  * \ingroup tests
@@ -412,6 +476,7 @@ BufferTestSuite::BufferTestSuite()
     : TestSuite("buffer", UNIT)
 {
     AddTestCase(new BufferTest, TestCase::QUICK);
+    AddTestCase(new BufferPoolTest, TestCase::QUICK);
 }
 
 static BufferTestSuite g_bufferTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,227 @@
+#include "ns3/config.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Packets between nodes of different partitions of the
+ * MultithreadedSimulatorImpl arrive in order and on time.
+ *
+ * Nodes form a ring, each in its own partition. Every node sends a burst
+ * to both neighbours over links with a transmission time and a delay, the
+ * smallest gap being exactly the lookahead. Packets cross partitions as
+ * on a point-to-point link: a deep copy and a plain pointer.
+ */
+class MultithreadedDeliveryTestCase : public TestCase
+{
+  public:
+    /**
+     * Constructor.
+     * \param threads The number of simulation threads.
+     */
+    MultithreadedDeliveryTestCase(uint32_t threads);
+
+  private:
+    void DoSetup() override;
+    void DoRun() override;
+    void DoTeardown() override;
+
+    /** A packet seen by a receiver. */
+    struct Arrival
+    {
+        uint32_t from;    //!< Sending node
+        uint32_t seq;     //!< Sequence number on the link
+        int64_t time;     //!< Arrival time in ns
+        uint32_t context; //!< Context of the receive event
+    };
+
+    /**
+     * Send a packet on the link from one node to another.
+     * \param from The sending node.
+     * \param link The link of the sending node, 0 or 1.
+     * \param seq The sequence number on the link.
+     */
+    void Send(uint32_t from, uint32_t link, uint32_t seq);
+    /**
+     * Record a packet at its receiver.
+     * \param to The receiving node.
+     * \param packet The packet.
+     */
+    void Receive(uint32_t to, Ptr<Packet> packet);
+
+    /**
+     * \param from The sending node.
+     * \param link The link of the sending node.
+     * \returns the receiving node of the link.
+     */
+    uint32_t Peer(uint32_t from, uint32_t link) const;
+
+    static constexpr uint32_t NODES = 4;     //!< Nodes in the ring
+    static constexpr uint32_t PACKETS = 200; //!< Packets per link
+    static constexpr int64_t TX = 800;       //!< Transmission time in ns
+    static constexpr int64_t DELAY = 1000;   //!< Link delay in ns
+    static constexpr int64_t GAP = 500;      //!< Time between two sends in ns
+
+    uint32_t m_threads;                           //!< Simulation threads
+    std::vector<Ptr<Node>> m_nodes;               //!< The ring
+    std::vector<std::vector<int64_t>> m_busy;     //!< End of the last transmission, by node and link
+    std::vector<std::vector<Arrival>> m_arrivals; //!< Packets received, by node
+};
+
+MultithreadedDeliveryTestCase::MultithreadedDeliveryTestCase(uint32_t threads)
+    : TestCase("Check cross-partition delivery with " + std::to_string(threads) + " threads"),
+      m_threads(threads)
+{
+}
+
+void
+MultithreadedDeliveryTestCase::DoSetup()
+{
+    Config::SetGlobal("SimulatorImplementationType",
+                      StringValue("ns3::MultithreadedSimulatorImpl"));
+    Config::SetDefault("ns3::MultithreadedSimulatorImpl::ThreadCount", UintegerValue(m_threads));
+    // No channel connects the nodes, the links below have this smallest gap
+    Config::SetDefault("ns3::MultithreadedSimulatorImpl::Lookahead",
+                       TimeValue(NanoSeconds(TX + DELAY)));
+}
+
+void
+MultithreadedDeliveryTestCase::DoTeardown()
+{
+    m_nodes.clear();
+    m_busy.clear();
+    m_arrivals.clear();
+    Config::SetDefault("ns3::MultithreadedSimulatorImpl::ThreadCount", UintegerValue(0));
+    Config::SetDefault("ns3::MultithreadedSimulatorImpl::Lookahead", TimeValue(Seconds(0)));
+    Config::SetGlobal("SimulatorImplementationType", StringValue("ns3::DefaultSimulatorImpl"));
+}
+
+uint32_t
+MultithreadedDeliveryTestCase::Peer(uint32_t from, uint32_t link) const
+{
+    return link == 0 ? (from + 1) % NODES : (from + NODES - 1) % NODES;
+}
+
+void
+MultithreadedDeliveryTestCase::Send(uint32_t from, uint32_t link, uint32_t seq)
+{
+    // Only the partition of the sender touches its links
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    int64_t start = std::max(now, m_busy[from][link]);
+    m_busy[from][link] = start + TX;
+
+    uint32_t payload[2] = {from, seq};
+    Ptr<Packet> packet = Create<Packet>(reinterpret_cast<uint8_t*>(payload), sizeof(payload));
+    uint32_t to = Peer(from, link);
+    Simulator::ScheduleWithContext(m_nodes[to]->GetId(),
+                                   NanoSeconds(start + TX + DELAY - now),
+                                   &MultithreadedDeliveryTestCase::Receive,
+                                   this,
+                                   to,
+                                   packet->DeepCopy());
+}
+
+void
+MultithreadedDeliveryTestCase::Receive(uint32_t to, Ptr<Packet> packet)
+{
+    uint32_t payload[2];
+    packet->CopyData(reinterpret_cast<uint8_t*>(payload), sizeof(payload));
+    m_arrivals[to].push_back(
+        {payload[0], payload[1], Simulator::Now().GetNanoSeconds(), Simulator::GetContext()});
+}
+
+void
+MultithreadedDeliveryTestCase::DoRun()
+{
+    m_busy.assign(NODES, std::vector<int64_t>(2, 0));
+    m_arrivals.assign(NODES, std::vector<Arrival>());
+    for (uint32_t i = 0; i < NODES; ++i)
+    {
+        m_nodes.push_back(CreateObject<Node>(i));
+    }
+    for (uint32_t i = 0; i < NODES; ++i)
+    {
+        for (uint32_t link = 0; link < 2; ++link)
+        {
+            for (uint32_t seq = 0; seq < PACKETS; ++seq)
+            {
+                Simulator::ScheduleWithContext(m_nodes[i]->GetId(),
+                                               NanoSeconds(seq * GAP + i * 10),
+                                               &MultithreadedDeliveryTestCase::Send,
+                                               this,
+                                               i,
+                                               link,
+                                               seq);
+            }
+        }
+    }
+
+    Simulator::Run();
+
+    for (uint32_t to = 0; to < NODES; ++to)
+    {
+        const std::vector<Arrival>& arrivals = m_arrivals[to];
+        NS_TEST_ASSERT_MSG_EQ(arrivals.size(), 2 * PACKETS, "Lost packets at node " << to);
+
+        std::vector<uint32_t> next(NODES, 0);
+        int64_t last = 0;
+        for (const Arrival& arrival : arrivals)
+        {
+            NS_TEST_ASSERT_MSG_EQ(arrival.context,
+                                  m_nodes[to]->GetId(),
+                                  "Packet received in the wrong context");
+            NS_TEST_ASSERT_MSG_GT_OR_EQ(arrival.time, last, "Arrivals out of time order");
+            last = arrival.time;
+            NS_TEST_ASSERT_MSG_EQ(arrival.seq,
+                                  next[arrival.from],
+                                  "Packets from " << arrival.from << " to " << to
+                                                  << " out of order");
+            next[arrival.from] += 1;
+
+            // The link is busy from the first send on, GAP < TX
+            int64_t expected = arrival.from * 10 + (arrival.seq + 1) * TX + DELAY;
+            NS_TEST_ASSERT_MSG_EQ(arrival.time,
+                                  expected,
+                                  "Packet " << arrival.seq << " from " << arrival.from
+                                            << " to " << to << " at the wrong time");
+        }
+    }
+
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief MultithreadedSimulatorImpl TestSuite
+ */
+class MultithreadedSimulatorTestSuite : public TestSuite
+{
+  public:
+    MultithreadedSimulatorTestSuite();
+};
+
+MultithreadedSimulatorTestSuite::MultithreadedSimulatorTestSuite()
+    : TestSuite("multithreaded-simulator", UNIT)
+{
+    for (uint32_t threads : {1, 2, 4})
+    {
+        AddTestCase(new MultithreadedDeliveryTestCase(threads), TestCase::QUICK);
+    }
+}
+
+static MultithreadedSimulatorTestSuite
+    g_multithreadedSimulatorTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,179 @@
+#include "ns3/command-line.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/packet.h"
+#include "ns3/point-to-point-channel.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/point-to-point-queue.h"
+#include "ns3/port-header.h"
+#include "ns3/simulator.h"
+#include "ns3/switch-node.h"
+
+#include <chrono>
+#include <iostream>
+
+using namespace ns3;
+
+/**
+ * Wall time of one switch hop: the receiving device, the SwitchNode
+ * ingress and egress pipelines, the PointToPointQueue and the channel.
+ *
+ * A host sends UDP-like packets at line rate through a chain of switches
+ * to another host. The chain runs once with one switch and once with
+ * more; the difference, divided by the extra hops, leaves out the hosts
+ * and the setup.
+ */
+
+static const Ipv4Address SRC_IP("10.0.0.1");
+static const Ipv4Address DST_IP("10.0.0.2");
+
+static uint64_t g_received = 0;
+
+static bool
+Receive(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol, const Address& from)
+{
+    g_received += 1;
+    return true;
+}
+
+static Ptr<PointToPointNetDevice>
+CreateDevice(Ptr<Node> node)
+{
+    Ptr<PointToPointNetDevice> device = CreateObject<PointToPointNetDevice>();
+    device->SetDataRate(DataRate("100Gbps"));
+    device->SetQueue(CreateObject<PointToPointQueue>());
+    device->SetAddress(Mac48Address::Allocate());
+    node->AddDevice(device);
+    return device;
+}
+
+static void
+Connect(Ptr<PointToPointNetDevice> a, Ptr<PointToPointNetDevice> b)
+{
+    Ptr<PointToPointChannel> channel = CreateObject<PointToPointChannel>();
+    channel->SetAttribute("Delay", TimeValue(MicroSeconds(1)));
+    a->Attach(channel);
+    b->Attach(channel);
+}
+
+static void
+Send(Ptr<PointToPointNetDevice> device, uint32_t left, uint32_t size, Time gap)
+{
+    Ptr<Packet> packet = Create<Packet>(size);
+    PortHeader port;
+    port.SetSourcePort(10000 + left % 64);
+    port.SetDestinationPort(80);
+    packet->AddHeader(port);
+    Ipv4Header ipv4;
+    ipv4.SetSource(SRC_IP);
+    ipv4.SetDestination(DST_IP);
+    ipv4.SetProtocol(17);
+    ipv4.SetTtl(64);
+    ipv4.SetPayloadSize(packet->GetSize());
+    packet->AddHeader(ipv4);
+    device->Send(packet, device->GetBroadcast(), 0x0800);
+
+    if (left > 1)
+    {
+        Simulator::Schedule(gap, &Send, device, left - 1, size, gap);
+    }
+}
+
+/**
+ * \param switches switches between the two hosts
+ * \param packets packets to send
+ * \param size payload size
+ * \returns the wall time of the run in ns
+ */
+static double
+Run(uint32_t switches, uint32_t packets, uint32_t size)
+{
+    Ptr<Node> src = CreateObject<Node>();
+    Ptr<Node> dst = CreateObject<Node>();
+    Ptr<PointToPointNetDevice> srcNic = CreateDevice(src);
+    Ptr<PointToPointNetDevice> dstNic = CreateDevice(dst);
+    srcNic->SetID(1000);
+    dstNic->SetID(1001);
+    for (auto nic : {srcNic, dstNic})
+    {
+        nic->SetSetting(0);
+        nic->SetRdma(0);
+    }
+    dstNic->SetReceiveCallback(MakeCallback(&Receive));
+
+    Ptr<PointToPointNetDevice> upstream = srcNic;
+    uint16_t upstreamId = 1000;
+    for (uint32_t i = 0; i < switches; ++i)
+    {
+        Ptr<SwitchNode> sw = CreateObject<SwitchNode>();
+        sw->SetID(2000 + i);
+        sw->SetOutput("switch-hop-benchmark");
+        sw->SetSetting(0);
+        sw->SetPFC(0);
+        Ptr<PointToPointNetDevice> in = CreateDevice(sw);
+        Ptr<PointToPointNetDevice> out = CreateDevice(sw);
+        Connect(upstream, in);
+        sw->SetNextNode(in->GetIfIndex(), upstreamId);
+        sw->SetNextNode(out->GetIfIndex(), i + 1 == switches ? 1001 : 2001 + i);
+        sw->AddHostRouteTo(SRC_IP, in->GetIfIndex());
+        sw->AddHostRouteTo(DST_IP, out->GetIfIndex());
+        if (i == 0)
+        {
+            sw->MarkNicDevice(in);
+        }
+        if (i + 1 == switches)
+        {
+            sw->MarkNicDevice(out);
+        }
+        upstream = out;
+        upstreamId = 2000 + i;
+    }
+    Connect(upstream, dstNic);
+
+    // Paced at the line rate, the queues stay short
+    Time gap = DataRate("100Gbps").CalculateBytesTxTime(size + 64);
+    Simulator::ScheduleWithContext(src->GetId(), Time(0), &Send, srcNic, packets, size, gap);
+
+    g_received = 0;
+    auto start = std::chrono::steady_clock::now();
+    Simulator::Run();
+    double ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    Simulator::Destroy();
+
+    if (g_received != packets)
+    {
+        std::cout << "Received " << g_received << " of " << packets << " packets with "
+                  << switches << " switches" << std::endl;
+        exit(1);
+    }
+    return ns;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t packets = 100000;
+    uint32_t switches = 5;
+    uint32_t size = 1000;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("packets", "Number of packets to forward", packets);
+    cmd.AddValue("switches", "Switches in the long chain, at least 2", switches);
+    cmd.AddValue("size", "Payload size of the packets", size);
+    cmd.Parse(argc, argv);
+
+    if (switches < 2)
+    {
+        std::cerr << "The long chain needs at least two switches" << std::endl;
+        return 1;
+    }
+
+    double shortNs = Run(1, packets, size);
+    double longNs = Run(switches, packets, size);
+
+    std::cout << "1 switch   : " << shortNs / packets << " ns/packet" << std::endl;
+    std::cout << switches << " switches : " << longNs / packets << " ns/packet" << std::endl;
+    std::cout << "Per hop    : " << (longNs - shortNs) / (double(packets) * (switches - 1))
+              << " ns" << std::endl;
+    return 0;
+}
@@ -21,6 +21,8 @@ BthHeader::BthHeader()
     m_size = 0;
     m_id = 0;
     m_sequence = 0;
+    m_sackSegment = 0;
+    m_sackBitmap = 0;
 }
 
 BthHeader::~BthHeader()
@@ -52,7 +54,7 @@ BthHeader::Print(std::ostream& os) const
 uint32_t
 BthHeader::GetSerializedSize() const
 {
-    return 12;
+    return GetSACK() ? 22 : 12;
 }
 
 void
@@ -63,6 +65,10 @@ BthHeader::Serialize(Buffer::Iterator start) const
     start.WriteHtonU16(m_size);
     start.WriteHtonU32(m_id);
     start.WriteHtonU32(m_sequence);
+    if(GetSACK()){
+        start.WriteHtonU16(m_sackSegment);
+        start.WriteHtonU64(m_sackBitmap);
+    }
 }
 
 uint32_t
@@ -73,9 +79,28 @@ BthHeader::Deserialize(Buffer::Iterator start)
     m_size = start.ReadNtohU16();
     m_id = start.ReadNtohU32();
     m_sequence = start.ReadNtohU32();
+    if(GetSACK()){
+        m_sackSegment = start.ReadNtohU16();
+        m_sackBitmap = start.ReadNtohU64();
+    }
     return GetSerializedSize();
 }
 
+bool
+BthHeader::HasReth(uint8_t opcode)
+{
+    return opcode == OP_WRITE_FIRST || opcode == OP_WRITE_ONLY || opcode == OP_READ_REQUEST;
+}
+
+bool
+BthHeader::IsLast(uint8_t opcode)
+{
+    return opcode == OP_SEND_LAST || opcode == OP_SEND_ONLY ||
+           opcode == OP_WRITE_LAST || opcode == OP_WRITE_ONLY ||
+           opcode == OP_READ_REQUEST ||
+           opcode == OP_READ_RESPONSE_LAST || opcode == OP_READ_RESPONSE_ONLY;
+}
+
 uint8_t
 BthHeader::GetOpcode()
 {
@@ -124,6 +149,32 @@ BthHeader::SetNACK()
     m_flags |= (0x01 << 2);
 }
 
+uint8_t
+BthHeader::GetSACK() const
+{
+    return (m_flags >> 3) & 0x01;
+}
+
+void
+BthHeader::SetSACK(uint16_t segment, uint64_t bitmap)
+{
+    m_flags |= (0x01 << 3);
+    m_sackSegment = segment;
+    m_sackBitmap = bitmap;
+}
+
+uint16_t
+BthHeader::GetSackSegment()
+{
+    return m_sackSegment;
+}
+
+uint64_t
+BthHeader::GetSackBitmap()
+{
+    return m_sackBitmap;
+}
+
 uint16_t
 BthHeader::GetSize()
 {
@@ -21,6 +21,26 @@ public:
     uint32_t Deserialize(Buffer::Iterator start) override;
     uint32_t GetSerializedSize() const override;
 
+    // RC opcodes of the InfiniBand specification
+    static const uint8_t OP_SEND_FIRST = 0x00;
+    static const uint8_t OP_SEND_MIDDLE = 0x01;
+    static const uint8_t OP_SEND_LAST = 0x02;
+    static const uint8_t OP_SEND_ONLY = 0x04;
+    static const uint8_t OP_WRITE_FIRST = 0x06;
+    static const uint8_t OP_WRITE_MIDDLE = 0x07;
+    static const uint8_t OP_WRITE_LAST = 0x08;
+    static const uint8_t OP_WRITE_ONLY = 0x0A;
+    static const uint8_t OP_READ_REQUEST = 0x0C;
+    static const uint8_t OP_READ_RESPONSE_FIRST = 0x0D;
+    static const uint8_t OP_READ_RESPONSE_MIDDLE = 0x0E;
+    static const uint8_t OP_READ_RESPONSE_LAST = 0x0F;
+    static const uint8_t OP_READ_RESPONSE_ONLY = 0x10;
+    static const uint8_t OP_ACK = 0x11;
+
+    // WRITE FIRST/ONLY and READ REQUEST are followed by a RethHeader
+    static bool HasReth(uint8_t opcode);
+    static bool IsLast(uint8_t opcode);
+
     uint8_t GetOpcode();
     void SetOpcode(uint8_t opcode);
 
@@ -33,6 +53,14 @@ public:
     uint8_t GetNACK();
     void SetNACK();
 
+    // Selective ACK extension: bit i of the bitmap covers the segment that
+    // starts i segments after the cumulative sequence
+    static const uint32_t SACK_BITS = 64;
+    uint8_t GetSACK() const;
+    void SetSACK(uint16_t segment, uint64_t bitmap);
+    uint16_t GetSackSegment();
+    uint64_t GetSackBitmap();
+
     uint16_t GetSize();
     void SetSize(uint16_t size);
 
@@ -50,6 +78,8 @@ protected:
     uint16_t m_size;
     uint32_t m_id;
     uint32_t m_sequence;
+    uint16_t m_sackSegment;
+    uint64_t m_sackBitmap;
 };
 
 } // namespace ns3
@@ -47,11 +47,35 @@ ControlNode::GetTypeId()
 }
 
 ControlNode::ControlNode() : Node() {
-    Simulator::Schedule(Seconds(2), &ControlNode::ClearFlow, this);
+    Construct();
+}
+
+ControlNode::ControlNode(uint32_t systemId) : Node(systemId) {
+    Construct();
+}
+
+void
+ControlNode::Construct()
+{
+    m_random = CreateObject<UniformRandomVariable>();
+}
+
+void
+ControlNode::DoInitialize()
+{
+    // The switches may run in other partitions or ranks, so paths are
+    // computed from a copy of their routes rather than by asking them
+    for(const auto& sw : m_switches)
+        m_routes[sw->GetID()] = sw->GetRouteTable();
+    m_switches.clear();
+    if(GetSystemId() == Simulator::GetSystemId())
+        Simulator::Schedule(Seconds(2), &ControlNode::ClearFlow, this);
+    Node::DoInitialize();
 }
 
 ControlNode::~ControlNode(){
-    fclose(fout);
+    if(fout != nullptr)
+        fclose(fout);
 }
 
 uint32_t
@@ -117,18 +141,22 @@ ControlNode::SetTopology(uint32_t K,
     m_K = K;
     m_NUM_BLOCK = NUM_BLOCK;
     m_RATIO = RATIO;
-    m_servers = servers;
-    m_edges = edges;
-    m_aggs = aggs;
-    m_cores = cores;
-
-    if(m_servers.size() != K * K * NUM_BLOCK * RATIO - 1)
+    m_servers = servers.size();
+    m_edges = edges.size();
+    m_aggs = aggs.size();
+    m_cores = cores.size();
+    m_switches.clear();
+    m_switches.insert(m_switches.end(), edges.begin(), edges.end());
+    m_switches.insert(m_switches.end(), aggs.begin(), aggs.end());
+    m_switches.insert(m_switches.end(), cores.begin(), cores.end());
+
+    if(m_servers != K * K * NUM_BLOCK * RATIO - 1)
         std::cout << "Number of NICs Error" << std::endl;
-    if(m_edges.size() != K * NUM_BLOCK)
+    if(m_edges != K * NUM_BLOCK)
         std::cout << "Number of Edges Error" << std::endl;
-    if(m_aggs.size() != K * NUM_BLOCK)
+    if(m_aggs != K * NUM_BLOCK)
         std::cout << "Number of Aggs Error" << std::endl;
-    if(m_cores.size() != K * K)
+    if(m_cores != K * K)
         std::cout << "Number of Cores Error" << std::endl;
 }
 
@@ -137,23 +165,12 @@ ControlNode::SetOutput(std::string output)
 {
     m_output = output;
 
+    if(fout != nullptr)
+        fclose(fout);
     std::string out_file = m_output + ".collector";
     fout = fopen(out_file.c_str(), "w");
 }
 
-Ptr<Node> 
-ControlNode::GetNode(uint16_t id)
-{
-    if(id < 2000)
-        return m_servers[id - 1000];
-    else if(id < 3000)
-        return  m_edges[id - 2000];
-    else if(id < 4000)
-        return m_aggs[id - 3000];
-    else
-        return m_cores[id - 4000];
-}
-
 bool
 ControlNode::ProcessNICData4(CommandHeader cmd)
 {
@@ -177,7 +194,7 @@ ControlNode::ProcessNICData4(CommandHeader cmd)
     while(tmpId != dstId){
         uint16_t devId;
         if(tmpId != srcId)
-            label = AllocateLabel(GetNode(tmpId));
+            label = AllocateLabel(tmpId);
         vec.emplace_back(tmpId, label);
         if(label == 1)
             return false;
@@ -186,23 +203,16 @@ ControlNode::ProcessNICData4(CommandHeader cmd)
             devId = 1;
             tmpId = 2000 + (tmpId - 1000) / m_K / m_RATIO;
         }
-        else if(tmpId < 3000){
-            devId = m_edges[tmpId - 2000]->GetNextDev(id);
-            tmpId = m_edges[tmpId - 2000]->GetNextNode(devId);
-        }
-        else if(tmpId < 4000){
-            devId = m_aggs[tmpId - 3000]->GetNextDev(id);
-            tmpId = m_aggs[tmpId - 3000]->GetNextNode(devId);
-        }
         else{
-            devId = m_cores[tmpId - 4000]->GetNextDev(id);
-            tmpId = m_cores[tmpId - 4000]->GetNextNode(devId);
+            const SwitchNode::RouteTable& route = m_routes[tmpId];
+            devId = route.GetNextDev(id);
+            tmpId = route.GetNextNode(devId);
         }
 
         devVec.push_back(devId);
     }
 
-    label = AllocateLabel(GetNode(dstId));
+    label = AllocateLabel(dstId);
     vec.emplace_back(dstId, label);
     if(label == 1)
         return false;
@@ -215,9 +225,8 @@ ControlNode::ProcessNICData4(CommandHeader cmd)
     Simulator::Schedule(NanoSeconds(10000), &ControlNode::GenNICUpdateCompress4, this, id, vec[0].first, vec[1].second);
 
     for(uint32_t i = 0;i < vec.size();++i){
-        Ptr<Node> ptr = GetNode(vec[i].first);
-        m_label4[ptr][vec[i].second] = id;
-        m_flow4[ptr][id] = vec[i].second;
+        m_label4[vec[i].first][vec[i].second] = id;
+        m_flow4[vec[i].first][id] = vec[i].second;
     }
 
     m_flowUpdate += 1;
@@ -248,7 +257,7 @@ ControlNode::ProcessNICData6(CommandHeader cmd)
     while(tmpId != dstId){
         uint16_t devId;
         if(tmpId != srcId)
-            label = AllocateLabel(GetNode(tmpId));
+            label = AllocateLabel(tmpId);
         vec.emplace_back(tmpId, label);
         if(label == 1){
             return false;
@@ -258,23 +267,16 @@ ControlNode::ProcessNICData6(CommandHeader cmd)
             devId = 1;
             tmpId = 2000 + (tmpId - 1000) / m_K / m_RATIO;
         }
-        else if(tmpId < 3000){
-            devId = m_edges[tmpId - 2000]->GetNextDev(id);
-            tmpId = m_edges[tmpId - 2000]->GetNextNode(devId);
-        }
-        else if(tmpId < 4000){
-            devId = m_aggs[tmpId - 3000]->GetNextDev(id);
-            tmpId = m_aggs[tmpId - 3000]->GetNextNode(devId);
-        }
         else{
-            devId = m_cores[tmpId - 4000]->GetNextDev(id);
-            tmpId = m_cores[tmpId - 4000]->GetNextNode(devId);
+            const SwitchNode::RouteTable& route = m_routes[tmpId];
+            devId = route.GetNextDev(id);
+            tmpId = route.GetNextNode(devId);
         }
 
         devVec.push_back(devId);
     }
 
-    label = AllocateLabel(GetNode(dstId));
+    label = AllocateLabel(dstId);
     vec.emplace_back(dstId, label);
     if(label == 1){
         return false;
@@ -288,9 +290,8 @@ ControlNode::ProcessNICData6(CommandHeader cmd)
     Simulator::Schedule(NanoSeconds(10000), &ControlNode::GenNICUpdateCompress6, this, id, vec[0].first, vec[1].second);
 
     for(uint32_t i = 0;i < vec.size();++i){
-        Ptr<Node> ptr = GetNode(vec[i].first);
-        m_label6[ptr][vec[i].second] = id;
-        m_flow6[ptr][id] = vec[i].second;
+        m_label6[vec[i].first][vec[i].second] = id;
+        m_flow6[vec[i].first][id] = vec[i].second;
     }
 
     m_flowUpdate += 1;
@@ -299,7 +300,7 @@ ControlNode::ProcessNICData6(CommandHeader cmd)
 }
 
 uint16_t 
-ControlNode::AllocateLabel(Ptr<Node> node)
+ControlNode::AllocateLabel(uint16_t node)
 {
     std::unordered_map<uint16_t, FlowV4Id>& mp4 = m_label4[node];
     std::unordered_map<uint16_t, FlowV6Id>& mp6 = m_label6[node];
@@ -310,7 +311,7 @@ ControlNode::AllocateLabel(Ptr<Node> node)
     }
 
     for(uint32_t i = 0;i < 10;++i){
-        uint32_t number = rand() % 61703 + 1025;
+        uint32_t number = m_random->GetInteger(1025, 62727);
         if(mp4.find(number) == mp4.end() && mp6.find(number) == mp6.end())
             return number;
     }
@@ -422,14 +423,12 @@ ControlNode::SendCommand(CommandHeader& cmd)
     Ptr<Packet> packet = Create<Packet>();
     packet->AddHeader(cmd);
 
-    SocketPriorityTag tag;
-    tag.SetPriority(0);
-    packet->ReplacePacketTag(tag);
+    packet->SetSlot(Packet::SLOT_PRIORITY, 0);
     m_devices[1]->Send(packet, m_devices[1]->GetBroadcast(), 0x0170);
 }
 
 void 
-ControlNode::ClearNode(Ptr<Node> node)
+ControlNode::ClearNode(uint16_t node)
 {
     std::map<FlowV4Id, uint16_t>& mp4 = m_flow4[node];
     std::map<FlowV6Id, uint16_t>& mp6 = m_flow6[node];
@@ -463,36 +462,19 @@ ControlNode::ClearNode(Ptr<Node> node)
             uint16_t dstId = m_K * m_RATIO * ((id.m_dstIP >> 16) & 0xff) + ((id.m_dstIP >> 8) & 0xff) + 1000;
 
             uint16_t tmpId = srcId;
-            std::map<FlowV4Id, std::vector<Ptr<Node>>> mp;
+            std::map<FlowV4Id, std::vector<uint16_t>> mp;
 
             while(tmpId != dstId){
-                uint16_t devId;
-                Ptr<Node> tmpNode;
-                if(tmpId < 2000){
-                    tmpNode = m_servers[tmpId - 1000];
-                    devId = 1;
+                mp[id].push_back(tmpId);
+                if(tmpId < 2000)
                     tmpId = 2000 + (tmpId - 1000) / m_K / m_RATIO;
-                }
-                else if(tmpId < 3000){
-                    tmpNode = m_edges[tmpId - 2000];
-                    devId = m_edges[tmpId - 2000]->GetNextDev(id);
-                    tmpId = m_edges[tmpId - 2000]->GetNextNode(devId);
-                }
-                else if(tmpId < 4000){
-                    tmpNode =  m_aggs[tmpId - 3000];
-                    devId = m_aggs[tmpId - 3000]->GetNextDev(id);
-                    tmpId = m_aggs[tmpId - 3000]->GetNextNode(devId);
-                }
                 else{
-                    tmpNode = m_cores[tmpId - 4000];
-                    devId = m_cores[tmpId - 4000]->GetNextDev(id);
-                    tmpId = m_cores[tmpId - 4000]->GetNextNode(devId);
+                    const SwitchNode::RouteTable& route = m_routes[tmpId];
+                    tmpId = route.GetNextNode(route.GetNextDev(id));
                 }
-
-                mp[id].push_back(tmpNode);
             }
 
-            mp[id].push_back(GetNode(dstId));
+            mp[id].push_back(dstId);
             m_delete4.insert(id);
             m_delete += 1;
 
@@ -510,36 +492,19 @@ ControlNode::ClearNode(Ptr<Node> node)
             uint16_t dstId = m_K * m_RATIO * ((id.m_dstIP[0] >> 24) & 0xffff) + ((id.m_dstIP[0] >> 40) & 0xffff) + 1000;
 
             uint16_t tmpId = srcId;
-            std::map<FlowV6Id, std::vector<Ptr<Node>>> mp;
+            std::map<FlowV6Id, std::vector<uint16_t>> mp;
 
             while(tmpId != dstId){
-                uint16_t devId;
-                Ptr<Node> tmpNode;
-                if(tmpId < 2000){
-                    tmpNode = m_servers[tmpId - 1000];
-                    devId = 1;
+                mp[id].push_back(tmpId);
+                if(tmpId < 2000)
                     tmpId = 2000 + (tmpId - 1000) / m_K / m_RATIO;
-                }
-                else if(tmpId < 3000){
-                    tmpNode = m_edges[tmpId - 2000];
-                    devId = m_edges[tmpId - 2000]->GetNextDev(id);
-                    tmpId = m_edges[tmpId - 2000]->GetNextNode(devId);
-                }
-                else if(tmpId < 4000){
-                    tmpNode =  m_aggs[tmpId - 3000];
-                    devId = m_aggs[tmpId - 3000]->GetNextDev(id);
-                    tmpId = m_aggs[tmpId - 3000]->GetNextNode(devId);
-                }
                 else{
-                    tmpNode = m_cores[tmpId - 4000];
-                    devId = m_cores[tmpId - 4000]->GetNextDev(id);
-                    tmpId = m_cores[tmpId - 4000]->GetNextNode(devId);
+                    const SwitchNode::RouteTable& route = m_routes[tmpId];
+                    tmpId = route.GetNextNode(route.GetNextDev(id));
                 }
-
-                mp[id].push_back(tmpNode);
             }
 
-            mp[id].push_back(GetNode(dstId));
+            mp[id].push_back(dstId);
             m_delete6.insert(id);
             m_delete += 1;
             
@@ -550,7 +515,7 @@ ControlNode::ClearNode(Ptr<Node> node)
 }
 
 void 
-ControlNode::EraseFlow4(const std::map<FlowV4Id, std::vector<Ptr<Node>>>&  mp)
+ControlNode::EraseFlow4(const std::map<FlowV4Id, std::vector<uint16_t>>&  mp)
 {
     for(auto it = mp.begin();it != mp.end();++it){
         for(auto ptr : it->second){
@@ -563,7 +528,7 @@ ControlNode::EraseFlow4(const std::map<FlowV4Id, std::vector<Ptr<Node>>>&  mp)
 }
     
 void 
-ControlNode::EraseFlow6(const std::map<FlowV6Id, std::vector<Ptr<Node>>>&  mp)
+ControlNode::EraseFlow6(const std::map<FlowV6Id, std::vector<uint16_t>>&  mp)
 {
     for(auto it = mp.begin();it != mp.end();++it){
         for(auto ptr : it->second){
@@ -578,24 +543,14 @@ ControlNode::EraseFlow6(const std::map<FlowV6Id, std::vector<Ptr<Node>>>&  mp)
 void 
 ControlNode::ClearFlow()
 {
-    for(auto node : m_servers){
-        if(m_flow4[node].size() + m_flow6[node].size() > 0.8 * m_labelSize)
-            ClearNode(node);
-    }
-
-    for(auto node : m_edges){
-        if(m_flow4[node].size() + m_flow6[node].size() > 0.8 * m_labelSize)
-            ClearNode(node);
-    }
-    
-    for(auto node : m_aggs){
-        if(m_flow4[node].size() + m_flow6[node].size() > 0.8 * m_labelSize)
-            ClearNode(node); 
-    }
-    
-    for(auto node : m_cores){
-        if(m_flow4[node].size() + m_flow6[node].size() > 0.8 * m_labelSize)
-            ClearNode(node);  
+    // Servers are numbered from 1000, edges from 2000, aggs from 3000 and cores from 4000
+    std::vector<std::pair<uint16_t, size_t>> ranges = {
+        {1000, m_servers}, {2000, m_edges}, {3000, m_aggs}, {4000, m_cores}};
+    for(auto& range : ranges){
+        for(uint16_t node = range.first; node < range.first + range.second; ++node){
+            if(m_flow4[node].size() + m_flow6[node].size() > 0.8 * m_labelSize)
+                ClearNode(node);
+        }
     }
     
     if(m_data > 0 || m_delete > 0){
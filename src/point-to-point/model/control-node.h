@@ -2,6 +2,7 @@
 #define CONTROL_NODE_H
 
 #include "ns3/node.h"
+#include "ns3/random-variable-stream.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv6-header.h"
 
@@ -33,6 +34,10 @@ class ControlNode : public Node
     static TypeId GetTypeId();
 
     ControlNode();
+    /**
+     * \param systemId the partition of the controller in a parallel simulation
+     */
+    ControlNode(uint32_t systemId);
     virtual ~ControlNode();
 
     /**
@@ -82,7 +87,7 @@ class ControlNode : public Node
     const uint64_t m_clearPeriod = 40000000; // 40ms
 
     std::string m_output;
-    FILE* fout;
+    FILE* fout = nullptr;
 
     uint32_t m_labelSize = 16384;
     uint32_t m_nid;
@@ -90,16 +95,24 @@ class ControlNode : public Node
 	uint32_t m_K;
     uint32_t m_NUM_BLOCK;
 	uint32_t m_RATIO;
-    std::vector<Ptr<Node>> m_servers;
-	std::vector<Ptr<SwitchNode>> m_edges;
-	std::vector<Ptr<SwitchNode>> m_aggs;
-	std::vector<Ptr<SwitchNode>> m_cores;
+    uint32_t m_servers{0};
+    uint32_t m_edges{0};
+    uint32_t m_aggs{0};
+    uint32_t m_cores{0};
+
+    // Every rank of an MPI run builds all the switches, their routes and
+    // hash seeds are copied in DoInitialize, indexed by node id, and the
+    // switches are not referenced after that
+    std::vector<Ptr<SwitchNode>> m_switches;
+    std::unordered_map<uint16_t, SwitchNode::RouteTable> m_routes;
+    Ptr<UniformRandomVariable> m_random;
 
-    std::unordered_map<Ptr<Node>, std::unordered_map<uint16_t, FlowV4Id>> m_label4;
-    std::unordered_map<Ptr<Node>, std::unordered_map<uint16_t, FlowV6Id>> m_label6;
+    // Indexed by node id
+    std::unordered_map<uint16_t, std::unordered_map<uint16_t, FlowV4Id>> m_label4;
+    std::unordered_map<uint16_t, std::unordered_map<uint16_t, FlowV6Id>> m_label6;
 
-    std::unordered_map<Ptr<Node>, std::map<FlowV4Id, uint16_t>> m_flow4;
-    std::unordered_map<Ptr<Node>, std::map<FlowV6Id, uint16_t>> m_flow6;
+    std::unordered_map<uint16_t, std::map<FlowV4Id, uint16_t>> m_flow4;
+    std::unordered_map<uint16_t, std::map<FlowV6Id, uint16_t>> m_flow6;
 
     std::set<FlowV4Id> m_delete4;
     std::set<FlowV6Id> m_delete6;
@@ -109,9 +122,7 @@ class ControlNode : public Node
 
 	bool ProcessNICData4(CommandHeader cmd);
     bool ProcessNICData6(CommandHeader cmd);
-    uint16_t AllocateLabel(Ptr<Node> node);
-
-    Ptr<Node> GetNode(uint16_t id);
+    uint16_t AllocateLabel(uint16_t node);
 
     void GenNICUpdateCompress4(FlowV4Id id, uint16_t nodeId, uint16_t label);
     void GenNICUpdateCompress6(FlowV6Id id, uint16_t nodeId, uint16_t label);
@@ -124,13 +135,16 @@ class ControlNode : public Node
 
     void SendCommand(CommandHeader& cmd);
 
-    void EraseFlow4(const std::map<FlowV4Id, std::vector<Ptr<Node>>>& mp);
-    void EraseFlow6(const std::map<FlowV6Id, std::vector<Ptr<Node>>>& mp);
+    void EraseFlow4(const std::map<FlowV4Id, std::vector<uint16_t>>& mp);
+    void EraseFlow6(const std::map<FlowV6Id, std::vector<uint16_t>>& mp);
 
     void GenSwitchUpdate(std::pair<uint16_t, uint16_t> mp, uint16_t newLabel, uint32_t devId);
 
-    void ClearNode(Ptr<Node> node);
+    void ClearNode(uint16_t node);
     void ClearFlow();
+
+    void Construct();
+    void DoInitialize() override;
 };
 
 } // namespace ns3
@@ -4,10 +4,6 @@
 
 #include "port-header.h"
 
-#include "ipv4-tag.h"
-#include "ipv6-tag.h"
-#include "hctcp-tag.h"
-
 namespace ns3
 {
 
@@ -35,38 +31,34 @@ IdealCompressor::~IdealCompressor()
 uint16_t 
 IdealCompressor::Process(Ptr<Packet> packet, Ipv4Header header)
 {
-    PortHeader port_header;
-    packet->RemoveHeader(port_header);
+    Ptr<IdealMetadata> metadata = Create<IdealMetadata>();
+    metadata->version = 4;
+    metadata->ipv4Header = header;
+    packet->RemoveHeader(metadata->portHeader);
     if(header.GetProtocol() == 6)
-        AddHcTcpTag(packet);
-    Ipv4Tag ipv4Tag;
-    ipv4Tag.SetHeader(header, port_header);
-    packet->ReplacePacketTag(ipv4Tag);
+        RemoveHcTcp(packet, *metadata);
+    packet->SetSideChannel(metadata);
     return 0x0171;
 }
 	
 uint16_t 
 IdealCompressor::Process(Ptr<Packet> packet, Ipv6Header header)
 {
-    PortHeader port_header;
-    packet->RemoveHeader(port_header);
+    Ptr<IdealMetadata> metadata = Create<IdealMetadata>();
+    metadata->version = 6;
+    metadata->ipv6Header = header;
+    packet->RemoveHeader(metadata->portHeader);
     if(header.GetNextHeader() == Ipv6Header::IPV6_TCP)
-        AddHcTcpTag(packet);
-    Ipv6Tag ipv6Tag;
-    ipv6Tag.SetHeader(header, port_header);
-    packet->ReplacePacketTag(ipv6Tag);
+        RemoveHcTcp(packet, *metadata);
+    packet->SetSideChannel(metadata);
     return 0x0171;
 }
 
 void
-IdealCompressor::AddHcTcpTag(Ptr<Packet> packet)
+IdealCompressor::RemoveHcTcp(Ptr<Packet> packet, IdealMetadata& metadata)
 {
-    HcTcpHeader tcpHeader;
-    packet->RemoveHeader(tcpHeader);
-
-    HcTcpTag tcpTag;
-    tcpTag.SetHeader(tcpHeader);
-    packet->ReplacePacketTag(tcpTag);
+    packet->RemoveHeader(metadata.hcTcpHeader);
+    metadata.hasTcp = true;
 }
 
-} // namespace ns3
\ No newline at end of file
+} // namespace ns3
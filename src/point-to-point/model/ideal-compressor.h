@@ -7,6 +7,8 @@
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv6-header.h"
 
+#include "ideal-metadata.h"
+
 namespace ns3
 {
 
@@ -22,7 +24,7 @@ class IdealCompressor : public Object
 		uint16_t Process(Ptr<Packet> packet, Ipv6Header header);
 
 	private:
-		void AddHcTcpTag(Ptr<Packet> packet);
+		void RemoveHcTcp(Ptr<Packet> packet, IdealMetadata& metadata);
 };
 
 } // namespace ns3
@@ -3,11 +3,7 @@
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv6-header.h"
 
-#include "port-header.h"
-
-#include "ipv4-tag.h"
-#include "ipv6-tag.h"
-#include "hctcp-tag.h"
+#include "ideal-metadata.h"
 
 namespace ns3
 {
@@ -36,34 +32,23 @@ IdealDecompressor ::~IdealDecompressor ()
 uint16_t 
 IdealDecompressor::Process(Ptr<Packet> packet)
 {
-    HcTcpTag tcpTag;
-    if (packet->PeekPacketTag(tcpTag)){
-        HcTcpHeader tcpHeader = tcpTag.GetHeader();
-        packet->AddHeader(tcpHeader);
+    Ptr<const IdealMetadata> metadata = DynamicCast<const IdealMetadata>(packet->GetSideChannel());
+    if(metadata == nullptr){
+        std::cerr << "No ideal metadata found in packet." << std::endl;
+        return 0;
     }
+    packet->SetSideChannel(nullptr);
 
-    Ipv4Header ipv4_header;
-    Ipv6Header ipv6_header;
-    PortHeader port_header;
+    if(metadata->hasTcp)
+        packet->AddHeader(metadata->hcTcpHeader);
+    packet->AddHeader(metadata->portHeader);
 
-    Ipv4Tag ipv4Tag;
-    Ipv6Tag ipv6Tag;
-    if (packet->PeekPacketTag(ipv4Tag)){
-        ipv4Tag.GetHeader(ipv4_header, port_header);
-        packet->AddHeader(port_header);
-        packet->AddHeader(ipv4_header);
+    if(metadata->version == 4){
+        packet->AddHeader(metadata->ipv4Header);
         return 0x0800;
     }
-    else if(packet->PeekPacketTag(ipv6Tag)){
-        ipv6Tag.GetHeader(ipv6_header, port_header);
-        packet->AddHeader(port_header);
-        packet->AddHeader(ipv6_header);
-        return 0x86DD;
-    }
-    else {
-        std::cerr << "No IPv4 or IPv6 tag found in packet." << std::endl;
-        return 0;
-    }
+    packet->AddHeader(metadata->ipv6Header);
+    return 0x86DD;
 }
 
-} // namespace ns3
\ No newline at end of file
+} // namespace ns3
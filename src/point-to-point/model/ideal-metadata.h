@@ -0,0 +1,38 @@
+#ifndef IDEAL_METADATA_H
+#define IDEAL_METADATA_H
+
+#include "ns3/packet-side-channel.h"
+
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv6-header.h"
+
+#include "port-header.h"
+#include "hctcp-header.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point
+ *
+ * \brief Headers elided by ideal compression, kept by value on the packet
+ */
+class IdealMetadata : public PacketSideChannel
+{
+  public:
+    Ptr<PacketSideChannel> Copy() const override
+    {
+        return Create<IdealMetadata>(*this);
+    }
+
+    uint8_t version{0};
+    bool hasTcp{false};
+    Ipv4Header ipv4Header;
+    Ipv6Header ipv6Header;
+    PortHeader portHeader;
+    HcTcpHeader hcTcpHeader;
+};
+
+} // namespace ns3
+
+#endif /* IDEAL_METADATA_H */
@@ -0,0 +1,117 @@
+#include "int-tag.h"
+
+#include "ns3/log.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("IntTag");
+
+NS_OBJECT_ENSURE_REGISTERED(IntTag);
+
+TypeId
+IntTag::GetTypeId()
+{
+    static TypeId tid = TypeId("IntTag")
+                            .SetParent<Tag>()
+                            .AddConstructor<IntTag>();
+    return tid;
+}
+
+TypeId
+IntTag::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+IntTag::GetSerializedSize() const
+{
+    return 10 + m_nHops * 28;
+}
+
+void
+IntTag::Serialize(TagBuffer i) const
+{
+    i.WriteU64(m_timestamp);
+    i.WriteU8(m_echo);
+    i.WriteU8(m_nHops);
+    for(uint32_t j = 0; j < m_nHops; ++j){
+        i.WriteU64(m_hops[j].time);
+        i.WriteU64(m_hops[j].txBytes);
+        i.WriteU32(m_hops[j].qlen);
+        i.WriteU64(m_hops[j].rate);
+    }
+}
+
+void
+IntTag::Deserialize(TagBuffer i)
+{
+    m_timestamp = i.ReadU64();
+    m_echo = i.ReadU8();
+    m_nHops = i.ReadU8();
+    for(uint32_t j = 0; j < m_nHops; ++j){
+        m_hops[j].time = i.ReadU64();
+        m_hops[j].txBytes = i.ReadU64();
+        m_hops[j].qlen = i.ReadU32();
+        m_hops[j].rate = i.ReadU64();
+    }
+}
+
+void
+IntTag::SetTimestamp(int64_t time)
+{
+    m_timestamp = time;
+}
+
+int64_t
+IntTag::GetTimestamp() const
+{
+    return m_timestamp;
+}
+
+void
+IntTag::SetEcho()
+{
+    m_echo = true;
+}
+
+bool
+IntTag::IsEcho() const
+{
+    return m_echo;
+}
+
+void
+IntTag::PushHop(int64_t time, uint64_t txBytes, uint32_t qlen, uint64_t rate)
+{
+    if(m_nHops >= MAX_HOPS){
+        NS_LOG_WARN("Too many hops for INT, dropping the telemetry of this hop");
+        return;
+    }
+    m_hops[m_nHops].time = time;
+    m_hops[m_nHops].txBytes = txBytes;
+    m_hops[m_nHops].qlen = qlen;
+    m_hops[m_nHops].rate = rate;
+    m_nHops += 1;
+}
+
+uint32_t
+IntTag::GetNHops() const
+{
+    return m_nHops;
+}
+
+const IntTag::Hop&
+IntTag::GetHop(uint32_t index) const
+{
+    return m_hops[index];
+}
+
+void
+IntTag::Print(std::ostream& os) const
+{
+    os << "ts=" << m_timestamp << " hops=" << uint32_t(m_nHops);
+}
+
+} // namespace ns3
@@ -0,0 +1,61 @@
+#ifndef INT_TAG_H
+#define INT_TAG_H
+
+#include "ns3/tag.h"
+
+namespace ns3
+{
+
+/**
+ * \brief Telemetry carried by RDMA data packets and echoed back in the ACK
+ *
+ * The sender stamps the send time, every device with IntEnabled appends
+ * a hop record on the way to the receiver, which copies the tag into the
+ * ACK with the echo flag set so the reverse path leaves it untouched.
+ */
+class IntTag : public Tag
+{
+  public:
+    static const uint32_t MAX_HOPS = 8;
+
+    struct Hop
+    {
+        int64_t time;     // ns
+        uint64_t txBytes; // bytes transmitted by the port so far
+        uint32_t qlen;    // bytes queued at the port
+        uint64_t rate;    // link rate in bps
+    };
+
+    /**
+     * \brief Get the type ID.
+     * \return The object TypeId.
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+
+    uint32_t GetSerializedSize() const override;
+    void Serialize(TagBuffer i) const override;
+    void Deserialize(TagBuffer i) override;
+
+    void SetTimestamp(int64_t time);
+    int64_t GetTimestamp() const;
+
+    void SetEcho();
+    bool IsEcho() const;
+
+    void PushHop(int64_t time, uint64_t txBytes, uint32_t qlen, uint64_t rate);
+    uint32_t GetNHops() const;
+    const Hop& GetHop(uint32_t index) const;
+
+    void Print(std::ostream& os) const override;
+
+  private:
+    int64_t m_timestamp{0};
+    bool m_echo{false};
+    uint8_t m_nHops{0};
+    Hop m_hops[MAX_HOPS];
+};
+
+} // namespace ns3
+
+#endif /* INT_TAG_H */
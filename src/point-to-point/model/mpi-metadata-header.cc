@@ -0,0 +1,141 @@
+#include "mpi-metadata-header.h"
+
+#include "ns3/log.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("MpiMetadataHeader");
+
+NS_OBJECT_ENSURE_REGISTERED(MpiMetadataHeader);
+
+MpiMetadataHeader::MpiMetadataHeader()
+{
+    m_slotMask = 0;
+    for (uint32_t i = 0; i < Packet::SLOT_COUNT; ++i)
+        m_slots[i] = 0;
+    m_hasIdeal = false;
+}
+
+MpiMetadataHeader::~MpiMetadataHeader()
+{
+}
+
+TypeId
+MpiMetadataHeader::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::MpiMetadataHeader")
+                            .SetParent<Header>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<MpiMetadataHeader>();
+    return tid;
+}
+
+TypeId
+MpiMetadataHeader::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+void
+MpiMetadataHeader::Print(std::ostream& os) const
+{
+    os << "slots=" << (uint32_t)m_slotMask << " ideal=" << m_hasIdeal;
+}
+
+uint32_t
+MpiMetadataHeader::GetSerializedSize() const
+{
+    uint32_t size = 2 + 4 * Packet::SLOT_COUNT;
+    if (m_hasIdeal)
+    {
+        size += 2;
+        size += (m_ideal.version == 4) ? m_ideal.ipv4Header.GetSerializedSize()
+                                       : m_ideal.ipv6Header.GetSerializedSize();
+        size += m_ideal.portHeader.GetSerializedSize();
+        if (m_ideal.hasTcp)
+            size += m_ideal.hcTcpHeader.GetSerializedSize();
+    }
+    return size;
+}
+
+void
+MpiMetadataHeader::Serialize(Buffer::Iterator start) const
+{
+    start.WriteU8(m_slotMask);
+    for (uint32_t i = 0; i < Packet::SLOT_COUNT; ++i)
+        start.WriteHtonU32(m_slots[i]);
+    start.WriteU8(m_hasIdeal);
+    if (!m_hasIdeal)
+        return;
+
+    start.WriteU8(m_ideal.version);
+    start.WriteU8(m_ideal.hasTcp);
+    if (m_ideal.version == 4)
+    {
+        m_ideal.ipv4Header.Serialize(start);
+        start.Next(m_ideal.ipv4Header.GetSerializedSize());
+    }
+    else
+    {
+        m_ideal.ipv6Header.Serialize(start);
+        start.Next(m_ideal.ipv6Header.GetSerializedSize());
+    }
+    m_ideal.portHeader.Serialize(start);
+    start.Next(m_ideal.portHeader.GetSerializedSize());
+    if (m_ideal.hasTcp)
+        m_ideal.hcTcpHeader.Serialize(start);
+}
+
+uint32_t
+MpiMetadataHeader::Deserialize(Buffer::Iterator start)
+{
+    m_slotMask = start.ReadU8();
+    for (uint32_t i = 0; i < Packet::SLOT_COUNT; ++i)
+        m_slots[i] = start.ReadNtohU32();
+    m_hasIdeal = start.ReadU8();
+    if (m_hasIdeal)
+    {
+        m_ideal.version = start.ReadU8();
+        m_ideal.hasTcp = start.ReadU8();
+        if (m_ideal.version == 4)
+            start.Next(m_ideal.ipv4Header.Deserialize(start));
+        else
+            start.Next(m_ideal.ipv6Header.Deserialize(start));
+        start.Next(m_ideal.portHeader.Deserialize(start));
+        if (m_ideal.hasTcp)
+            m_ideal.hcTcpHeader.Deserialize(start);
+    }
+    return GetSerializedSize();
+}
+
+void
+MpiMetadataHeader::Save(Ptr<const Packet> packet)
+{
+    m_slotMask = 0;
+    for (uint32_t i = 0; i < Packet::SLOT_COUNT; ++i)
+    {
+        if (packet->PeekSlot(static_cast<Packet::MetadataSlot>(i), m_slots[i]))
+            m_slotMask |= (1 << i);
+        else
+            m_slots[i] = 0;
+    }
+    Ptr<const IdealMetadata> ideal = DynamicCast<const IdealMetadata>(packet->GetSideChannel());
+    m_hasIdeal = (ideal != nullptr);
+    if (m_hasIdeal)
+        m_ideal = *ideal;
+}
+
+void
+MpiMetadataHeader::Restore(Ptr<Packet> packet) const
+{
+    for (uint32_t i = 0; i < Packet::SLOT_COUNT; ++i)
+    {
+        if ((m_slotMask >> i) & 1)
+            packet->SetSlot(static_cast<Packet::MetadataSlot>(i), m_slots[i]);
+    }
+    if (m_hasIdeal)
+        packet->SetSideChannel(Create<IdealMetadata>(m_ideal));
+}
+
+} // namespace ns3
@@ -0,0 +1,48 @@
+#ifndef MPI_METADATA_HEADER_H
+#define MPI_METADATA_HEADER_H
+
+#include "ideal-metadata.h"
+
+#include "ns3/header.h"
+#include "ns3/packet.h"
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point
+ *
+ * \brief Packet slots and ideal compression metadata across an MPI link
+ *
+ * Neither survives Packet::Serialize. The remote channel saves them in
+ * this header in front of the packet and the receiving device restores
+ * them, so it never counts against the simulated packet size.
+ */
+class MpiMetadataHeader : public Header
+{
+  public:
+
+    MpiMetadataHeader();
+    ~MpiMetadataHeader() override;
+
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+
+    void Print(std::ostream& os) const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    uint32_t GetSerializedSize() const override;
+
+    void Save(Ptr<const Packet> packet);
+    void Restore(Ptr<Packet> packet) const;
+
+  private:
+    uint8_t m_slotMask;
+    uint32_t m_slots[Packet::SLOT_COUNT];
+    bool m_hasIdeal;
+    IdealMetadata m_ideal;
+};
+
+} // namespace ns3
+
+#endif /* MPI_METADATA_HEADER_H */
@@ -18,7 +18,7 @@ PfcHeader::PfcHeader()
 {
     m_opcode = 0;
     m_mask = 0;
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < PRIORITY_NUM; ++i)
         m_pause[i] = 0;
 }
 
@@ -51,7 +51,7 @@ PfcHeader::Print(std::ostream& os) const
 uint32_t
 PfcHeader::GetSerializedSize() const
 {
-    return 12;
+    return 4 + 2 * PRIORITY_NUM;
 }
 
 void
@@ -59,7 +59,7 @@ PfcHeader::Serialize(Buffer::Iterator start) const
 {
     start.WriteHtonU16(m_opcode);
     start.WriteHtonU16(m_mask);
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < PRIORITY_NUM; ++i)
         start.WriteHtonU16(m_pause[i]);
 }
 
@@ -68,17 +68,17 @@ PfcHeader::Deserialize(Buffer::Iterator start)
 {
     m_opcode = start.ReadNtohU16();
     m_mask = start.ReadNtohU16();
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < PRIORITY_NUM; ++i)
         m_pause[i] = start.ReadNtohU16();
     return GetSerializedSize();
 }
 
 void
-PfcHeader::SetPause(uint8_t id)
+PfcHeader::SetPause(uint8_t id, uint16_t quanta)
 {
     m_opcode = 0x0101;
     m_mask |= (1 << id);
-    m_pause[id] = 1;
+    m_pause[id] = quanta;
 }
 
 void
@@ -95,4 +95,10 @@ PfcHeader::GetPause(uint8_t id)
     return m_pause[id];
 }
 
+uint16_t
+PfcHeader::GetMask()
+{
+    return m_mask;
+}
+
 } // namespace ns3
@@ -21,15 +21,19 @@ class PfcHeader : public Header
     uint32_t Deserialize(Buffer::Iterator start) override;
     uint32_t GetSerializedSize() const override;
 
-    void SetPause(uint8_t id);
+    static const uint8_t PRIORITY_NUM = 8;
+
+    // Pause time is in quanta of 512 bit times, 0 resumes the class
+    void SetPause(uint8_t id, uint16_t quanta = 0xffff);
     void SetResume(uint8_t id);
 
     uint16_t GetPause(uint8_t id);
+    uint16_t GetMask();
 
   private:
 	  uint16_t m_opcode;
-    uint16_t m_mask;
-    uint16_t m_pause[4];
+    uint16_t m_mask; // class-enable vector
+    uint16_t m_pause[PRIORITY_NUM];
 };
 
 } // namespace ns3
@@ -0,0 +1,230 @@
+#include "point-to-point-aqm.h"
+
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("PointToPointAqm");
+
+NS_OBJECT_ENSURE_REGISTERED(PointToPointAqm);
+NS_OBJECT_ENSURE_REGISTERED(StepAqm);
+NS_OBJECT_ENSURE_REGISTERED(RedAqm);
+NS_OBJECT_ENSURE_REGISTERED(PieAqm);
+
+TypeId
+PointToPointAqm::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::PointToPointAqm")
+                            .SetParent<Object>()
+                            .SetGroupName("PointToPoint")
+                            .AddAttribute("MarkOnDequeue",
+                                          "Mark when a packet leaves the queue instead of when it joins",
+                                          BooleanValue(false),
+                                          MakeBooleanAccessor(&PointToPointAqm::m_markOnDequeue),
+                                          MakeBooleanChecker());
+    return tid;
+}
+
+PointToPointAqm::PointToPointAqm()
+{
+    m_random = CreateObject<UniformRandomVariable>();
+}
+
+PointToPointAqm::~PointToPointAqm()
+{
+}
+
+bool
+PointToPointAqm::IsMarkOnDequeue() const
+{
+    return m_markOnDequeue;
+}
+
+void
+PointToPointAqm::NotifyDequeue(uint32_t bytes, uint32_t backlog)
+{
+}
+
+TypeId
+StepAqm::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::StepAqm")
+                            .SetParent<PointToPointAqm>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<StepAqm>()
+                            .AddAttribute("Threshold",
+                                          "Mark every packet while the backlog exceeds this many bytes",
+                                          UintegerValue(100000),
+                                          MakeUintegerAccessor(&StepAqm::m_threshold),
+                                          MakeUintegerChecker<uint32_t>());
+    return tid;
+}
+
+StepAqm::StepAqm()
+{
+}
+
+StepAqm::~StepAqm()
+{
+}
+
+bool
+StepAqm::ShouldMark(uint32_t backlog)
+{
+    return backlog > m_threshold;
+}
+
+TypeId
+RedAqm::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::RedAqm")
+                            .SetParent<PointToPointAqm>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<RedAqm>()
+                            .AddAttribute("MinTh",
+                                          "Average backlog in bytes where marking starts",
+                                          UintegerValue(50000),
+                                          MakeUintegerAccessor(&RedAqm::m_minTh),
+                                          MakeUintegerChecker<uint32_t>())
+                            .AddAttribute("MaxTh",
+                                          "Average backlog in bytes above which every packet is marked",
+                                          UintegerValue(200000),
+                                          MakeUintegerAccessor(&RedAqm::m_maxTh),
+                                          MakeUintegerChecker<uint32_t>())
+                            .AddAttribute("MaxP",
+                                          "Marking probability at MaxTh",
+                                          DoubleValue(0.01),
+                                          MakeDoubleAccessor(&RedAqm::m_maxP),
+                                          MakeDoubleChecker<double>(0, 1))
+                            .AddAttribute("Weight",
+                                          "EWMA weight of the instantaneous backlog",
+                                          DoubleValue(0.002),
+                                          MakeDoubleAccessor(&RedAqm::m_weight),
+                                          MakeDoubleChecker<double>(0, 1));
+    return tid;
+}
+
+RedAqm::RedAqm()
+{
+}
+
+RedAqm::~RedAqm()
+{
+}
+
+bool
+RedAqm::ShouldMark(uint32_t backlog)
+{
+    m_average = (1 - m_weight) * m_average + m_weight * backlog;
+    if(m_average < m_minTh)
+        return false;
+    if(m_average >= m_maxTh)
+        return true;
+    double prob = m_maxP * (m_average - m_minTh) / (m_maxTh - m_minTh);
+    return m_random->GetValue() < prob;
+}
+
+TypeId
+PieAqm::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::PieAqm")
+                            .SetParent<PointToPointAqm>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<PieAqm>()
+                            .AddAttribute("Target",
+                                          "Target queueing delay",
+                                          TimeValue(MicroSeconds(10)),
+                                          MakeTimeAccessor(&PieAqm::m_target),
+                                          MakeTimeChecker())
+                            .AddAttribute("Tupdate",
+                                          "Interval between probability updates",
+                                          TimeValue(MicroSeconds(10)),
+                                          MakeTimeAccessor(&PieAqm::m_tUpdate),
+                                          MakeTimeChecker())
+                            // RFC 8033 gains in 1/s, scaled up for microsecond targets
+                            .AddAttribute("Alpha",
+                                          "Gain on the deviation from the target delay",
+                                          DoubleValue(125),
+                                          MakeDoubleAccessor(&PieAqm::m_alpha),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("Beta",
+                                          "Gain on the change of the delay",
+                                          DoubleValue(1250),
+                                          MakeDoubleAccessor(&PieAqm::m_beta),
+                                          MakeDoubleChecker<double>(0));
+    return tid;
+}
+
+PieAqm::PieAqm()
+{
+}
+
+PieAqm::~PieAqm()
+{
+}
+
+void
+PieAqm::NotifyDequeue(uint32_t bytes, uint32_t backlog)
+{
+    Time now = Simulator::Now();
+    if(m_measuring){
+        m_dqCount += bytes;
+        if(m_dqCount >= DQ_THRESHOLD && now > m_dqStart){
+            double rate = m_dqCount / (now - m_dqStart).GetSeconds();
+            m_avgRate = (m_avgRate == 0) ? rate : 0.5 * m_avgRate + 0.5 * rate;
+            m_measuring = false;
+        }
+    }
+    if(!m_measuring && backlog >= DQ_THRESHOLD){
+        m_measuring = true;
+        m_dqStart = now;
+        m_dqCount = 0;
+    }
+}
+
+void
+PieAqm::UpdateProbability(uint32_t backlog)
+{
+    double qdelay = (m_avgRate > 0) ? backlog / m_avgRate : 0;
+    double target = m_target.GetSeconds();
+
+    double delta = m_alpha * (qdelay - target) + m_beta * (qdelay - m_qdelayOld);
+    // Small steps while the probability is low, as in RFC 8033
+    if(m_prob < 0.000001)
+        delta /= 2048;
+    else if(m_prob < 0.00001)
+        delta /= 512;
+    else if(m_prob < 0.0001)
+        delta /= 128;
+    else if(m_prob < 0.001)
+        delta /= 32;
+    else if(m_prob < 0.01)
+        delta /= 8;
+    else if(m_prob < 0.1)
+        delta /= 2;
+
+    m_prob = std::min(1.0, std::max(0.0, m_prob + delta));
+    if(qdelay == 0 && m_qdelayOld == 0)
+        m_prob *= 0.98;
+    m_qdelayOld = qdelay;
+}
+
+bool
+PieAqm::ShouldMark(uint32_t backlog)
+{
+    Time now = Simulator::Now();
+    if(now >= m_nextUpdate){
+        UpdateProbability(backlog);
+        m_nextUpdate = now + m_tUpdate;
+    }
+
+    if(m_qdelayOld < m_target.GetSeconds() / 2 && m_prob < 0.2)
+        return false;
+    return m_random->GetValue() < m_prob;
+}
+
+} // namespace ns3
@@ -0,0 +1,112 @@
+#ifndef POINT_TO_POINT_AQM_H
+#define POINT_TO_POINT_AQM_H
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3
+{
+
+/**
+ * \brief ECN marking strategy for one traffic class of a PointToPointQueue
+ *
+ * The backlog passed in is the switch buffer accounting of its class in bytes,
+ * the other classes of the queue do not count.
+ * With MarkOnDequeue the queue consults the strategy when a packet leaves,
+ * so the mark reflects the queue it left behind rather than the one it joined.
+ */
+class PointToPointAqm : public Object
+{
+	public:
+		static TypeId GetTypeId();
+
+		PointToPointAqm();
+		~PointToPointAqm() override;
+
+		bool IsMarkOnDequeue() const;
+
+		virtual bool ShouldMark(uint32_t backlog) = 0;
+		virtual void NotifyDequeue(uint32_t bytes, uint32_t backlog);
+
+	protected:
+		bool m_markOnDequeue;
+		Ptr<UniformRandomVariable> m_random;
+};
+
+/**
+ * \brief DCTCP style step marking above a fixed threshold
+ */
+class StepAqm : public PointToPointAqm
+{
+	public:
+		static TypeId GetTypeId();
+
+		StepAqm();
+		~StepAqm() override;
+
+		bool ShouldMark(uint32_t backlog) override;
+
+	private:
+		uint32_t m_threshold;
+};
+
+/**
+ * \brief RED on an EWMA of the backlog, linear ramp from MinTh to MaxTh
+ */
+class RedAqm : public PointToPointAqm
+{
+	public:
+		static TypeId GetTypeId();
+
+		RedAqm();
+		~RedAqm() override;
+
+		bool ShouldMark(uint32_t backlog) override;
+
+	private:
+		uint32_t m_minTh;
+		uint32_t m_maxTh;
+		double m_maxP;
+		double m_weight;
+		double m_average{0};
+};
+
+/**
+ * \brief PIE (RFC 8033) with the queueing delay derived from the measured drain rate
+ */
+class PieAqm : public PointToPointAqm
+{
+	public:
+		static TypeId GetTypeId();
+
+		PieAqm();
+		~PieAqm() override;
+
+		bool ShouldMark(uint32_t backlog) override;
+		void NotifyDequeue(uint32_t bytes, uint32_t backlog) override;
+
+	private:
+		static const uint32_t DQ_THRESHOLD = 16384;
+
+		void UpdateProbability(uint32_t backlog);
+
+		Time m_target;
+		Time m_tUpdate;
+		double m_alpha;
+		double m_beta;
+
+		double m_prob{0};
+		double m_qdelayOld{0};
+		Time m_nextUpdate;
+
+		// Departure rate measurement in bytes per second
+		double m_avgRate{0};
+		bool m_measuring{false};
+		Time m_dqStart;
+		uint32_t m_dqCount{0};
+};
+
+} // namespace ns3
+
+#endif /* POINT_TO_POINT_AQM_H */
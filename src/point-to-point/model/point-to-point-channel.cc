@@ -20,6 +20,7 @@
 #include "point-to-point-net-device.h"
 
 #include "ns3/log.h"
+#include "ns3/node.h"
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
 #include "ns3/trace-source-accessor.h"
@@ -82,6 +83,13 @@ PointToPointChannel::Attach(Ptr<PointToPointNetDevice> device)
         m_link[1].m_dst = m_link[0].m_src;
         m_link[0].m_state = IDLE;
         m_link[1].m_state = IDLE;
+
+        // Cached so that a transmission never touches the other node
+        Ptr<Node> node0 = m_link[0].m_src->GetNode();
+        Ptr<Node> node1 = m_link[1].m_src->GetNode();
+        m_link[0].m_dstNode = node1->GetId();
+        m_link[1].m_dstNode = node0->GetId();
+        m_link[0].m_remote = m_link[1].m_remote = (node0->GetSystemId() != node1->GetSystemId());
     }
 }
 
@@ -96,7 +104,20 @@ PointToPointChannel::TransmitStart(Ptr<const Packet> p, Ptr<PointToPointNetDevic
 
     uint32_t wire = src == m_link[0].m_src ? 0 : 1;
 
-    Simulator::ScheduleWithContext(m_link[wire].m_dst->GetNode()->GetId(),
+    if (m_link[wire].m_remote)
+    {
+        // The receiver runs on another thread when the simulation is
+        // parallel: hand it a deep copy and a plain device pointer, and
+        // skip the animation trace which would take a reference on it
+        Simulator::ScheduleWithContext(m_link[wire].m_dstNode,
+                                       txTime + m_delay,
+                                       &PointToPointNetDevice::Receive,
+                                       PeekPointer(m_link[wire].m_dst),
+                                       p->DeepCopy());
+        return true;
+    }
+
+    Simulator::ScheduleWithContext(m_link[wire].m_dstNode,
                                    txTime + m_delay,
                                    &PointToPointNetDevice::Receive,
                                    m_link[wire].m_dst,
@@ -129,6 +150,13 @@ PointToPointChannel::GetDevice(std::size_t i) const
     return GetPointToPointDevice(i);
 }
 
+PointToPointNetDevice*
+PointToPointChannel::PeekPointToPointDevice(std::size_t i) const
+{
+    NS_ASSERT(i < 2);
+    return PeekPointer(m_link[i].m_src);
+}
+
 Time
 PointToPointChannel::GetDelay() const
 {
@@ -101,6 +101,19 @@ class PointToPointChannel : public Channel
      */
     Ptr<NetDevice> GetDevice(std::size_t i) const override;
 
+    /**
+     * \brief Get PointToPointNetDevice corresponding to index i without
+     * taking a reference
+     *
+     * Reference counts are not atomic, so the device at the other end of
+     * a link between two partitions of a parallel simulation must only be
+     * reached through a plain pointer.
+     *
+     * \param i Index number of the device requested
+     * \returns pointer to the PointToPointNetDevice requested
+     */
+    PointToPointNetDevice* PeekPointToPointDevice(std::size_t i) const;
+
   protected:
     /**
      * \brief Get the delay associated with this channel
@@ -200,13 +213,17 @@ class PointToPointChannel : public Channel
         Link()
             : m_state(INITIALIZING),
               m_src(nullptr),
-              m_dst(nullptr)
+              m_dst(nullptr),
+              m_dstNode(0),
+              m_remote(false)
         {
         }
 
         WireState m_state;                //!< State of the link
         Ptr<PointToPointNetDevice> m_src; //!< First NetDevice
         Ptr<PointToPointNetDevice> m_dst; //!< Second NetDevice
+        uint32_t m_dstNode;               //!< Node id of the second NetDevice
+        bool m_remote; //!< Second NetDevice in another partition (system id)
     };
 
     Link m_link[N_DEVICES]; //!< Link model
@@ -23,6 +23,8 @@
 #include "mpls-header.h"
 #include "vxlan-header.h"
 #include "compress-ip-header.h"
+#include "rohc-header.h"
+#include "mpi-metadata-header.h"
 #include "switch-node.h"
 
 #include "ns3/error-model.h"
@@ -38,6 +40,9 @@
 #include "ns3/udp-header.h"
 
 #include "bth-header.h"
+#include "reth-header.h"
+#include "int-tag.h"
+#include "rdma-congestion-control.h"
 
 #include "point-to-point-queue.h"
 
@@ -82,6 +87,41 @@ PointToPointNetDevice::GetTypeId()
                           TimeValue(Seconds(0.0)),
                           MakeTimeAccessor(&PointToPointNetDevice::m_tInterframeGap),
                           MakeTimeChecker())
+            .AddAttribute("RdmaCc",
+                          "Congestion control type of the RDMA queue pairs",
+                          TypeIdValue(DcqcnCc::GetTypeId()),
+                          MakeTypeIdAccessor(&PointToPointNetDevice::m_ccType),
+                          MakeTypeIdChecker())
+            .AddAttribute("IntEnabled",
+                          "Append a hop record to packets carrying an IntTag",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&PointToPointNetDevice::m_int),
+                          MakeBooleanChecker())
+            .AddAttribute("RdmaMtu",
+                          "RoCE path MTU, the largest payload of an RDMA packet",
+                          UintegerValue(1400),
+                          MakeUintegerAccessor(&PointToPointNetDevice::m_rdmaMtu),
+                          MakeUintegerChecker<uint32_t>(256, 4096))
+            .AddAttribute("RdmaSelectiveRepeat",
+                          "Recover RDMA losses by selective repeat with SACK instead of go-back-N",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&PointToPointNetDevice::m_rdmaSack),
+                          MakeBooleanChecker())
+            .AddAttribute("RdmaLossless",
+                          "PFC keeps RDMA lossless, so go-back-N needs no timeout or repeated ACK",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&PointToPointNetDevice::m_rdmaLossless),
+                          MakeBooleanChecker())
+            .AddAttribute("RdmaRto",
+                          "Retransmission timeout of RDMA queue pairs, armed by selective repeat or without PFC",
+                          TimeValue(MicroSeconds(320)),
+                          MakeTimeAccessor(&PointToPointNetDevice::m_rdmaRto),
+                          MakeTimeChecker())
+            .AddAttribute("RohcContexts",
+                          "Number of ROHC contexts kept per direction on this link, the smaller of the two ends counts",
+                          UintegerValue(16384),
+                          MakeUintegerAccessor(&PointToPointNetDevice::m_rohcContexts),
+                          MakeUintegerChecker<uint16_t>(1))
 
             //
             // Transmit queueing discipline for the device which includes its own set
@@ -205,16 +245,66 @@ PointToPointNetDevice::SetID(uint32_t id)
     m_id = id;
 }
 
-bool
-PointToPointNetDevice::Available()
+void
+PointToPointNetDevice::AddQP(Ptr<RdmaQueuePair> qp)
 {
-    return m_queue->GetNBytes() < 20000;
+    m_rdmaQp[qp->GetQP()] = qp;
 }
 
 void
-PointToPointNetDevice::AddQP(Ptr<RdmaQueuePair> qp)
+PointToPointNetDevice::ActivateQP(Ptr<RdmaQueuePair> qp)
 {
-    m_rdmaQp[qp->GetQP()] = qp;
+    if(qp->IsScheduled() || !qp->HasPending())
+        return;
+    qp->SetScheduled(true);
+    m_qpReady.push_back(qp);
+    PullQP();
+}
+
+void
+PointToPointNetDevice::PullQP()
+{
+    // Only feed the queue when the link is idle, so QP packets never wait behind each other in it
+    if(m_txMachineState != READY || !m_queue->IsEmpty())
+        return;
+
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    while(!m_qpWaiting.empty() && m_qpWaiting.top().time <= now){
+        m_qpReady.push_back(m_qpWaiting.top().qp);
+        m_qpWaiting.pop();
+    }
+
+    while(!m_qpReady.empty()){
+        Ptr<RdmaQueuePair> qp = m_qpReady.front();
+        m_qpReady.pop_front();
+        if(!qp->HasPending()){
+            // Finished or window-limited, an ACK activates it again
+            qp->SetScheduled(false);
+            continue;
+        }
+        int64_t ready = qp->GetReadyTime();
+        if(ready > now){
+            m_qpWaiting.push(QpTimer{ready, qp});
+            continue;
+        }
+
+        Ptr<Packet> packet = qp->GetNextPacket();
+        ready = qp->GetReadyTime();
+        if(ready > now)
+            m_qpWaiting.push(QpTimer{ready, qp});
+        else
+            m_qpReady.push_back(qp);
+        Send(packet, GetBroadcast(), qp->GetProtocol());
+        return;
+    }
+
+    if(!m_qpWaiting.empty()){
+        Time wake = NanoSeconds(m_qpWaiting.top().time - now);
+        if(!m_qpWake.IsRunning() || wake < Simulator::GetDelayLeft(m_qpWake)){
+            m_qpWake.Cancel();
+            m_qpWake = Simulator::Schedule(wake, &PointToPointNetDevice::PullQP, this);
+        }
+    }
 }
 
 void
@@ -245,9 +335,30 @@ PointToPointNetDevice::DoDispose()
     m_receiveErrorModel = nullptr;
     m_currentPkt = nullptr;
     m_queue = nullptr;
+    for(uint32_t i = 0; i < PfcHeader::PRIORITY_NUM; ++i)
+        m_pfcExpire[i].Cancel();
+    m_qpWake.Cancel();
+    m_qpReady.clear();
+    m_qpWaiting = decltype(m_qpWaiting)();
+    m_ccPrototype = nullptr;
     NetDevice::DoDispose();
 }
 
+void
+PointToPointNetDevice::DoInitialize()
+{
+    NS_LOG_FUNCTION(this);
+    if (m_queue)
+    {
+        m_queue->Initialize();
+    }
+    if (m_rdma)
+    {
+        CreateCongestionControl();
+    }
+    NetDevice::DoInitialize();
+}
+
 void
 PointToPointNetDevice::SetDataRate(DataRate bps)
 {
@@ -279,10 +390,15 @@ PointToPointNetDevice::TransmitStart(Ptr<Packet> p)
     }
     else if(m_id != 0){
         p->RemoveHeader(ppp);
+        uint16_t protocol = PppToEther(ppp.GetProtocol());
         if(m_setting == CompressType::COMPRESS_ROHC && 
-            (ppp.GetProtocol() == 0x0800 || ppp.GetProtocol() == 0x86DD)){
-            uint16_t protocol = m_rohcCom.Process(p, ppp.GetProtocol());
+            (protocol == 0x0800 || protocol == 0x86DD)){
+            protocol = m_rohcCom.Process(p, protocol);
             ppp.SetProtocol(PointToPointNetDevice::EtherToPpp(protocol));
+            // A context refresh carries the full header
+            RohcHeader rohc_header;
+            if(protocol == 0x0172 && p->PeekHeader(rohc_header) && rohc_header.GetType() == 0)
+                m_compressedCount += 1;
         }
         p->AddHeader(ppp);
     }
@@ -295,6 +411,19 @@ PointToPointNetDevice::TransmitStart(Ptr<Packet> p)
     NS_ASSERT_MSG(m_txMachineState == READY, "Must be READY to transmit");
     m_txMachineState = BUSY;
     m_currentPkt = p;
+    if(p != nullptr){
+        m_txBytes += p->GetSize();
+        if(m_int){
+            IntTag tag;
+            if(p->PeekPacketTag(tag) && !tag.IsEcho()){
+                // The tag grows, so it cannot be replaced in place
+                tag.PushHop(Simulator::Now().GetNanoSeconds(), m_txBytes, m_queue->GetNBytes(), m_bps.GetBitRate());
+                IntTag old;
+                p->RemovePacketTag(old);
+                p->AddPacketTag(tag);
+            }
+        }
+    }
     //m_phyTxBeginTrace(m_currentPkt);
 
     //NS_LOG_LOGIC("Schedule TransmitCompleteEvent in " << txCompleteTime.As(Time::S));
@@ -335,10 +464,11 @@ PointToPointNetDevice::TransmitComplete()
     //m_phyTxEndTrace(m_currentPkt);
     m_currentPkt = nullptr;
 
-    Ptr<Packet> p = m_queue->Dequeue(m_pause);
+    Ptr<Packet> p = m_queue->Dequeue();
     if (!p)
     {
         NS_LOG_LOGIC("No pending packets in device queue after tx complete");
+        PullQP();
         return;
     }
 
@@ -359,6 +489,13 @@ PointToPointNetDevice::Attach(Ptr<PointToPointChannel> ch)
 
     m_channel->Attach(this);
 
+    // The peer may have set up ROHC with its own contexts alone
+    for(std::size_t i = 0; i < m_channel->GetNDevices(); ++i){
+        Ptr<PointToPointNetDevice> dev = DynamicCast<PointToPointNetDevice>(m_channel->GetDevice(i));
+        if(dev != nullptr)
+            dev->SetRohcContexts();
+    }
+
     //
     // This device is up whenever it is attached to a channel.  A better plan
     // would be to have the link come up when both devices are attached, but this
@@ -425,22 +562,18 @@ PointToPointNetDevice::Receive(Ptr<Packet> packet)
 
         if(protocol == 0x8808){
             // std::cout << "Find PFC" << std::endl;
-            PfcHeader pfc;
-            packet->RemoveHeader(pfc);
-            m_pause = (pfc.GetPause(2) != 0);
-
-            if(!m_pause && m_txMachineState == READY){
-                // std::cout << "Resume queue" << std::endl;
-                packet = m_queue->Dequeue(m_pause);
-                if(packet != nullptr) 
-                    TransmitStart(packet);
-            }
+            ReceivePfc(packet);
             return;
         }
 
         if(m_id != 0){
-            if(protocol == 0x0172)
+            if(protocol == 0x0172){
                 protocol = m_rohcDecom.Process(packet);
+                if(protocol == 0){
+                    m_phyRxDropTrace(originalPacket);
+                    return;
+                }
+            }
 
             bool decap = true;
             if(protocol == 0x0170){
@@ -574,13 +707,16 @@ PointToPointNetDevice::RdmaReceive(Ptr<Packet> packet, uint16_t protocol)
     BthHeader bth_header;
 
     Address srcAddr;
+    Address dstAddr;
 
     if(protocol == 0x0800) {
         packet->RemoveHeader(ipv4_header);
         srcAddr = ipv4_header.GetSource();
+        dstAddr = ipv4_header.GetDestination();
     } else if(protocol == 0x86DD) {
         packet->RemoveHeader(ipv6_header);
         srcAddr = ipv6_header.GetSource();
+        dstAddr = ipv6_header.GetDestination();
     } else{
         std::cerr << "Unknown protocol for RDMA" << std::endl;
         return;
@@ -595,50 +731,159 @@ PointToPointNetDevice::RdmaReceive(Ptr<Packet> packet, uint16_t protocol)
             std::cerr << "Unknown RDMA QP ID: " << id << " in NIC " << m_id << std::endl;
             return;
         }
-        m_rdmaQp[id]->ProcessACK(bth_header);
+        IntTag intTag;
+        bool hasInt = packet->PeekPacketTag(intTag);
+        m_rdmaQp[id]->ProcessACK(bth_header, hasInt ? &intTag : nullptr);
     } else {
+        uint8_t opcode = bth_header.GetOpcode();
+        RethHeader reth_header;
+        if(BthHeader::HasReth(opcode))
+            packet->RemoveHeader(reth_header);
+
         auto key = std::pair<Address, uint32_t>(srcAddr, id);
-        uint64_t preSeq = m_rdmaReceiver[key].first;
+        RdmaReceiverState& state = m_rdmaReceiver[key];
+        uint64_t preSeq = state.expected;
+        // Telemetry goes back to the sender in the ACK
+        IntTag intTag;
+        const IntTag* echo = packet->PeekPacketTag(intTag) ? &intTag : nullptr;
+        // Packets start on MTU boundaries and end at the sequence
         uint64_t seq = bth_header.GetSequence(preSeq);
+        uint64_t start = (seq - 1) / m_rdmaMtu * m_rdmaMtu;
+        bool accepted = false;
         // std::cout << "Receive: " << preSeq << " " << seq << " " << bth_header.GetSize() << std::endl;
-        if(seq <= preSeq) {
-            std::cout << "Duplicate or out-of-order packet" << std::endl;
-            return;
+        if(!m_rdmaSack){
+            if(seq <= preSeq) {
+                std::cout << "Duplicate or out-of-order packet" << std::endl;
+                // The ACK may have been dropped without PFC, repeat it
+                if(!m_rdmaLossless){
+                    if(protocol == 0x0800) SendACK(ipv4_header, key, false, echo);
+                    else if(protocol == 0x86DD) SendACK(ipv6_header, key, false, echo);
+                }
+            }
+            else if(start == preSeq) {
+                accepted = true;
+                state.expected = start + m_rdmaMtu;
+                if(protocol == 0x0800) SendACK(ipv4_header, key, false, echo);
+                else if(protocol == 0x86DD) SendACK(ipv6_header, key, false, echo);
+            }
+            else {
+                std::cerr << "RDMA sequence error: " << seq << " - " << state.expected
+                        << " not matching " << bth_header.GetSize() << std::endl;
+                if(protocol == 0x0800) SendACK(ipv4_header, key, true, echo);
+                else if(protocol == 0x86DD) SendACK(ipv6_header, key, true, echo);
+            }
         }
-        else if(seq - preSeq == bth_header.GetSize()) {
-            m_rdmaReceiver[key].first = seq;
-            if(protocol == 0x0800) SendACK(ipv4_header, key);
-            else if(protocol == 0x86DD) SendACK(ipv6_header, key);
+        else{
+            // Selective repeat: every arrival is answered, a gap turns the ACK into a NACK
+            bool inOrder = false;
+            accepted = RdmaAccept(state, start, seq, inOrder);
+            if(protocol == 0x0800) SendACK(ipv4_header, key, !inOrder, echo);
+            else if(protocol == 0x86DD) SendACK(ipv6_header, key, !inOrder, echo);
         }
-        else {
-            std::cerr << "RDMA sequence error: " << seq << " - " << m_rdmaReceiver[key].first
-                    << " not matching " << bth_header.GetSize() << std::endl;
-            if(protocol == 0x0800) SendACK(ipv4_header, key, true);
-            else if(protocol == 0x86DD) SendACK(ipv6_header, key, true);
+
+        if(accepted && (opcode == BthHeader::OP_READ_REQUEST ||
+            opcode == BthHeader::OP_READ_RESPONSE_LAST || opcode == BthHeader::OP_READ_RESPONSE_ONLY))
+            state.verbs[start] = std::make_pair(opcode, reth_header.GetLength());
+        RdmaDeliver(state, id, dstAddr, srcAddr);
+    }
+}
+
+bool
+PointToPointNetDevice::RdmaAccept(RdmaReceiverState& state, uint64_t start, uint64_t seq, bool& inOrder)
+{
+    if(seq <= state.expected){
+        // Duplicate of delivered data, the ACK tells the sender so
+        inOrder = true;
+        return false;
+    }
+    if(start == state.expected){
+        inOrder = true;
+        state.expected = start + m_rdmaMtu;
+        state.ooo >>= 1;
+        while(state.ooo[0]){
+            state.expected += m_rdmaMtu;
+            state.ooo >>= 1;
+        }
+        return true;
+    }
+
+    inOrder = false;
+    uint64_t index = (start - state.expected) / m_rdmaMtu;
+    if(index >= RdmaReceiverState::OOO_WINDOW)
+        return false; // beyond the bitmap, the sender retransmits it later
+    if(state.ooo[index])
+        return false;
+    state.ooo[index] = true;
+    return true;
+}
+
+void
+PointToPointNetDevice::RdmaDeliver(RdmaReceiverState& state, uint32_t id, Address localAddr, Address remoteAddr)
+{
+    // Verbs with side effects run once everything before them has arrived
+    while(!state.verbs.empty() && state.verbs.begin()->first < state.expected){
+        uint8_t opcode = state.verbs.begin()->second.first;
+        uint32_t length = state.verbs.begin()->second.second;
+        state.verbs.erase(state.verbs.begin());
+
+        if(opcode == BthHeader::OP_READ_REQUEST){
+            // The responder answers on a QP with the same number towards the requester
+            auto it = m_rdmaQp.find(id);
+            Ptr<RdmaQueuePair> qp;
+            if(it != m_rdmaQp.end())
+                qp = it->second;
+            else
+                qp = Create<RdmaQueuePair>(this, localAddr, remoteAddr, id);
+            qp->PostSend(RdmaQueuePair::READ_RESPONSE, length, 0);
+        }
+        else if(m_rdmaQp.find(id) != m_rdmaQp.end())
+            m_rdmaQp[id]->CompleteRead();
+        else
+            std::cerr << "READ response for unknown QP " << id << " in NIC " << m_id << std::endl;
+    }
+}
+
+void
+PointToPointNetDevice::SetAckFlags(BthHeader& bth, RdmaReceiverState& state, bool ce, bool isNack)
+{
+    if(isNack)
+        bth.SetNACK();
+    else
+        bth.SetACK();
+
+    // Go-back-N treats a NACK as congestion, selective repeat only reacts to CE
+    if(ce || (isNack && !m_rdmaSack)){
+        bth.SetCNP();
+        state.cnpTime = Simulator::Now().GetNanoSeconds();
+    }
+
+    if(m_rdmaSack && state.ooo.any()){
+        uint64_t bitmap = 0;
+        for(uint32_t i = 0; i < BthHeader::SACK_BITS; ++i){
+            if(state.ooo[i])
+                bitmap |= (uint64_t(1) << i);
         }
+        bth.SetSACK(m_rdmaMtu, bitmap);
     }
 }
 
 void 
-PointToPointNetDevice::SendACK(Ipv4Header& header, std::pair<Address, uint32_t> key, bool isNack)
+PointToPointNetDevice::SendACK(Ipv4Header& header, std::pair<Address, uint32_t> key, bool isNack, const IntTag* echo)
 {
     Ptr<Packet> packet = Create<Packet>();
+    if(echo != nullptr){
+        IntTag tag = *echo;
+        tag.SetEcho();
+        packet->AddPacketTag(tag);
+    }
 
     BthHeader bth_header;
+    bth_header.SetOpcode(BthHeader::OP_ACK);
     bth_header.SetSize(0);
     bth_header.SetId(key.second);
-    bth_header.SetSequence(m_rdmaReceiver[key].first);
-    if(isNack) {
-        bth_header.SetNACK();
-        bth_header.SetCNP();
-        m_rdmaReceiver[key].second = Simulator::Now().GetNanoSeconds();
-    } else {
-        bth_header.SetACK();
-        if(header.GetEcn() == Ipv4Header::EcnType::ECN_CE){
-            bth_header.SetCNP();
-            m_rdmaReceiver[key].second = Simulator::Now().GetNanoSeconds();
-        }
-    }
+    RdmaReceiverState& state = m_rdmaReceiver[key];
+    bth_header.SetSequence(state.expected);
+    SetAckFlags(bth_header, state, header.GetEcn() == Ipv4Header::EcnType::ECN_CE, isNack);
     packet->AddHeader(bth_header);
 
     UdpHeader udp_header;
@@ -646,7 +891,7 @@ PointToPointNetDevice::SendACK(Ipv4Header& header, std::pair<Address, uint32_t>
 	udp_header.SetDestinationPort(key.second);
     packet->AddHeader(udp_header);
 
-    header.SetPayloadSize(20);
+    header.SetPayloadSize(packet->GetSize());
     header.SetTtl(64);
     Ipv4Address tmp = header.GetSource();
     header.SetSource(header.GetDestination());
@@ -657,25 +902,22 @@ PointToPointNetDevice::SendACK(Ipv4Header& header, std::pair<Address, uint32_t>
 }
 
 void 
-PointToPointNetDevice::SendACK(Ipv6Header& header, std::pair<Address, uint32_t> key, bool isNack)
+PointToPointNetDevice::SendACK(Ipv6Header& header, std::pair<Address, uint32_t> key, bool isNack, const IntTag* echo)
 {
     Ptr<Packet> packet = Create<Packet>();
+    if(echo != nullptr){
+        IntTag tag = *echo;
+        tag.SetEcho();
+        packet->AddPacketTag(tag);
+    }
 
     BthHeader bth_header;
+    bth_header.SetOpcode(BthHeader::OP_ACK);
     bth_header.SetSize(0);
     bth_header.SetId(key.second);
-    bth_header.SetSequence(m_rdmaReceiver[key].first);
-    if(isNack) {
-        bth_header.SetNACK();
-        bth_header.SetCNP();
-        m_rdmaReceiver[key].second = Simulator::Now().GetNanoSeconds();
-    } else {
-        bth_header.SetACK();
-        if(header.GetEcn() == Ipv6Header::EcnType::ECN_CE){
-            bth_header.SetCNP();
-            m_rdmaReceiver[key].second = Simulator::Now().GetNanoSeconds();
-        }
-    }
+    RdmaReceiverState& state = m_rdmaReceiver[key];
+    bth_header.SetSequence(state.expected);
+    SetAckFlags(bth_header, state, header.GetEcn() == Ipv6Header::EcnType::ECN_CE, isNack);
     packet->AddHeader(bth_header);
 
     UdpHeader udp_header;
@@ -683,7 +925,7 @@ PointToPointNetDevice::SendACK(Ipv6Header& header, std::pair<Address, uint32_t>
 	udp_header.SetDestinationPort(key.second);
     packet->AddHeader(udp_header);
 
-    header.SetPayloadLength(20);
+    header.SetPayloadLength(packet->GetSize());
     header.SetHopLimit(64);
     Ipv6Address tmp = header.GetSource();
     header.SetSource(header.GetDestination());
@@ -700,6 +942,72 @@ PointToPointNetDevice::GetQueue() const
     return m_queue;
 }
 
+DataRate
+PointToPointNetDevice::GetDataRate() const
+{
+    return m_bps;
+}
+
+void
+PointToPointNetDevice::ReceivePfc(Ptr<Packet> packet)
+{
+    PfcHeader pfc;
+    packet->RemoveHeader(pfc);
+    uint16_t mask = pfc.GetMask();
+    for(uint32_t i = 0; i < PfcHeader::PRIORITY_NUM; ++i){
+        if(!(mask & (1 << i)) || Simulator::Now() < m_pfcIgnoreUntil[i])
+            continue;
+        m_pfcExpire[i].Cancel();
+        uint16_t quanta = pfc.GetPause(i);
+        if(quanta == 0){
+            m_queue->SetPause(i, false);
+            continue;
+        }
+        // One quantum is 512 bit times at the link rate
+        m_queue->SetPause(i, true);
+        m_pfcExpire[i] = Simulator::Schedule(m_bps.CalculateBytesTxTime(quanta * 64),
+                                             &PointToPointNetDevice::PfcExpire, this, i);
+    }
+    TryTransmit();
+}
+
+void
+PointToPointNetDevice::PfcExpire(uint32_t cls)
+{
+    m_queue->SetPause(cls, false);
+    TryTransmit();
+}
+
+void
+PointToPointNetDevice::RecoverPfc(uint32_t cls, Time recovery)
+{
+    if(cls >= PfcHeader::PRIORITY_NUM)
+        return;
+    m_pfcRecoveryCount += 1;
+    m_pfcExpire[cls].Cancel();
+    m_pfcIgnoreUntil[cls] = Simulator::Now() + recovery;
+    m_queue->SetPause(cls, false);
+    TryTransmit();
+}
+
+uint64_t
+PointToPointNetDevice::GetPfcRecoveryCount() const
+{
+    return m_pfcRecoveryCount;
+}
+
+void
+PointToPointNetDevice::TryTransmit()
+{
+    if(m_txMachineState != READY)
+        return;
+    Ptr<Packet> packet = m_queue->Dequeue();
+    if(packet != nullptr)
+        TransmitStart(packet);
+    else
+        PullQP();
+}
+
 void
 PointToPointNetDevice::NotifyLinkUp()
 {
@@ -846,6 +1154,7 @@ PointToPointNetDevice::Send(Ptr<Packet> packet, const Address& dest, uint16_t pr
             if(m_setting == CompressType::COMPRESS_MPLS){
                 if(m_compress4.find(v4Id) != m_compress4.end()){
                     m_mplsCount += 1;
+                    m_compressedCount += 1;
                     PortHeader port_header;
                     packet->RemoveHeader(port_header);
                     CompressIpHeader compressIpHeader;
@@ -880,8 +1189,10 @@ PointToPointNetDevice::Send(Ptr<Packet> packet, const Address& dest, uint16_t pr
                     packet->AddHeader(ipv4_header);
                 }
             }
-            else if(m_setting == CompressType::COMPRESS_IDEAL)
+            else if(m_setting == CompressType::COMPRESS_IDEAL){
                 protocolNumber = m_idealCom.Process(packet, ipv4_header);
+                m_compressedCount += 1;
+            }
             else packet->AddHeader(ipv4_header);
         }
         else if(protocolNumber == 0x86DD){
@@ -898,6 +1209,7 @@ PointToPointNetDevice::Send(Ptr<Packet> packet, const Address& dest, uint16_t pr
             if(m_setting == CompressType::COMPRESS_MPLS){
                 if(m_compress6.find(v6Id) != m_compress6.end()){
                     m_mplsCount += 1;
+                    m_compressedCount += 1;
                     if(m_vxlan){
                         packet->AddHeader(ipv6_header);
                         DecapVxLAN(packet);
@@ -937,8 +1249,10 @@ PointToPointNetDevice::Send(Ptr<Packet> packet, const Address& dest, uint16_t pr
                     packet->AddHeader(ipv6_header);
                 }
             }
-            else if(m_setting == CompressType::COMPRESS_IDEAL)
+            else if(m_setting == CompressType::COMPRESS_IDEAL){
                 protocolNumber = m_idealCom.Process(packet, ipv6_header);
+                m_compressedCount += 1;
+            }
             else packet->AddHeader(ipv6_header);
         }
     }
@@ -961,7 +1275,7 @@ PointToPointNetDevice::Send(Ptr<Packet> packet, const Address& dest, uint16_t pr
         //
         if (m_txMachineState == READY)
         {
-            packet = m_queue->Dequeue(m_pause);
+            packet = m_queue->Dequeue();
             if(packet != nullptr)
             {
                 m_snifferTrace(packet);
@@ -1032,6 +1346,10 @@ void
 PointToPointNetDevice::DoMpiReceive(Ptr<Packet> p)
 {
     NS_LOG_FUNCTION(this << p);
+    // Added by the remote channel
+    MpiMetadataHeader metadata;
+    p->RemoveHeader(metadata);
+    metadata.Restore(p);
     Receive(p);
 }
 
@@ -1042,7 +1360,8 @@ PointToPointNetDevice::GetRemote() const
     NS_ASSERT(m_channel->GetNDevices() == 2);
     for (std::size_t i = 0; i < m_channel->GetNDevices(); ++i)
     {
-        Ptr<NetDevice> tmp = m_channel->GetDevice(i);
+        // No reference, the peer may be in another partition
+        const PointToPointNetDevice* tmp = m_channel->PeekPointToPointDevice(i);
         if (tmp != this)
         {
             return tmp->GetAddress();
@@ -1072,12 +1391,39 @@ void
 PointToPointNetDevice::SetSetting(int setting)
 {
     m_setting = CompressType(setting);
+    SetRohcContexts();
+}
+
+void
+PointToPointNetDevice::SetRohcContexts()
+{
+    if(m_setting == CompressType::COMPRESS_ROHC){
+        m_rohcCom.SetMaxContext(GetRohcContexts());
+        m_rohcDecom.SetMaxContent(GetRohcContexts());
+    }
+}
+
+uint16_t
+PointToPointNetDevice::GetRohcContexts() const
+{
+    // Both ends of a link keep the contexts of one direction, the
+    // compressor must not use more than the peer holds
+    uint16_t contexts = m_rohcContexts;
+    if(m_channel != nullptr){
+        for(std::size_t i = 0; i < m_channel->GetNDevices(); ++i){
+            Ptr<PointToPointNetDevice> dev = DynamicCast<PointToPointNetDevice>(m_channel->GetDevice(i));
+            if(dev != nullptr)
+                contexts = std::min(contexts, dev->m_rohcContexts);
+        }
+    }
+    return contexts;
 }
 
 void
 PointToPointNetDevice::SetVxLAN(uint32_t vxlan)
 {
     m_vxlan = vxlan;
+    m_rohcCom.SetVxLAN(vxlan);
 }
 
 void
@@ -1092,6 +1438,44 @@ PointToPointNetDevice::SetRdma(uint32_t rdma)
     m_rdma = rdma;
 }
 
+Ptr<RdmaCongestionControl>
+PointToPointNetDevice::CreateCongestionControl()
+{
+    if (m_ccPrototype == nullptr)
+    {
+        ObjectFactory factory;
+        factory.SetTypeId(m_ccType);
+        m_ccPrototype = factory.Create<RdmaCongestionControl>();
+    }
+    return m_ccPrototype->Copy();
+}
+
+uint32_t
+PointToPointNetDevice::GetRdmaMtu() const
+{
+    return m_rdmaMtu;
+}
+
+bool
+PointToPointNetDevice::IsSelectiveRepeat() const
+{
+    return m_rdmaSack;
+}
+
+bool
+PointToPointNetDevice::IsRdmaRtoEnabled() const
+{
+    // With PFC go-back-N only loses packets to corruption, and a long
+    // pause would fire a spurious timeout that rewinds the whole window
+    return m_rdmaSack || !m_rdmaLossless;
+}
+
+Time
+PointToPointNetDevice::GetRdmaRto() const
+{
+    return m_rdmaRto;
+}
+
 uint64_t 
 PointToPointNetDevice::GetUserCount()
 {
@@ -1116,26 +1500,40 @@ PointToPointNetDevice::SetMplsCount(uint64_t count)
     m_mplsCount = count;
 }
 
+uint64_t
+PointToPointNetDevice::GetCompressedCount()
+{
+    return m_compressedCount;
+}
+
+void
+PointToPointNetDevice::SetCompressedCount(uint64_t count)
+{
+    m_compressedCount = count;
+}
+
 void 
 PointToPointNetDevice::SetPriority(Ptr<Packet> packet, uint8_t protocol)
 {
-    SocketPriorityTag tag;
+    uint32_t priority = 0;
     if(protocol == 6){
         TcpHeader tcp_header;
         packet->PeekHeader(tcp_header);
         if(tcp_header.GetLength() * 4 == packet->GetSize())
-            tag.SetPriority(1);
+            priority = 1;
         else
-            tag.SetPriority(2);
+            priority = 2;
     } else if (protocol == 17) {
-        if(packet->GetSize() == 20)
-            tag.SetPriority(1);
+        // UDP header followed by the BTH opcode and flags, ACK or NACK bits set
+        uint8_t buf[10];
+        if(packet->GetSize() <= 30 && packet->CopyData(buf, 10) == 10 && (buf[9] & 0x06))
+            priority = 1;
         else 
-            tag.SetPriority(2);
+            priority = 2;
     } else {
         std::cout << "Unknown Protocol " << uint32_t(protocol) << " for SetPriority" << std::endl;
     }
-    packet->ReplacePacketTag(tag);
+    packet->SetSlot(Packet::SLOT_PRIORITY, priority);
 }
 
 void
@@ -1201,9 +1599,7 @@ PointToPointNetDevice::SendCommand(CommandHeader& cmd)
     cmd.SetDestinationId(0xffff);
     packet->AddHeader(cmd);
 
-    SocketPriorityTag tag;
-    tag.SetPriority(0);
-    packet->ReplacePacketTag(tag);
+    packet->SetSlot(Packet::SLOT_PRIORITY, 0);
 
     Send(packet, GetBroadcast(), 0x0170);
 }
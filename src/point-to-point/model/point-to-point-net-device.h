@@ -21,6 +21,7 @@
 #include "ns3/address.h"
 #include "ns3/callback.h"
 #include "ns3/data-rate.h"
+#include "ns3/event-id.h"
 #include "ns3/mac48-address.h"
 #include "ns3/net-device.h"
 #include "ns3/node.h"
@@ -32,6 +33,7 @@
 #include "ns3/point-to-point-queue.h"
 
 #include "command-header.h"
+#include "pfc-header.h"
 
 #include "rohc-compressor.h"
 #include "rohc-decompressor.h"
@@ -39,7 +41,10 @@
 #include "ideal-decompressor.h"
 #include "rdma-queue-pair.h"
 
+#include <bitset>
 #include <cstring>
+#include <deque>
+#include <queue>
 
 namespace ns3
 {
@@ -56,6 +61,8 @@ class PointToPointQueue;
 class PointToPointChannel;
 class ErrorModel;
 class RdmaQueuePair;
+class RdmaCongestionControl;
+class IntTag;
 
 /**
  * \defgroup point-to-point Point-To-Point Network Device
@@ -231,21 +238,36 @@ class PointToPointNetDevice : public NetDevice
      */
     static uint16_t EtherToPpp(uint16_t protocol);
 
-    bool Available();
-
     void AddQP(Ptr<RdmaQueuePair> qp);
+    // Hand a queue pair with data to the NIC arbiter, no-op if already scheduled
+    void ActivateQP(Ptr<RdmaQueuePair> qp);
 
     void SetID(uint32_t id);
     void SetSetting(int setting);
     void SetVxLAN(uint32_t vxlan);
+    uint16_t GetRohcContexts() const;
     void SetThreshold(uint32_t threshold);
     void SetOutput(std::string output);
     void SetRdma(uint32_t rdma);
+    Ptr<RdmaCongestionControl> CreateCongestionControl();
+    uint32_t GetRdmaMtu() const;
+    bool IsSelectiveRepeat() const;
+    bool IsRdmaRtoEnabled() const;
+    Time GetRdmaRto() const;
 
     uint64_t GetUserCount();
     uint64_t GetMplsCount();
     void SetUserCount(uint64_t count);
     void SetMplsCount(uint64_t count);
+    // User packets sent with a compressed header, whatever the compression
+    uint64_t GetCompressedCount();
+    void SetCompressedCount(uint64_t count);
+
+    DataRate GetDataRate() const;
+
+    // PFC watchdog action: lift the pause on cls and ignore pause frames for it until recovery ends
+    void RecoverPfc(uint32_t cls, Time recovery);
+    uint64_t GetPfcRecoveryCount() const;
 
   protected:
     /**
@@ -261,6 +283,12 @@ class PointToPointNetDevice : public NetDevice
      */
     void DoDispose() override;
 
+    /**
+     * \brief Build the queue and congestion control objects before the
+     * simulation runs, the attribute system is not thread-safe
+     */
+    void DoInitialize() override;
+
     /**
      * \returns the address of the remote device connected to this device
      * through the point to point channel.
@@ -477,7 +505,6 @@ class PointToPointNetDevice : public NetDevice
                                                          //   (promisc data)
     uint32_t m_ifIndex;                                  //!< Index of the interface
     bool m_linkUp;                                       //!< Identify if the link is up or not
-    bool m_pause{false};
     TracedCallback<> m_linkChangeCallbacks;              //!< Callback for the link change event
 
     static const uint16_t DEFAULT_MTU = 9000; //!< Default MTU
@@ -497,10 +524,12 @@ class PointToPointNetDevice : public NetDevice
     uint32_t m_id{0};
     uint32_t m_rdma{0};
     uint32_t m_vxlan{0};
-    CompressType m_setting;
+    uint16_t m_rohcContexts{16384};
+    CompressType m_setting{CompressType::COMPRESS_NONE};
 
     uint64_t m_userCount{0};
     uint64_t m_mplsCount{0};
+    uint64_t m_compressedCount{0};
 
     uint32_t m_threshold = 100;
     uint32_t m_dataPeriod = 100000000; // 100ms
@@ -521,12 +550,54 @@ class PointToPointNetDevice : public NetDevice
     std::map<FlowV6Id, std::pair<uint32_t, uint64_t>> m_v6count;
 
     std::unordered_map<uint32_t, Ptr<RdmaQueuePair>> m_rdmaQp;
-    std::map<std::pair<Address, uint32_t>, std::pair<uint64_t, uint64_t>> m_rdmaReceiver;
+
+    // QP arbiter: eligible QPs in round-robin order, token-limited ones by ready time
+    struct QpTimer
+    {
+        int64_t time;
+        Ptr<RdmaQueuePair> qp;
+        bool operator>(const QpTimer& other) const { return time > other.time; }
+    };
+    std::deque<Ptr<RdmaQueuePair>> m_qpReady;
+    std::priority_queue<QpTimer, std::vector<QpTimer>, std::greater<QpTimer>> m_qpWaiting;
+    EventId m_qpWake;
+    struct RdmaReceiverState
+    {
+        static const uint32_t OOO_WINDOW = 256;
+
+        uint64_t expected{0};
+        int64_t cnpTime{0};
+        // Selective repeat: MTU slots received past expected, bit i starts i slots later
+        std::bitset<OOO_WINDOW> ooo;
+        // READ requests and last READ responses waiting for the packets before them
+        std::map<uint64_t, std::pair<uint8_t, uint32_t>> verbs;
+    };
+    std::map<std::pair<Address, uint32_t>, RdmaReceiverState> m_rdmaReceiver;
+    uint32_t m_rdmaMtu;
+    bool m_rdmaSack;
+    bool m_rdmaLossless;
+    TypeId m_ccType;
+    Ptr<RdmaCongestionControl> m_ccPrototype; // copied for every queue pair
+    bool m_int;
+    uint64_t m_txBytes{0};
+    Time m_rdmaRto;
+
+    // Sizes the ROHC tables to the contexts of the link
+    void SetRohcContexts();
 
     void EncapVxLAN(Ptr<Packet> packet);
     void DecapVxLAN(Ptr<Packet> packet);
     void SetPriority(Ptr<Packet> packet, uint8_t priority);
 
+    void ReceivePfc(Ptr<Packet> packet);
+    void PfcExpire(uint32_t cls);
+    void TryTransmit();
+    void PullQP();
+
+    EventId m_pfcExpire[PfcHeader::PRIORITY_NUM];
+    Time m_pfcIgnoreUntil[PfcHeader::PRIORITY_NUM];
+    uint64_t m_pfcRecoveryCount{0};
+
     void GenData4(FlowV4Id id);
     void GenData6(FlowV6Id id);
 
@@ -539,9 +610,15 @@ class PointToPointNetDevice : public NetDevice
 
     void SendCommand(CommandHeader& cmd);
 
-    void SendACK(Ipv4Header& header, std::pair<Address, uint32_t> key, bool isNack = false);
-    void SendACK(Ipv6Header& header, std::pair<Address, uint32_t> key, bool isNack = false);
+    void SendACK(Ipv4Header& header, std::pair<Address, uint32_t> key, bool isNack = false,
+                 const IntTag* echo = nullptr);
+    void SendACK(Ipv6Header& header, std::pair<Address, uint32_t> key, bool isNack = false,
+                 const IntTag* echo = nullptr);
     void RdmaReceive(Ptr<Packet> packet, uint16_t protocol);
+    // Returns false if the packet only duplicates data already delivered
+    bool RdmaAccept(RdmaReceiverState& state, uint64_t start, uint64_t seq, bool& inOrder);
+    void RdmaDeliver(RdmaReceiverState& state, uint32_t id, Address localAddr, Address remoteAddr);
+    void SetAckFlags(BthHeader& bth, RdmaReceiverState& state, bool ce, bool isNack);
 };
 
 } // namespace ns3
@@ -2,20 +2,23 @@
 
 #include "ns3/abort.h"
 #include "ns3/enum.h"
+#include "ns3/object-factory.h"
+#include "ns3/type-id.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/uinteger.h"
 
 #include "ns3/socket.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
 #include "ns3/ipv4-header.h"
+#include "ns3/ipv6-header.h"
 #include "ns3/ppp-header.h"
 #include "ns3/tcp-header.h"
 
 #include "point-to-point-net-device.h"
 #include "mpls-header.h"
 
-#include "ipv4-tag.h"
-#include "ipv6-tag.h"
-#include "packet-tag.h"
+#include "ideal-metadata.h"
 
 namespace ns3
 {
@@ -33,217 +36,403 @@ PointToPointQueue::GetTypeId()
             .SetGroupName("PointToPoint")
             .AddConstructor<PointToPointQueue>()
             .AddAttribute(
-                "ECNThreshold",
-                "Threshold for ECN",
-                UintegerValue(100000),
-                MakeUintegerAccessor(&PointToPointQueue::m_ecnThreshold),
-                MakeUintegerChecker<uint32_t>());
+                "Aqm",
+                "ECN marking strategy type, one instance per marked class",
+                TypeIdValue(StepAqm::GetTypeId()),
+                MakeTypeIdAccessor(&PointToPointQueue::m_aqmType),
+                MakeTypeIdChecker())
+            .AddAttribute(
+                "AqmClasses",
+                "Bit mask of the classes marked by the ECN strategy",
+                UintegerValue(1 << 2),
+                MakeUintegerAccessor(&PointToPointQueue::m_aqmClasses),
+                MakeUintegerChecker<uint32_t>())
+            .AddAttribute(
+                "Scheduler",
+                "Scheduler type serving the traffic classes",
+                TypeIdValue(StrictPriorityScheduler::GetTypeId()),
+                MakeTypeIdAccessor(&PointToPointQueue::m_schedulerType),
+                MakeTypeIdChecker());
     return tid;
 }
 
+void
+PacketFifo::Push(Ptr<Packet> packet)
+{
+    if(m_count == m_ring.size())
+        Grow();
+    m_ring[(m_head + m_count) & (m_ring.size() - 1)] = packet;
+    m_count += 1;
+    m_bytes += packet->GetSize();
+}
+
+Ptr<Packet>
+PacketFifo::Pop()
+{
+    if(m_count == 0)
+        return nullptr;
+    Ptr<Packet> packet = m_ring[m_head];
+    m_ring[m_head] = nullptr;
+    m_head = (m_head + 1) & (m_ring.size() - 1);
+    m_count -= 1;
+    m_bytes -= packet->GetSize();
+    return packet;
+}
+
+Ptr<Packet>
+PacketFifo::Front() const
+{
+    if(m_count == 0)
+        return nullptr;
+    return m_ring[m_head];
+}
+
+void
+PacketFifo::Grow()
+{
+    std::vector<Ptr<Packet>> ring(m_ring.empty() ? 16 : m_ring.size() * 2);
+    for(uint32_t i = 0; i < m_count; ++i)
+        ring[i] = m_ring[(m_head + i) & (m_ring.size() - 1)];
+    m_ring.swap(ring);
+    m_head = 0;
+}
+
 PointToPointQueue::PointToPointQueue()
 {
-    for(uint32_t i = 0; i < 4; ++i){
-        m_queues.push_back(CreateObject<DropTailQueue<Packet>>());
-        m_queues[i]->SetMaxSize(QueueSize("16MiB"));
-    }
-    m_random = CreateObject<UniformRandomVariable>();
-    m_random->SetAttribute("Min", DoubleValue(0));
-    m_random->SetAttribute("Max", DoubleValue(1));
 }
 
 PointToPointQueue::~PointToPointQueue() {}
 
+void
+PointToPointQueue::DoInitialize()
+{
+    if(!m_aqmCreated)
+        CreateAqm();
+    GetScheduler();
+    Queue<Packet>::DoInitialize();
+}
+
 uint64_t
 PointToPointQueue::GetEcnCount()
 {
     return m_ecnCount;
 }
 
-bool
-PointToPointQueue::Enqueue(Ptr<Packet> item)
+void
+PointToPointQueue::CreateAqm()
 {
-    PppHeader ppp;
-    item->RemoveHeader(ppp);
-
-    uint16_t proto = ppp.GetProtocol();
+    ObjectFactory factory;
+    factory.SetTypeId(m_aqmType);
+    for(uint32_t i = 0; i < PRIORITY_NUM; ++i){
+        if((m_aqmClasses >> i) & 1)
+            m_aqm[i] = factory.Create<PointToPointAqm>();
+    }
+    m_aqmCreated = true;
+}
 
-    Ipv4Header ipv4_header;
-    Ipv6Header ipv6_header;
-    MplsHeader mpls_header;
-    PortHeader port_header;
+Ptr<PointToPointAqm>
+PointToPointQueue::GetAqm(uint32_t cls)
+{
+    if(!m_aqmCreated)
+        CreateAqm();
+    return cls < PRIORITY_NUM ? m_aqm[cls] : nullptr;
+}
 
-    switch (proto)
-    {
-    case 0x0021: item->RemoveHeader(ipv4_header); break; // IPv4
-    case 0x0057: item->RemoveHeader(ipv6_header); break; // IPv6
-    case 0x0281: item->RemoveHeader(mpls_header); break; // MPLS
-    default: break;
+Ptr<PointToPointScheduler>
+PointToPointQueue::GetScheduler()
+{
+    if(m_scheduler == nullptr){
+        ObjectFactory factory;
+        factory.SetTypeId(m_schedulerType);
+        m_scheduler = factory.Create<PointToPointScheduler>();
+        m_scheduler->SetClasses(PRIORITY_NUM);
     }
+    return m_scheduler;
+}
 
-    int priority = 0;
-    SocketPriorityTag socketPriorityTag;
-    if(item->PeekPacketTag(socketPriorityTag))
-        priority = socketPriorityTag.GetPriority();
-
-    if(priority == 2 && SetEcn()){
-        switch (proto)
-        {
-            case 0x0021:
-                if(ipv4_header.GetEcn() == Ipv4Header::ECN_ECT1 ||
-                    ipv4_header.GetEcn() == Ipv4Header::ECN_ECT0){
-                        m_ecnCount += 1;
-                        ipv4_header.SetEcn(Ipv4Header::ECN_CE);
-                    }
-                break;
-            case 0x0057:
-                if(ipv6_header.GetEcn() == Ipv6Header::ECN_ECT1 ||
-                    ipv6_header.GetEcn() == Ipv6Header::ECN_ECT0){
-                        m_ecnCount += 1;
-                        ipv6_header.SetEcn(Ipv6Header::ECN_CE);
-                    }
-                break;
-            case 0x0281:
-                if(mpls_header.GetExp() == MplsHeader::ECN_ECT1 ||
-                    mpls_header.GetExp() == MplsHeader::ECN_ECT0){
-                        m_ecnCount += 1;
-                        mpls_header.SetExp(MplsHeader::ECN_CE);
-                    }
-                break;
-            default: break;
-        }
-    }
+uint64_t
+PointToPointQueue::GetTxBytes(uint32_t cls)
+{
+    return GetScheduler()->GetTxBytes(cls);
+}
 
-    switch (proto)
-    {
-    case 0x0021: item->AddHeader(ipv4_header); break; // IPv4
-    case 0x0057: item->AddHeader(ipv6_header); break; // IPv6
-    case 0x0281: item->AddHeader(mpls_header); break; // MPLS
-    default: break;
+void
+PointToPointQueue::SetPause(uint32_t cls, bool pause)
+{
+    if(cls >= PRIORITY_NUM || pause == IsPaused(cls))
+        return;
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    if(pause){
+        m_paused |= (1 << cls);
+        m_pauseStart[cls] = now;
+        m_pauseCount[cls] += 1;
+    }
+    else{
+        m_paused &= ~(1 << cls);
+        m_pauseTime[cls] += now - m_pauseStart[cls];
     }
+}
 
-    if(proto == 0x0171 && priority == 2 && SetEcn()){
-        Ipv4Tag ipv4Tag;
-        Ipv6Tag ipv6Tag;
+bool
+PointToPointQueue::IsPaused(uint32_t cls) const
+{
+    return cls < PRIORITY_NUM && ((m_paused >> cls) & 1);
+}
 
-        if (item->PeekPacketTag(ipv4Tag)){
-            ipv4Tag.GetHeader(ipv4_header, port_header);
+uint64_t
+PointToPointQueue::GetPauseTime(uint32_t cls) const
+{
+    if(cls >= PRIORITY_NUM)
+        return 0;
+    return m_pauseTime[cls] + GetPausedFor(cls);
+}
 
-            if(ipv4_header.GetEcn() == Ipv4Header::ECN_ECT1 ||
-                ipv4_header.GetEcn() == Ipv4Header::ECN_ECT0){
-                m_ecnCount += 1;
-                ipv4_header.SetEcn(Ipv4Header::ECN_CE);
+uint64_t
+PointToPointQueue::GetPauseCount(uint32_t cls) const
+{
+    return cls < PRIORITY_NUM ? m_pauseCount[cls] : 0;
+}
 
-                ipv4Tag.SetHeader(ipv4_header, port_header);
-                item->ReplacePacketTag(ipv4Tag);
-            }
-        }
-        else if(item->PeekPacketTag(ipv6Tag)){
-            ipv6Tag.GetHeader(ipv6_header, port_header);
+uint64_t
+PointToPointQueue::GetPausedFor(uint32_t cls) const
+{
+    if(!IsPaused(cls))
+        return 0;
+    return Simulator::Now().GetNanoSeconds() - m_pauseStart[cls];
+}
 
-            if(ipv6_header.GetEcn() == Ipv6Header::ECN_ECT1 ||
-                ipv6_header.GetEcn() == Ipv6Header::ECN_ECT0){
-                m_ecnCount += 1;
-                ipv6_header.SetEcn(Ipv6Header::ECN_CE);
+uint32_t
+PointToPointQueue::GetNBytes(uint32_t cls) const
+{
+    return cls < PRIORITY_NUM ? m_queues[cls].GetNBytes() : 0;
+}
 
-                ipv6Tag.SetHeader(ipv6_header, port_header);
-                item->ReplacePacketTag(ipv6Tag);
-            }
-        }
-        else{
-            std::cout << "Fail to find tag" << std::endl;
-        }
+bool
+PointToPointQueue::Enqueue(Ptr<Packet> item)
+{
+    uint32_t priority = 0;
+    if(!item->PeekSlot(Packet::SLOT_PRIORITY, priority)){
+        SocketPriorityTag socketPriorityTag;
+        if(item->PeekPacketTag(socketPriorityTag))
+            priority = socketPriorityTag.GetPriority();
     }
 
-    item->AddHeader(ppp);
-    bool ret = m_queues[priority]->Enqueue(item);
-    if(!ret){
+    if(priority >= PRIORITY_NUM || m_queues[priority].GetNBytes() + item->GetSize() > PRIORITY_BYTES){
         std::cout << "Error in buffer " << priority << std::endl;
-        std::cout << "Buffer size " << m_queues[priority]->GetNBytes() << std::endl;
+        if(priority < PRIORITY_NUM)
+            std::cout << "Buffer size " << m_queues[priority].GetNBytes() << std::endl;
+        return false;
     }
 
-    PacketTag packetTag;
-    if(item->PeekPacketTag(packetTag))
-        m_ecnSize += packetTag.GetSize();
+    Ptr<PointToPointAqm> aqm = GetAqm(priority);
+    if(aqm != nullptr && !aqm->IsMarkOnDequeue() && aqm->ShouldMark(m_ecnSize[priority]) && MarkEcn(item))
+        m_ecnCount += 1;
 
-    return ret;
-}
+    m_queues[priority].Push(item);
+    m_nonEmpty |= (1 << priority);
+    m_bytes += item->GetSize();
+    GetScheduler()->Enqueued(priority, m_queues);
 
-Ptr<Packet> 
-PointToPointQueue::Dequeue(bool pause)
-{
-    if(!pause)
-        return this->Dequeue();
+    uint32_t size;
+    if(item->PeekSlot(Packet::SLOT_ENQUEUE_SIZE, size))
+        m_ecnSize[priority] += size;
 
-    for(uint32_t i = 0; i < 2; ++i){
-        Ptr<Packet> ret = m_queues[i]->Dequeue();
-        if(ret != nullptr){
-            PacketTag packetTag;
-            if(ret->PeekPacketTag(packetTag))
-                m_ecnSize -= packetTag.GetSize();
-            return ret;
-        }
-    }
-    return nullptr;
+    return true;
 }
 
 Ptr<Packet>
 PointToPointQueue::Dequeue()
 {
-    for(auto queue : m_queues){
-        Ptr<Packet> ret = queue->Dequeue();
-        if(ret != nullptr){
-            PacketTag packetTag;
-            if(ret->PeekPacketTag(packetTag))
-                m_ecnSize -= packetTag.GetSize();
-            return ret;
-        }
+    uint32_t eligible = m_nonEmpty & ~m_paused;
+    if(eligible == 0)
+        return nullptr;
+    uint32_t priority = GetScheduler()->Select(eligible, m_queues);
+    Ptr<Packet> ret = DequeueFrom(priority);
+    m_scheduler->Dequeued(priority, ret->GetSize(), m_queues);
+
+    Ptr<PointToPointAqm> aqm = m_aqm[priority];
+    if(aqm != nullptr){
+        aqm->NotifyDequeue(ret->GetSize(), m_ecnSize[priority]);
+        if(aqm->IsMarkOnDequeue() && aqm->ShouldMark(m_ecnSize[priority]) && MarkEcn(ret))
+            m_ecnCount += 1;
     }
-    return nullptr;
+    return ret;
+}
+
+Ptr<Packet>
+PointToPointQueue::DequeueFrom(uint32_t priority)
+{
+    Ptr<Packet> ret = m_queues[priority].Pop();
+    if(m_queues[priority].IsEmpty())
+        m_nonEmpty &= ~(1 << priority);
+    m_bytes -= ret->GetSize();
+
+    uint32_t size;
+    if(ret->PeekSlot(Packet::SLOT_ENQUEUE_SIZE, size))
+        m_ecnSize[priority] -= size;
+    return ret;
 }
 
 Ptr<Packet>
 PointToPointQueue::Remove()
 {
-    std::cout << "Remove in PointToPointQueue is not implemented now." << std::endl;
-    return nullptr;
+    // Drops ignore pause and scheduling state
+    if(m_nonEmpty == 0)
+        return nullptr;
+    return DequeueFrom(__builtin_ctz(m_nonEmpty));
 }
 
 Ptr<const Packet>
 PointToPointQueue::Peek() const
 {
-    std::cout << "Peek in PointToPointQueue is not implemented now." << std::endl;
-    return nullptr;
+    if(m_nonEmpty == 0)
+        return nullptr;
+    return m_queues[__builtin_ctz(m_nonEmpty)].Front();
 }
 
 bool
 PointToPointQueue::IsEmpty() const
 {
-    for(uint32_t i = 0; i < 4; ++i)
-        if(!m_queues[i]->IsEmpty())
-            return false;
-    return true;
+    return m_nonEmpty == 0;
 }
 
 uint32_t
 PointToPointQueue::GetNBytes() const
 {
-    uint32_t totalBytes = 0;
-    for (const auto& queue : m_queues)
-        totalBytes += queue->GetNBytes();
-    return totalBytes;
+    return m_bytes;
 }
 
 bool
-PointToPointQueue::SetEcn()
+PointToPointQueue::MarkEcn(Ptr<Packet> item)
 {
-    if(m_ecnSize > m_ecnThreshold)
-        return true;
-    if(m_ecnSize < 50000)
+    // Offsets follow the wire format of PppHeader (protocol, padding, then
+    // 10 + padding bytes), Ipv4Header, Ipv6Header, MplsHeader, RohcHeader
+    // and RohcIpHeader.
+    uint8_t buf[14 + 0xff + 24];
+    uint32_t size = item->GetSize();
+    if(size < 14)
+        return false;
+    item->CopyData(buf, 4);
+
+    uint16_t proto = (buf[0] << 8) | buf[1];
+    if(proto == 0x0171)
+        return MarkIdealEcn(item);
+    if(proto != 0x0021 && proto != 0x0057 && proto != 0x0281 && proto != 0x0172)
+        return false;
+
+    uint32_t offset = 14 + (((buf[2] << 8) | buf[3]) & 0xff);
+    uint32_t length = std::min(size, offset + 24);
+    if(length <= offset)
         return false;
+    item->CopyData(buf, length);
+
+    uint8_t* header = buf + offset;
+    uint32_t avail = length - offset;
+    uint32_t end = 0;
 
-    double prob = (m_ecnSize - 50000) / (m_ecnThreshold - 50000) * 0.01;
-    return m_random->GetValue() < prob;
+    switch (proto)
+    {
+        case 0x0021: end = MarkIpv4Ecn(header, avail); break;
+        case 0x0057: end = MarkIpv6Ecn(header, avail); break;
+        case 0x0281: // MPLS EXP sits in bits 9-11 of the second 16-bit word
+            if(avail >= 4){
+                uint8_t exp = (header[2] >> 1) & 0x7;
+                if(exp == MplsHeader::ECN_ECT1 || exp == MplsHeader::ECN_ECT0){
+                    header[2] = (header[2] & 0xf1) | (MplsHeader::ECN_CE << 1);
+                    end = 3;
+                }
+            }
+            break;
+        case 0x0172:
+            if(avail >= 1 && header[0] == 0){
+                // Compressed: RohcIpHeader (ttl, ecn, payload) follows the 3-byte RohcHeader
+                if(avail >= 5 && (header[4] == Ipv4Header::ECN_ECT1 || header[4] == Ipv4Header::ECN_ECT0)){
+                    header[4] = Ipv4Header::ECN_CE;
+                    end = 5;
+                }
+            }
+            else if(avail >= 4){
+                // IR: the full IP header follows the 4-byte RohcHeader
+                uint32_t irEnd = 0;
+                if(header[1] == 4)
+                    irEnd = MarkIpv4Ecn(header + 4, avail - 4);
+                else if(header[1] == 6 || header[1] == 7)
+                    irEnd = MarkIpv6Ecn(header + 4, avail - 4);
+                if(irEnd)
+                    end = 4 + irEnd;
+            }
+            break;
+        default: break;
+    }
+
+    if(end == 0)
+        return false;
+    item->OverwriteAtStart(buf, offset + end);
+    return true;
+}
+
+uint32_t
+PointToPointQueue::MarkIpv4Ecn(uint8_t* header, uint32_t avail)
+{
+    if(avail < 20)
+        return 0;
+    uint8_t ecn = header[1] & 0x3;
+    if(ecn != Ipv4Header::ECN_ECT1 && ecn != Ipv4Header::ECN_ECT0)
+        return 0;
+
+    uint16_t oldWord = (header[0] << 8) | header[1];
+    header[1] |= Ipv4Header::ECN_CE;
+    if(Node::ChecksumEnabled() && (header[10] | header[11])){
+        // Incremental update of the header checksum, RFC 1624 eqn. 3
+        uint16_t newWord = (header[0] << 8) | header[1];
+        uint32_t sum = uint16_t(~((header[10] << 8) | header[11])) + uint16_t(~oldWord) + newWord;
+        sum = (sum & 0xffff) + (sum >> 16);
+        sum = (sum & 0xffff) + (sum >> 16);
+        uint16_t checksum = ~sum;
+        header[10] = checksum >> 8;
+        header[11] = checksum & 0xff;
+    }
+    return 12;
+}
+
+uint32_t
+PointToPointQueue::MarkIpv6Ecn(uint8_t* header, uint32_t avail)
+{
+    // The traffic class spans the low nibble of byte 0 and the high nibble of byte 1
+    if(avail < 2)
+        return 0;
+    uint8_t ecn = (header[1] >> 4) & 0x3;
+    if(ecn != Ipv6Header::ECN_ECT1 && ecn != Ipv6Header::ECN_ECT0)
+        return 0;
+    header[1] |= (Ipv6Header::ECN_CE << 4);
+    return 2;
+}
+
+bool
+PointToPointQueue::MarkIdealEcn(Ptr<Packet> item)
+{
+    Ptr<const IdealMetadata> metadata = DynamicCast<const IdealMetadata>(item->GetSideChannel());
+
+    if(metadata == nullptr){
+        std::cout << "Fail to find ideal metadata" << std::endl;
+        return false;
+    }
+    if(metadata->version == 4){
+        if(metadata->ipv4Header.GetEcn() != Ipv4Header::ECN_ECT1 &&
+            metadata->ipv4Header.GetEcn() != Ipv4Header::ECN_ECT0)
+            return false;
+        Ptr<IdealMetadata> marked = Create<IdealMetadata>(*metadata);
+        marked->ipv4Header.SetEcn(Ipv4Header::ECN_CE);
+        item->SetSideChannel(marked);
+        return true;
+    }
+    if(metadata->ipv6Header.GetEcn() != Ipv6Header::ECN_ECT1 &&
+        metadata->ipv6Header.GetEcn() != Ipv6Header::ECN_ECT0)
+        return false;
+    Ptr<IdealMetadata> marked = Create<IdealMetadata>(*metadata);
+    marked->ipv6Header.SetEcn(Ipv6Header::ECN_CE);
+    item->SetSideChannel(marked);
+    return true;
 }
 
 } // namespace ns3
@@ -1,15 +1,39 @@
 #ifndef POINT_TO_POINT_QUEUE_H
 #define POINT_TO_POINT_QUEUE_H
 
-#include "ns3/drop-tail-queue.h"
-#include "ns3/random-variable-stream.h"
+#include "ns3/queue.h"
 #include "point-to-point-net-device.h"
+#include "point-to-point-aqm.h"
+#include "point-to-point-scheduler.h"
 
 #include <vector>
 
 namespace ns3
 {
 
+/**
+ * \brief Growable ring buffer of packets with a running byte count
+ */
+class PacketFifo
+{
+public:
+    bool IsEmpty() const { return m_count == 0; }
+    uint32_t GetNPackets() const { return m_count; }
+    uint32_t GetNBytes() const { return m_bytes; }
+
+    void Push(Ptr<Packet> packet);
+    Ptr<Packet> Pop();
+    Ptr<Packet> Front() const;
+
+private:
+    void Grow();
+
+    std::vector<Ptr<Packet>> m_ring; // capacity is always a power of two
+    uint32_t m_head{0};
+    uint32_t m_count{0};
+    uint32_t m_bytes{0};
+};
+
 class PointToPointQueue : public Queue<Packet>
 {
 public:
@@ -26,7 +50,6 @@ public:
     ~PointToPointQueue() override;
 
     bool Enqueue(Ptr<Packet> packet) override;
-    Ptr<Packet> Dequeue(bool pause);
     Ptr<Packet> Dequeue() override;
     Ptr<Packet> Remove() override;
     Ptr<const Packet> Peek() const override;
@@ -36,14 +59,55 @@ public:
 
     uint64_t GetEcnCount();
 
+    // ECN strategy of a class, nullptr if the class is not in AqmClasses
+    Ptr<PointToPointAqm> GetAqm(uint32_t cls);
+
+    // A paused class keeps its packets but is skipped by Dequeue
+    void SetPause(uint32_t cls, bool pause);
+    bool IsPaused(uint32_t cls) const;
+
+    // Per-class pause accounting, times in ns and including a pause in progress
+    uint64_t GetPauseTime(uint32_t cls) const;
+    uint64_t GetPauseCount(uint32_t cls) const;
+    uint64_t GetPausedFor(uint32_t cls) const;
+
+    uint32_t GetNBytes(uint32_t cls) const;
+
+    Ptr<PointToPointScheduler> GetScheduler();
+    uint64_t GetTxBytes(uint32_t cls);
+
 protected:
-    std::vector<Ptr<DropTailQueue<Packet>>> m_queues;
-    uint32_t m_ecnSize{0};
-    uint32_t m_ecnThreshold;
+    static const uint32_t PRIORITY_NUM = 8;
+    static const uint32_t PRIORITY_BYTES = 16 * 1024 * 1024;
+
+    PacketFifo m_queues[PRIORITY_NUM];
+    uint32_t m_nonEmpty{0}; // bit i set if m_queues[i] holds packets
+    uint32_t m_paused{0};   // bit i set if class i is paused by PFC
+    int64_t m_pauseStart[PRIORITY_NUM]{};
+    uint64_t m_pauseTime[PRIORITY_NUM]{};
+    uint64_t m_pauseCount[PRIORITY_NUM]{};
+    uint32_t m_bytes{0};
+    uint32_t m_ecnSize[PRIORITY_NUM]{}; // ingress bytes of each class, what its AQM sees
     uint64_t m_ecnCount{0};
-    Ptr<UniformRandomVariable> m_random;
+    TypeId m_aqmType;
+    uint32_t m_aqmClasses;
+    bool m_aqmCreated{false};
+    Ptr<PointToPointAqm> m_aqm[PRIORITY_NUM];
+    TypeId m_schedulerType;
+    Ptr<PointToPointScheduler> m_scheduler;
+
+    void CreateAqm();
+    // AQM and scheduler are built here when the device is initialized
+    void DoInitialize() override;
+
+    Ptr<Packet> DequeueFrom(uint32_t priority);
 
-    bool SetEcn();
+    // Flip ECT to CE in the serialized headers, returns true if marked
+    bool MarkEcn(Ptr<Packet> item);
+    bool MarkIdealEcn(Ptr<Packet> item);
+    // Return the number of header bytes touched, 0 if not marked
+    uint32_t MarkIpv4Ecn(uint8_t* header, uint32_t avail);
+    uint32_t MarkIpv6Ecn(uint8_t* header, uint32_t avail);
 };
 
 } // namespace ns3
@@ -19,6 +19,7 @@
 
 #include "point-to-point-remote-channel.h"
 
+#include "mpi-metadata-header.h"
 #include "point-to-point-net-device.h"
 
 #include "ns3/log.h"
@@ -69,7 +70,11 @@ PointToPointRemoteChannel::TransmitStart(Ptr<const Packet> p,
 
     // Calculate the rxTime (absolute)
     Time rxTime = Simulator::Now() + txTime + GetDelay();
-    MpiInterface::SendPacket(p->Copy(), rxTime, dst->GetNode()->GetId(), dst->GetIfIndex());
+    Ptr<Packet> copy = p->Copy();
+    MpiMetadataHeader metadata;
+    metadata.Save(copy);
+    copy->AddHeader(metadata);
+    MpiInterface::SendPacket(copy, rxTime, dst->GetNode()->GetId(), dst->GetIfIndex());
     return true;
 }
 
@@ -0,0 +1,294 @@
+#include "point-to-point-scheduler.h"
+
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include "point-to-point-queue.h"
+
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("PointToPointScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED(PointToPointScheduler);
+NS_OBJECT_ENSURE_REGISTERED(StrictPriorityScheduler);
+NS_OBJECT_ENSURE_REGISTERED(DwrrScheduler);
+NS_OBJECT_ENSURE_REGISTERED(WfqScheduler);
+
+TypeId
+PointToPointScheduler::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::PointToPointScheduler")
+                            .SetParent<Object>()
+                            .SetGroupName("PointToPoint")
+                            .AddAttribute("StrictClasses",
+                                          "Number of lowest classes served in strict priority "
+                                          "ahead of the scheduled classes",
+                                          UintegerValue(1),
+                                          MakeUintegerAccessor(&PointToPointScheduler::m_strictClasses),
+                                          MakeUintegerChecker<uint32_t>(0, 32));
+    return tid;
+}
+
+PointToPointScheduler::PointToPointScheduler()
+{
+}
+
+PointToPointScheduler::~PointToPointScheduler()
+{
+}
+
+void
+PointToPointScheduler::SetClasses(uint32_t classes)
+{
+    m_classes = classes;
+    m_txBytes.assign(classes, 0);
+    m_txPackets.assign(classes, 0);
+    ParseWeights();
+    DoSetClasses(classes);
+}
+
+void
+PointToPointScheduler::DoSetClasses(uint32_t classes)
+{
+}
+
+uint32_t
+PointToPointScheduler::Select(uint32_t eligible, const PacketFifo* queues)
+{
+    uint32_t strictMask = (m_strictClasses >= 32) ? 0xffffffff : ((1u << m_strictClasses) - 1);
+    if(eligible & strictMask)
+        return __builtin_ctz(eligible & strictMask);
+    return DoSelect(eligible & ~strictMask, queues);
+}
+
+void
+PointToPointScheduler::Enqueued(uint32_t cls, const PacketFifo* queues)
+{
+    if(cls >= m_strictClasses)
+        DoEnqueued(cls, queues);
+}
+
+void
+PointToPointScheduler::Dequeued(uint32_t cls, uint32_t bytes, const PacketFifo* queues)
+{
+    m_txBytes[cls] += bytes;
+    m_txPackets[cls] += 1;
+    if(cls >= m_strictClasses)
+        DoDequeued(cls, bytes, queues);
+}
+
+void
+PointToPointScheduler::DoEnqueued(uint32_t cls, const PacketFifo* queues)
+{
+}
+
+void
+PointToPointScheduler::DoDequeued(uint32_t cls, uint32_t bytes, const PacketFifo* queues)
+{
+}
+
+uint64_t
+PointToPointScheduler::GetTxBytes(uint32_t cls) const
+{
+    return cls < m_txBytes.size() ? m_txBytes[cls] : 0;
+}
+
+uint64_t
+PointToPointScheduler::GetTxPackets(uint32_t cls) const
+{
+    return cls < m_txPackets.size() ? m_txPackets[cls] : 0;
+}
+
+void
+PointToPointScheduler::SetWeights(std::string weights)
+{
+    m_weightString = weights;
+    if(m_classes > 0)
+        ParseWeights();
+}
+
+std::string
+PointToPointScheduler::GetWeights() const
+{
+    return m_weightString;
+}
+
+void
+PointToPointScheduler::ParseWeights()
+{
+    m_weights.assign(m_classes, 1);
+    std::istringstream in(m_weightString);
+    std::string item;
+    for(uint32_t i = 0; i < m_classes && std::getline(in, item, ','); ++i){
+        uint32_t weight = std::strtoul(item.c_str(), nullptr, 10);
+        if(weight == 0){
+            std::cout << "Invalid weight " << item << " for class " << i << std::endl;
+            weight = 1;
+        }
+        m_weights[i] = weight;
+    }
+}
+
+TypeId
+StrictPriorityScheduler::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::StrictPriorityScheduler")
+                            .SetParent<PointToPointScheduler>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<StrictPriorityScheduler>();
+    return tid;
+}
+
+StrictPriorityScheduler::StrictPriorityScheduler()
+{
+}
+
+StrictPriorityScheduler::~StrictPriorityScheduler()
+{
+}
+
+uint32_t
+StrictPriorityScheduler::DoSelect(uint32_t eligible, const PacketFifo* queues)
+{
+    return __builtin_ctz(eligible);
+}
+
+TypeId
+DwrrScheduler::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::DwrrScheduler")
+                            .SetParent<PointToPointScheduler>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<DwrrScheduler>()
+                            .AddAttribute("Quantum",
+                                          "Bytes credited per round for a class of weight 1",
+                                          UintegerValue(1500),
+                                          MakeUintegerAccessor(&DwrrScheduler::m_quantum),
+                                          MakeUintegerChecker<uint32_t>(1))
+                            .AddAttribute("Weights",
+                                          "Comma separated weight of each class",
+                                          StringValue("1,1,1,1"),
+                                          MakeStringAccessor(&PointToPointScheduler::SetWeights,
+                                                             &PointToPointScheduler::GetWeights),
+                                          MakeStringChecker());
+    return tid;
+}
+
+DwrrScheduler::DwrrScheduler()
+{
+}
+
+DwrrScheduler::~DwrrScheduler()
+{
+}
+
+void
+DwrrScheduler::DoSetClasses(uint32_t classes)
+{
+    m_deficit.assign(classes, 0);
+    m_current = 0;
+    m_credited = false;
+}
+
+void
+DwrrScheduler::Next()
+{
+    m_current = (m_current + 1) % m_classes;
+    m_credited = false;
+}
+
+uint32_t
+DwrrScheduler::DoSelect(uint32_t eligible, const PacketFifo* queues)
+{
+    // Every eligible class gains credit on each visit, so this terminates
+    while(true){
+        if(eligible & (1 << m_current)){
+            if(!m_credited){
+                m_deficit[m_current] += uint64_t(m_quantum) * m_weights[m_current];
+                m_credited = true;
+            }
+            if(queues[m_current].Front()->GetSize() <= m_deficit[m_current])
+                return m_current;
+        }
+        else if(queues[m_current].IsEmpty())
+            m_deficit[m_current] = 0; // a paused class keeps its credit
+        Next();
+    }
+}
+
+void
+DwrrScheduler::DoDequeued(uint32_t cls, uint32_t bytes, const PacketFifo* queues)
+{
+    m_deficit[cls] -= std::min<uint64_t>(bytes, m_deficit[cls]);
+    if(queues[cls].IsEmpty()){
+        m_deficit[cls] = 0;
+        if(cls == m_current)
+            Next();
+    }
+}
+
+TypeId
+WfqScheduler::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::WfqScheduler")
+                            .SetParent<PointToPointScheduler>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<WfqScheduler>()
+                            .AddAttribute("Weights",
+                                          "Comma separated weight of each class",
+                                          StringValue("1,1,1,1"),
+                                          MakeStringAccessor(&PointToPointScheduler::SetWeights,
+                                                             &PointToPointScheduler::GetWeights),
+                                          MakeStringChecker());
+    return tid;
+}
+
+WfqScheduler::WfqScheduler()
+{
+}
+
+WfqScheduler::~WfqScheduler()
+{
+}
+
+void
+WfqScheduler::DoSetClasses(uint32_t classes)
+{
+    m_finish.assign(classes, 0);
+    m_virtualTime = 0;
+}
+
+uint32_t
+WfqScheduler::DoSelect(uint32_t eligible, const PacketFifo* queues)
+{
+    uint32_t ret = __builtin_ctz(eligible);
+    for(uint32_t mask = eligible & (eligible - 1); mask != 0; mask &= mask - 1){
+        uint32_t cls = __builtin_ctz(mask);
+        if(m_finish[cls] < m_finish[ret])
+            ret = cls;
+    }
+    return ret;
+}
+
+void
+WfqScheduler::DoEnqueued(uint32_t cls, const PacketFifo* queues)
+{
+    // m_finish holds the head-of-line tag of a backlogged class, otherwise
+    // the tag of its last served packet
+    if(queues[cls].GetNPackets() == 1)
+        m_finish[cls] = std::max(m_virtualTime, m_finish[cls]) +
+                        double(queues[cls].Front()->GetSize()) / m_weights[cls];
+}
+
+void
+WfqScheduler::DoDequeued(uint32_t cls, uint32_t bytes, const PacketFifo* queues)
+{
+    m_virtualTime = m_finish[cls];
+    if(!queues[cls].IsEmpty())
+        m_finish[cls] += double(queues[cls].Front()->GetSize()) / m_weights[cls];
+}
+
+} // namespace ns3
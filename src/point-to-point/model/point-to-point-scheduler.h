@@ -0,0 +1,122 @@
+#ifndef POINT_TO_POINT_SCHEDULER_H
+#define POINT_TO_POINT_SCHEDULER_H
+
+#include "ns3/object.h"
+#include "ns3/packet.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class PacketFifo;
+
+/**
+ * \brief Picks the next traffic class to serve in a PointToPointQueue
+ *
+ * Classes below StrictClasses are always served first in strict priority,
+ * the remaining classes are shared by the subclass policy.
+ */
+class PointToPointScheduler : public Object
+{
+	public:
+		static TypeId GetTypeId();
+
+		PointToPointScheduler();
+		~PointToPointScheduler() override;
+
+		void SetClasses(uint32_t classes);
+
+		// eligible has bit i set for every non-empty, non-paused class
+		uint32_t Select(uint32_t eligible, const PacketFifo* queues);
+		void Enqueued(uint32_t cls, const PacketFifo* queues);
+		void Dequeued(uint32_t cls, uint32_t bytes, const PacketFifo* queues);
+
+		uint64_t GetTxBytes(uint32_t cls) const;
+		uint64_t GetTxPackets(uint32_t cls) const;
+
+		// Comma separated per-class weights, missing entries default to 1
+		void SetWeights(std::string weights);
+		std::string GetWeights() const;
+
+	protected:
+		virtual void DoSetClasses(uint32_t classes);
+		virtual uint32_t DoSelect(uint32_t eligible, const PacketFifo* queues) = 0;
+		virtual void DoEnqueued(uint32_t cls, const PacketFifo* queues);
+		virtual void DoDequeued(uint32_t cls, uint32_t bytes, const PacketFifo* queues);
+
+		void ParseWeights();
+
+		uint32_t m_classes{0};
+		uint32_t m_strictClasses;
+		std::string m_weightString;
+		std::vector<uint32_t> m_weights;
+
+	private:
+		std::vector<uint64_t> m_txBytes;
+		std::vector<uint64_t> m_txPackets;
+};
+
+class StrictPriorityScheduler : public PointToPointScheduler
+{
+	public:
+		static TypeId GetTypeId();
+
+		StrictPriorityScheduler();
+		~StrictPriorityScheduler() override;
+
+	protected:
+		uint32_t DoSelect(uint32_t eligible, const PacketFifo* queues) override;
+};
+
+/**
+ * \brief Deficit weighted round robin, each visit credits Quantum * weight bytes
+ */
+class DwrrScheduler : public PointToPointScheduler
+{
+	public:
+		static TypeId GetTypeId();
+
+		DwrrScheduler();
+		~DwrrScheduler() override;
+
+	protected:
+		void DoSetClasses(uint32_t classes) override;
+		uint32_t DoSelect(uint32_t eligible, const PacketFifo* queues) override;
+		void DoDequeued(uint32_t cls, uint32_t bytes, const PacketFifo* queues) override;
+
+	private:
+		void Next();
+
+		uint32_t m_quantum;
+		std::vector<uint64_t> m_deficit;
+		uint32_t m_current{0};
+		bool m_credited{false};
+};
+
+/**
+ * \brief Self-clocked weighted fair queueing over the head-of-line packets
+ */
+class WfqScheduler : public PointToPointScheduler
+{
+	public:
+		static TypeId GetTypeId();
+
+		WfqScheduler();
+		~WfqScheduler() override;
+
+	protected:
+		void DoSetClasses(uint32_t classes) override;
+		uint32_t DoSelect(uint32_t eligible, const PacketFifo* queues) override;
+		void DoEnqueued(uint32_t cls, const PacketFifo* queues) override;
+		void DoDequeued(uint32_t cls, uint32_t bytes, const PacketFifo* queues) override;
+
+	private:
+		double m_virtualTime{0};
+		std::vector<double> m_finish;
+};
+
+} // namespace ns3
+
+#endif /* POINT_TO_POINT_SCHEDULER_H */
@@ -180,7 +180,7 @@ rotateLeft(uint32_t x, unsigned char bits)
 }
 
 uint32_t 
-FlowV4Id::hash(uint32_t seed){
+FlowV4Id::hash(uint32_t seed) const{
     uint32_t result = prime[seed];
 
     result = rotateLeft(result + m_srcPort * Prime[2], 17) * Prime[3];
@@ -195,7 +195,7 @@ FlowV4Id::hash(uint32_t seed){
 }
 
 uint32_t 
-FlowV6Id::hash(uint32_t seed){
+FlowV6Id::hash(uint32_t seed) const{
     uint32_t result = prime[seed];
 
     result = rotateLeft(result + m_srcPort * Prime[2], 17) * Prime[3];
@@ -41,7 +41,7 @@ struct FlowV4Id
     FlowV4Id();
     FlowV4Id(const FlowV4Id& flow);
 
-    uint32_t hash(uint32_t seed = 0);
+    uint32_t hash(uint32_t seed = 0) const;
 };
 #pragma pack(pop)
 
@@ -62,7 +62,7 @@ struct FlowV6Id
     FlowV6Id();
     FlowV6Id(const FlowV6Id& flow);
 
-    uint32_t hash(uint32_t seed = 0);
+    uint32_t hash(uint32_t seed = 0) const;
 };
 #pragma pack(pop)
 
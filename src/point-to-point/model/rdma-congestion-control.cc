@@ -0,0 +1,400 @@
+#include "rdma-congestion-control.h"
+
+#include "ns3/double.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <cmath>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("RdmaCongestionControl");
+
+NS_OBJECT_ENSURE_REGISTERED(RdmaCongestionControl);
+NS_OBJECT_ENSURE_REGISTERED(DcqcnCc);
+NS_OBJECT_ENSURE_REGISTERED(HpccCc);
+NS_OBJECT_ENSURE_REGISTERED(SwiftCc);
+
+TypeId
+RdmaCongestionControl::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::RdmaCongestionControl")
+                            .SetParent<Object>()
+                            .SetGroupName("PointToPoint")
+                            .AddAttribute("MinRate",
+                                          "Lowest sending rate in GB/s",
+                                          DoubleValue(0.1),
+                                          MakeDoubleAccessor(&RdmaCongestionControl::m_minRate),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("InitialRate",
+                                          "Rate at the start of a flow as a fraction of the line rate, "
+                                          "12.1 of 12.5 GB/s by default",
+                                          DoubleValue(12.1 / 12.5),
+                                          MakeDoubleAccessor(&RdmaCongestionControl::m_initialRate),
+                                          MakeDoubleChecker<double>(0, 1));
+    return tid;
+}
+
+RdmaCongestionControl::RdmaCongestionControl()
+{
+}
+
+RdmaCongestionControl::~RdmaCongestionControl()
+{
+}
+
+void
+RdmaCongestionControl::Init(double lineRate)
+{
+    m_lineRate = lineRate;
+    m_rate = 0;
+    m_rates.clear();
+    DoInit();
+    SetRate(m_lineRate * m_initialRate);
+}
+
+void
+RdmaCongestionControl::OnAck(const RdmaAck& ack)
+{
+    DoAck(ack);
+}
+
+double
+RdmaCongestionControl::GetRate() const
+{
+    return m_rate;
+}
+
+bool
+RdmaCongestionControl::NeedsTelemetry() const
+{
+    return false;
+}
+
+void
+RdmaCongestionControl::SetRate(double rate)
+{
+    rate = std::min(m_lineRate, std::max(m_minRate, rate));
+    if(m_history && rate != m_rate)
+        m_rates.emplace_back(Simulator::Now().GetNanoSeconds(), rate);
+    m_rate = rate;
+}
+
+void
+RdmaCongestionControl::EnableHistory()
+{
+    m_history = true;
+}
+
+void
+RdmaCongestionControl::WriteHistory(FILE* file, uint32_t flow)
+{
+    for(auto& rate : m_rates)
+        fprintf(file, "%u,%ld,%.4f\n", flow, rate.first, rate.second);
+    m_rates.clear();
+}
+
+TypeId
+DcqcnCc::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::DcqcnCc")
+                            .SetParent<RdmaCongestionControl>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<DcqcnCc>()
+                            .AddAttribute("G",
+                                          "EWMA gain of alpha",
+                                          DoubleValue(1.0 / 256.0),
+                                          MakeDoubleAccessor(&DcqcnCc::m_g),
+                                          MakeDoubleChecker<double>(0, 1))
+                            .AddAttribute("RateAI",
+                                          "Additive increase of the target rate in GB/s",
+                                          DoubleValue(0.05),
+                                          MakeDoubleAccessor(&DcqcnCc::m_rateAI),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("AlphaInterval",
+                                          "Period of the alpha update",
+                                          TimeValue(MicroSeconds(9)),
+                                          MakeTimeAccessor(&DcqcnCc::m_alphaInterval),
+                                          MakeTimeChecker())
+                            .AddAttribute("IncreaseInterval",
+                                          "Period of the rate increase after a CNP",
+                                          TimeValue(MicroSeconds(100)),
+                                          MakeTimeAccessor(&DcqcnCc::m_increaseInterval),
+                                          MakeTimeChecker())
+                            .AddAttribute("DecreaseInterval",
+                                          "Minimum gap between two rate cuts",
+                                          TimeValue(MicroSeconds(10)),
+                                          MakeTimeAccessor(&DcqcnCc::m_decreaseInterval),
+                                          MakeTimeChecker());
+    return tid;
+}
+
+DcqcnCc::DcqcnCc()
+{
+}
+
+DcqcnCc::~DcqcnCc()
+{
+}
+
+Ptr<RdmaCongestionControl>
+DcqcnCc::Copy() const
+{
+	return CopyObject<DcqcnCc>(this);
+}
+
+void
+DcqcnCc::DoInit()
+{
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    m_alpha = 1;
+    m_timeStage = 0;
+    m_alphaTime = now;
+    m_increaseTime = -1;
+}
+
+void
+DcqcnCc::CatchUp(int64_t now)
+{
+    // Alpha periods without a CNP only decay
+    int64_t alphaInterval = m_alphaInterval.GetNanoSeconds();
+    int64_t periods = (now - m_alphaTime) / alphaInterval;
+    if(periods > 0){
+        m_alpha *= std::pow(1 - m_g, periods);
+        m_alphaTime += periods * alphaInterval;
+    }
+
+    if(m_increaseTime < 0 || now < m_increaseTime)
+        return;
+    int64_t increaseInterval = m_increaseInterval.GetNanoSeconds();
+    int64_t stages = (now - m_increaseTime) / increaseInterval + 1;
+    m_increaseTime += stages * increaseInterval;
+    // Past this many stages the rate has recovered anyway
+    double rate = m_rate;
+    for(int64_t i = 0; i < std::min<int64_t>(stages, 512); ++i){
+        if(m_timeStage > 0)
+            m_targetRate = std::min(m_lineRate, m_targetRate + m_rateAI);
+        rate = (m_targetRate + rate) / 2.0;
+        m_timeStage += 1;
+    }
+    SetRate(rate);
+}
+
+void
+DcqcnCc::DoAck(const RdmaAck& ack)
+{
+    CatchUp(ack.now);
+    if(!ack.cnp)
+        return;
+
+    m_alpha = (1 - m_g) * m_alpha + m_g;
+    m_alphaTime = ack.now;
+    if(ack.now - m_prevCnpTime > m_decreaseInterval.GetNanoSeconds()){
+        m_prevCnpTime = ack.now;
+        m_targetRate = m_rate;
+        SetRate(m_rate * (1 - m_alpha / 2.0));
+    }
+    m_timeStage = 0;
+    m_increaseTime = ack.now + m_increaseInterval.GetNanoSeconds();
+}
+
+TypeId
+HpccCc::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::HpccCc")
+                            .SetParent<RdmaCongestionControl>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<HpccCc>()
+                            .AddAttribute("BaseRtt",
+                                          "Base RTT used to turn rates into inflight bytes",
+                                          TimeValue(MicroSeconds(15)),
+                                          MakeTimeAccessor(&HpccCc::m_baseRtt),
+                                          MakeTimeChecker())
+                            .AddAttribute("Eta",
+                                          "Target utilization",
+                                          DoubleValue(0.95),
+                                          MakeDoubleAccessor(&HpccCc::m_eta),
+                                          MakeDoubleChecker<double>(0, 1))
+                            .AddAttribute("MaxStage",
+                                          "Additive increases before a multiplicative update",
+                                          UintegerValue(5),
+                                          MakeUintegerAccessor(&HpccCc::m_maxStage),
+                                          MakeUintegerChecker<uint32_t>())
+                            .AddAttribute("RateAI",
+                                          "Additive increase in GB/s",
+                                          DoubleValue(0.05),
+                                          MakeDoubleAccessor(&HpccCc::m_rateAI),
+                                          MakeDoubleChecker<double>(0));
+    return tid;
+}
+
+HpccCc::HpccCc()
+{
+}
+
+HpccCc::~HpccCc()
+{
+}
+
+Ptr<RdmaCongestionControl>
+HpccCc::Copy() const
+{
+	return CopyObject<HpccCc>(this);
+}
+
+bool
+HpccCc::NeedsTelemetry() const
+{
+    return true;
+}
+
+void
+HpccCc::DoInit()
+{
+    m_u = 0;
+    m_refRate = m_lineRate * m_initialRate;
+    m_incStage = 0;
+    m_lastUpdateSeq = 0;
+    m_nHops = 0;
+}
+
+void
+HpccCc::DoAck(const RdmaAck& ack)
+{
+    if(ack.tag == nullptr || ack.tag->GetNHops() == 0)
+        return;
+
+    const IntTag& tag = *ack.tag;
+    // A new path invalidates the previous samples
+    if(tag.GetNHops() != m_nHops){
+        m_nHops = tag.GetNHops();
+        for(uint32_t i = 0; i < m_nHops; ++i)
+            m_hops[i] = tag.GetHop(i);
+        return;
+    }
+
+    double baseRtt = m_baseRtt.GetNanoSeconds();
+    double u = 0;
+    int64_t tau = 0;
+    for(uint32_t i = 0; i < m_nHops; ++i){
+        const IntTag::Hop& hop = tag.GetHop(i);
+        int64_t duration = hop.time - m_hops[i].time;
+        if(duration <= 0)
+            continue;
+        double bandwidth = hop.rate / 8e9; // bytes per ns
+        double txRate = double(hop.txBytes - m_hops[i].txBytes) / duration;
+        double hopU = txRate / bandwidth + std::min(hop.qlen, m_hops[i].qlen) / (bandwidth * baseRtt);
+        if(hopU > u){
+            u = hopU;
+            tau = duration;
+        }
+    }
+    for(uint32_t i = 0; i < m_nHops; ++i)
+        m_hops[i] = tag.GetHop(i);
+    if(tau == 0)
+        return;
+
+    double weight = std::min<double>(tau, baseRtt) / baseRtt;
+    m_u = (1 - weight) * m_u + weight * u;
+
+    // Fast reaction on every ACK, the reference rate moves once per RTT
+    bool updateRef = ack.seq > m_lastUpdateSeq;
+    double rate;
+    if(m_u >= m_eta || m_incStage >= m_maxStage){
+        rate = m_refRate / (m_u / m_eta) + m_rateAI;
+        if(updateRef)
+            m_incStage = 0;
+    }
+    else{
+        rate = m_refRate + m_rateAI;
+        if(updateRef)
+            m_incStage += 1;
+    }
+    SetRate(rate);
+    if(updateRef){
+        m_refRate = m_rate;
+        m_lastUpdateSeq = ack.sent;
+    }
+}
+
+TypeId
+SwiftCc::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::SwiftCc")
+                            .SetParent<RdmaCongestionControl>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<SwiftCc>()
+                            .AddAttribute("TargetDelay",
+                                          "RTT above which the rate is cut",
+                                          TimeValue(MicroSeconds(20)),
+                                          MakeTimeAccessor(&SwiftCc::m_targetDelay),
+                                          MakeTimeChecker())
+                            .AddAttribute("RateAI",
+                                          "Additive increase per RTT in GB/s",
+                                          DoubleValue(0.05),
+                                          MakeDoubleAccessor(&SwiftCc::m_rateAI),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("Beta",
+                                          "Multiplicative decrease per unit of excess delay",
+                                          DoubleValue(0.8),
+                                          MakeDoubleAccessor(&SwiftCc::m_beta),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("MaxMdf",
+                                          "Largest fraction cut in one decrease",
+                                          DoubleValue(0.5),
+                                          MakeDoubleAccessor(&SwiftCc::m_maxMdf),
+                                          MakeDoubleChecker<double>(0, 1));
+    return tid;
+}
+
+SwiftCc::SwiftCc()
+{
+}
+
+SwiftCc::~SwiftCc()
+{
+}
+
+Ptr<RdmaCongestionControl>
+SwiftCc::Copy() const
+{
+	return CopyObject<SwiftCc>(this);
+}
+
+bool
+SwiftCc::NeedsTelemetry() const
+{
+    return true;
+}
+
+void
+SwiftCc::DoInit()
+{
+    m_lastDecrease = 0;
+}
+
+void
+SwiftCc::DoAck(const RdmaAck& ack)
+{
+    if(ack.tag == nullptr)
+        return;
+
+    int64_t delay = ack.now - ack.tag->GetTimestamp();
+    int64_t target = m_targetDelay.GetNanoSeconds();
+    if(delay <= 0)
+        return;
+
+    if(delay < target){
+        // Spread the per-RTT increase over the ACKs of one window
+        double window = m_rate * delay;
+        SetRate(m_rate + m_rateAI * std::min(1.0, ack.newlyAcked / window));
+    }
+    else if(ack.now - m_lastDecrease >= delay){
+        double factor = std::max(1 - m_beta * (delay - target) / delay, 1 - m_maxMdf);
+        SetRate(m_rate * factor);
+        m_lastDecrease = ack.now;
+    }
+}
+
+} // namespace ns3
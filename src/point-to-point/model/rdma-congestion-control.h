@@ -0,0 +1,171 @@
+#ifndef RDMA_CONGESTION_CONTROL_H
+#define RDMA_CONGESTION_CONTROL_H
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include "int-tag.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief What a queue pair learned from one ACK or NACK
+ */
+struct RdmaAck
+{
+    int64_t now;          // ns
+    uint64_t seq;         // cumulative bytes acknowledged
+    uint64_t newlyAcked;  // bytes acknowledged by this ACK
+    uint64_t sent;        // bytes sent when the ACK arrived
+    bool cnp;
+    const IntTag* tag;    // nullptr unless the data packet carried telemetry
+};
+
+/**
+ * \brief Rate control of one RdmaQueuePair, in GB/s (bytes per ns)
+ *
+ * Updates happen only when an ACK arrives. Time based rules such as
+ * DCQCN's alpha decay and rate recovery are caught up lazily instead of
+ * keeping timers per queue pair.
+ */
+class RdmaCongestionControl : public Object
+{
+	public:
+		static TypeId GetTypeId();
+
+		RdmaCongestionControl();
+		~RdmaCongestionControl() override;
+
+		// A new instance with the attributes of this one, built without the
+		// attribute system so that queue pairs can get one while running
+		virtual Ptr<RdmaCongestionControl> Copy() const = 0;
+
+		// Called at the start of every flow on the queue pair
+		void Init(double lineRate);
+		void OnAck(const RdmaAck& ack);
+		double GetRate() const;
+
+		// Whether data packets should carry an IntTag
+		virtual bool NeedsTelemetry() const;
+
+		void EnableHistory();
+		void WriteHistory(FILE* file, uint32_t flow);
+
+	protected:
+		virtual void DoInit() = 0;
+		virtual void DoAck(const RdmaAck& ack) = 0;
+
+		void SetRate(double rate);
+
+		double m_rate{0};
+		double m_lineRate{0};
+		double m_minRate;
+		double m_initialRate;
+
+	private:
+		bool m_history{false};
+		std::vector<std::pair<int64_t, double>> m_rates;
+};
+
+/**
+ * \brief DCQCN driven by CNPs echoed in ACKs
+ */
+class DcqcnCc : public RdmaCongestionControl
+{
+	public:
+		static TypeId GetTypeId();
+
+		DcqcnCc();
+		~DcqcnCc() override;
+
+		Ptr<RdmaCongestionControl> Copy() const override;
+
+	protected:
+		void DoInit() override;
+		void DoAck(const RdmaAck& ack) override;
+
+	private:
+		void CatchUp(int64_t now);
+
+		double m_g;
+		double m_rateAI;
+		Time m_alphaInterval;
+		Time m_increaseInterval;
+		Time m_decreaseInterval;
+
+		double m_alpha{1.0};
+		double m_targetRate{0};
+		uint32_t m_timeStage{0};
+		int64_t m_alphaTime{0};
+		int64_t m_increaseTime{-1}; // next rate increase, -1 before the first CNP
+		int64_t m_prevCnpTime{0};
+};
+
+/**
+ * \brief HPCC, inflight estimated from per-hop INT against a reference rate
+ */
+class HpccCc : public RdmaCongestionControl
+{
+	public:
+		static TypeId GetTypeId();
+
+		HpccCc();
+		~HpccCc() override;
+
+		Ptr<RdmaCongestionControl> Copy() const override;
+
+		bool NeedsTelemetry() const override;
+
+	protected:
+		void DoInit() override;
+		void DoAck(const RdmaAck& ack) override;
+
+	private:
+		Time m_baseRtt;
+		double m_eta;
+		uint32_t m_maxStage;
+		double m_rateAI;
+
+		double m_u{0};
+		double m_refRate{0};
+		uint32_t m_incStage{0};
+		uint64_t m_lastUpdateSeq{0};
+		uint32_t m_nHops{0};
+		IntTag::Hop m_hops[IntTag::MAX_HOPS];
+};
+
+/**
+ * \brief Swift, delay from the send timestamp echoed in the ACK
+ */
+class SwiftCc : public RdmaCongestionControl
+{
+	public:
+		static TypeId GetTypeId();
+
+		SwiftCc();
+		~SwiftCc() override;
+
+		Ptr<RdmaCongestionControl> Copy() const override;
+
+		bool NeedsTelemetry() const override;
+
+	protected:
+		void DoInit() override;
+		void DoAck(const RdmaAck& ack) override;
+
+	private:
+		Time m_targetDelay;
+		double m_rateAI;
+		double m_beta;
+		double m_maxMdf;
+
+		int64_t m_lastDecrease{0};
+};
+
+} // namespace ns3
+
+#endif /* RDMA_CONGESTION_CONTROL_H */
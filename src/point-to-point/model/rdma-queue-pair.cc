@@ -7,9 +7,13 @@
 #include "ns3/tcp-socket.h"
 #include "ns3/udp-header.h"
 #include "ns3/bth-header.h"
+#include "ns3/reth-header.h"
+#include "ns3/fct-collector.h"
 
 #include "rdma-queue-pair.h"
 
+#include <cmath>
+
 namespace ns3
 {
 
@@ -23,10 +27,10 @@ RdmaQueuePair::GetTypeId()
     static TypeId tid = TypeId("ns3::RdmaQueuePair")
                             .SetParent<Object>()
                             .SetGroupName("PointToPoint")
-							.AddAttribute("SendSize",
-								"The amount of data to send each time.",
+							.AddAttribute("Burst",
+								"Token bucket depth in bytes, at least one packet.",
 								UintegerValue(1400),
-								MakeUintegerAccessor(&RdmaQueuePair::m_sendSize),
+								MakeUintegerAccessor(&RdmaQueuePair::m_burst),
 								MakeUintegerChecker<uint32_t>());
     return tid;
 }
@@ -40,170 +44,348 @@ RdmaQueuePair::GetQP()
 bool
 RdmaQueuePair::GetSending()
 {
-	return !(m_totalBytes == m_bytesAcked);
+	return !(m_totalBytes == m_bytesAcked) || !m_pendingReads.empty();
 }
 
 void
 RdmaQueuePair::SetFlow(uint32_t id, uint32_t totalBytes,
-	std::unordered_map<uint32_t, FlowInfo>* fctMp, FILE* fctFile)
+	std::unordered_map<uint32_t, FlowInfo>* fctMp, FctCollector* fct, Verb verb)
 {
-	m_id = id;
-	m_totalBytes += totalBytes;
+	m_fctMp = fctMp;
+	m_fct = fct;
+	PostSend(verb, totalBytes, id);
+}
 
-	m_cnpAlpha = false;
-	m_alpha = 1;
-	m_timeStage = 0;
-	m_sendRate = 12.1;
+void
+RdmaQueuePair::PostSend(Verb verb, uint32_t size, uint32_t flow)
+{
+	if(!GetSending()){
+		// The MTU is fixed once the QP has sent, the sequence space is aligned to it
+		if(m_mtu == 0)
+			m_mtu = m_device->GetRdmaMtu();
+		GetCongestionControl()->Init(m_device->GetDataRate().GetBitRate() / 8e9);
 
-	m_fctMp = fctMp;
-	m_fctFile = fctFile;
+		// Start with a full bucket so the first packet leaves at once
+		m_tokens = std::max(m_burst, m_mtu);
+		m_tokenTime = Simulator::Now().GetNanoSeconds();
+		m_device->AddQP(this);
+	}
 
-	m_device->AddQP(this);
+	// Every message starts at an MTU boundary, a READ request takes one slot
+	Message msg{verb, flow, size, m_totalBytes};
+	m_totalBytes = AlignUp(m_totalBytes + std::max<uint64_t>(GetPayloadSize(msg), 1));
+	m_messages[m_totalBytes] = msg;
+	if(verb == READ)
+		m_pendingReads.push_back(flow);
 
-	auto packet = GenerateNextPacket();
-	if(packet != nullptr) {
-		if (Ipv6Address::IsMatchingType(m_dstAddr))
-			m_device->Send(packet, m_device->GetBroadcast(), 0x86DD);
-		else
-			m_device->Send(packet, m_device->GetBroadcast(), 0x0800);
-	} else {
+	if(!HasPending())
 		std::cerr << "Nothing to send at the beginning" << std::endl;
+	m_device->ActivateQP(this);
+}
+
+void
+RdmaQueuePair::CompleteRead()
+{
+	if(m_pendingReads.empty()){
+		std::cerr << "READ response without request in QP " << m_qp << std::endl;
+		return;
 	}
-	m_nextSend = Simulator::Schedule(NanoSeconds(m_sendSize / m_sendRate), &RdmaQueuePair::ScheduleSend, this);
+	WriteFCT(m_pendingReads.front());
+	m_pendingReads.pop_front();
+}
+
+uint64_t
+RdmaQueuePair::AlignUp(uint64_t offset)
+{
+	return (offset + m_mtu - 1) / m_mtu * m_mtu;
+}
+
+uint32_t
+RdmaQueuePair::GetPayloadSize(const Message& msg)
+{
+	return msg.verb == READ ? 0 : msg.size;
 }
 
 void 
-RdmaQueuePair::WriteFCT(){
-	if((*m_fctMp)[m_id].end == 0){
-		(*m_fctMp)[m_id].end = Simulator::Now().GetNanoSeconds();
-		fprintf(m_fctFile, "%u,%u,%u,%u,%u,%u,%u\n",
-			(*m_fctMp)[m_id].index, (*m_fctMp)[m_id].src, (*m_fctMp)[m_id].dst,
-			(*m_fctMp)[m_id].size, (*m_fctMp)[m_id].start, (*m_fctMp)[m_id].end,
-			(*m_fctMp)[m_id].end - (*m_fctMp)[m_id].start
-		);
-		fflush(m_fctFile);
+RdmaQueuePair::WriteFCT(uint32_t flow){
+	if(m_fctMp == nullptr)
+		return;
+	if((*m_fctMp)[flow].end == 0){
+		(*m_fctMp)[flow].end = Simulator::Now().GetNanoSeconds();
+		m_fct->Record((*m_fctMp)[flow]);
+		if(m_rateFile != nullptr)
+			m_cc->WriteHistory(m_rateFile, flow);
 	}
 }
 
 bool
-RdmaQueuePair::ProcessACK(BthHeader& bth)
+RdmaQueuePair::ProcessACK(BthHeader& bth, const IntTag* tag)
 {
 	if(bth.GetId() != m_qp)
 		std::cerr << "QP ID does not match" << std::endl;
-	if(bth.GetACK()){
+	bool sack = m_device->IsSelectiveRepeat();
+	if(bth.GetACK() || (sack && bth.GetNACK())){
 		uint64_t seq = bth.GetSequence(m_bytesAcked);
-		m_bytesAcked = std::max(m_bytesAcked, seq);
+		uint64_t newlyAcked = 0;
+		if(seq > m_bytesAcked){
+			newlyAcked = seq - m_bytesAcked;
+			m_bytesAcked = seq;
+			RestartRto();
+		}
+		// WRITE and SEND complete when acknowledged, READ when the response arrives
+		while(!m_messages.empty() && m_messages.begin()->first <= m_bytesAcked){
+			const Message& msg = m_messages.begin()->second;
+			if(msg.verb == SEND || msg.verb == WRITE)
+				WriteFCT(msg.flow);
+			m_messages.erase(m_messages.begin());
+		}
 		if(m_bytesAcked > m_bytesSent){
 			std::cerr << "m_bytesAcked > m_bytesSent in RDMA" << std::endl;
 			m_bytesSent = m_bytesAcked;
 		}
 		else if(m_bytesAcked == m_totalBytes){
-			WriteFCT();
-			Simulator::Cancel(m_updateAlpha);
-			Simulator::Cancel(m_increaseRate);
-			Simulator::Cancel(m_nextSend);
+			Simulator::Cancel(m_rto);
+			m_sacked.clear();
+			m_retx.clear();
 			return true;
 		}
+		if(sack)
+			ProcessSACK(bth);
+
+		RdmaAck ack{Simulator::Now().GetNanoSeconds(), m_bytesAcked, newlyAcked,
+			m_bytesSent, bool(bth.GetCNP()), tag};
+		m_cc->OnAck(ack);
 	}
 	else if(bth.GetNACK()){
 		std::cerr << "Receive NACK" << std::endl;
 		m_bytesSent = m_bytesAcked;
-	}
-	else std::cerr << "Unknown BTH flags" << std::endl;
 
-	if(bth.GetCNP()){
-		DecreaseRate();
+		RdmaAck ack{Simulator::Now().GetNanoSeconds(), m_bytesAcked, 0,
+			m_bytesSent, bool(bth.GetCNP()), tag};
+		m_cc->OnAck(ack);
 	}
+	else std::cerr << "Unknown BTH flags" << std::endl;
 	
-	if(bth.GetNACK()){
-		Simulator::Cancel(m_nextSend);
-		auto packet = GenerateNextPacket();
-		if(packet != nullptr) {
-			if (Ipv6Address::IsMatchingType(m_dstAddr))
-				m_device->Send(packet, m_device->GetBroadcast(), 0x86DD);
-			else
-				m_device->Send(packet, m_device->GetBroadcast(), 0x0800);
-		} else {
-			std::cerr << "Nothing to send in NACK" << std::endl;
-		}
-		m_nextSend = Simulator::Schedule(NanoSeconds(m_sendSize / m_sendRate), &RdmaQueuePair::ScheduleSend, this);
-	}
+	// The ACK may have opened the window, or the NACK rewound it
+	m_device->ActivateQP(this);
 	return false;
 }
 
 void
-RdmaQueuePair::UpdateAlpha()
+RdmaQueuePair::ProcessSACK(BthHeader& bth)
 {
-	Simulator::Cancel(m_updateAlpha);
-	if(m_cnpAlpha) m_alpha = (1 - m_g) * m_alpha + m_g;
-	else m_alpha = (1 - m_g) * m_alpha;
-	m_cnpAlpha = false;
-	m_updateAlpha = Simulator::Schedule(MicroSeconds(9), &RdmaQueuePair::UpdateAlpha, this);
-}
+	m_sacked.erase(m_sacked.begin(), m_sacked.lower_bound(m_bytesAcked));
+	m_retx.erase(m_retx.begin(), m_retx.lower_bound(m_bytesAcked));
+	m_retxMark = std::max(m_retxMark, m_bytesAcked);
+	if(!bth.GetSACK())
+		return;
 
-void 
-RdmaQueuePair::DecreaseRate()
-{
-	m_cnpAlpha = true;
-	UpdateAlpha();
-	if(Simulator::Now().GetNanoSeconds() - m_prevCnpTime > 10000){
-		m_prevCnpTime = Simulator::Now().GetNanoSeconds();
-		m_targetRate = m_sendRate;
-		m_sendRate = std::max(m_minRate, m_sendRate * (1 - m_alpha / 2.0));
+	// Bit i covers the segment i segments past the cumulative ACK
+	uint64_t bitmap = bth.GetSackBitmap();
+	uint64_t segment = bth.GetSackSegment();
+	uint64_t highest = m_bytesAcked;
+	for(uint32_t i = 0; i < BthHeader::SACK_BITS && (bitmap >> i) != 0; ++i){
+		if((bitmap >> i) & 1){
+			uint64_t start = m_bytesAcked + i * segment;
+			m_sacked.insert(start);
+			m_retx.erase(start);
+			highest = start;
+		}
+	}
+
+	// Everything below the highest SACK is lost, each hole is resent once per round
+	for(uint64_t start = m_retxMark; start < highest; start += m_mtu){
+		if(m_sacked.find(start) == m_sacked.end())
+			m_retx.insert(start);
 	}
-	m_timeStage = 0;
-	Simulator::Cancel(m_increaseRate);
-	m_increaseRate = Simulator::Schedule(MicroSeconds(100), &RdmaQueuePair::IncreaseRate, this);
+	m_retxMark = std::max(m_retxMark, highest + segment);
 }
 
-void 
-RdmaQueuePair::IncreaseRate()
+void
+RdmaQueuePair::RestartRto()
 {
-	Simulator::Cancel(m_increaseRate);
-	if(m_timeStage > 0) m_targetRate = std::min(m_maxRate, m_targetRate + 0.05);
-	m_sendRate = (m_targetRate + m_sendRate) / 2.0;
-	m_timeStage += 1;
-	m_increaseRate = Simulator::Schedule(MicroSeconds(100), &RdmaQueuePair::IncreaseRate, this);
+	if(!m_device->IsRdmaRtoEnabled())
+		return;
+	// Pushing the deadline is cheaper than rescheduling on every ACK
+	m_rtoDeadline = Simulator::Now() + m_device->GetRdmaRto();
+	if(!m_rto.IsRunning())
+		m_rto = Simulator::Schedule(m_device->GetRdmaRto(), &RdmaQueuePair::Timeout, this);
 }
 
 void
-RdmaQueuePair::ScheduleSend()
+RdmaQueuePair::Timeout()
 {
-	if(!m_device->Available()){
-		m_nextSend = Simulator::Schedule(NanoSeconds(1000), &RdmaQueuePair::ScheduleSend, this);
+	if(m_bytesSent <= m_bytesAcked && m_retx.empty())
 		return;
-	}
-	if(m_totalBytes <= m_bytesSent)
+	if(Simulator::Now() < m_rtoDeadline){
+		m_rto = Simulator::Schedule(m_rtoDeadline - Simulator::Now(), &RdmaQueuePair::Timeout, this);
 		return;
-	auto packet = GenerateNextPacket();
-	if(packet != nullptr) {
-		if (Ipv6Address::IsMatchingType(m_dstAddr))
-			m_device->Send(packet, m_device->GetBroadcast(), 0x86DD);
-		else
-			m_device->Send(packet, m_device->GetBroadcast(), 0x0800);
 	}
-	m_nextSend = Simulator::Schedule(NanoSeconds(m_sendSize / m_sendRate), &RdmaQueuePair::ScheduleSend, this);
+
+	NS_LOG_INFO("RDMA timeout of QP " << m_qp << " at " << m_bytesAcked);
+	if(m_device->IsSelectiveRepeat()){
+		for(uint64_t start = m_bytesAcked; start < m_bytesSent; start += m_mtu){
+			if(m_sacked.find(start) == m_sacked.end())
+				m_retx.insert(start);
+		}
+		m_retxMark = m_bytesSent;
+	}
+	else
+		m_bytesSent = m_bytesAcked;
+
+	RestartRto();
+	m_device->ActivateQP(this);
 }
 
-Ptr<Packet>
-RdmaQueuePair::GenerateNextPacket()
+Ptr<RdmaCongestionControl>
+RdmaQueuePair::GetCongestionControl()
+{
+	if(m_cc == nullptr)
+		m_cc = m_device->CreateCongestionControl();
+	return m_cc;
+}
+
+void
+RdmaQueuePair::SetRateFile(FILE* rateFile)
+{
+	m_rateFile = rateFile;
+	if(m_rateFile != nullptr)
+		GetCongestionControl()->EnableHistory();
+}
+
+bool
+RdmaQueuePair::IsScheduled()
+{
+	return m_scheduled;
+}
+
+void
+RdmaQueuePair::SetScheduled(bool scheduled)
+{
+	m_scheduled = scheduled;
+}
+
+uint16_t
+RdmaQueuePair::GetProtocol()
 {
+	return Ipv6Address::IsMatchingType(m_dstAddr) ? 0x86DD : 0x0800;
+}
+
+bool
+RdmaQueuePair::HasPending()
+{
+	if(!m_retx.empty())
+		return true;
 	if(m_totalBytes <= m_bytesSent)
-		return nullptr;
+		return false;
+	// 1KB or BDP
+	return (m_bytesSent - m_bytesAcked) < std::max(1000.0, m_cc->GetRate() * 15000.0);
+}
+
+uint32_t
+RdmaQueuePair::GetSegmentSize(uint64_t start)
+{
+	const Message& msg = m_messages.upper_bound(start)->second;
+	return std::min<uint64_t>(msg.start + GetPayloadSize(msg) - start, m_mtu);
+}
+
+uint32_t
+RdmaQueuePair::GetNextSize()
+{
+	if(!m_retx.empty())
+		return GetSegmentSize(*m_retx.begin());
+	return GetSegmentSize(m_bytesSent);
+}
 
-	if((m_bytesSent - m_bytesAcked) >= std::max(1000.0, m_sendRate * 15000.0)){ // 1KB or BDP
+void
+RdmaQueuePair::RefillTokens()
+{
+	// The rate is in GB/s, i.e. bytes per ns
+	int64_t now = Simulator::Now().GetNanoSeconds();
+	m_tokens = std::min<double>(std::max(m_burst, m_mtu), m_tokens + (now - m_tokenTime) * m_cc->GetRate());
+	m_tokenTime = now;
+}
+
+int64_t
+RdmaQueuePair::GetReadyTime()
+{
+	RefillTokens();
+	double deficit = GetNextSize() - m_tokens;
+	if(deficit <= 0)
+		return m_tokenTime;
+	return m_tokenTime + int64_t(std::ceil(deficit / m_cc->GetRate()));
+}
+
+Ptr<Packet>
+RdmaQueuePair::GetNextPacket()
+{
+	if(!HasPending())
 		return nullptr;
+
+	uint64_t toSend = GetNextSize();
+	RefillTokens();
+	m_tokens -= toSend;
+
+	if(!m_retx.empty()){
+		uint64_t start = *m_retx.begin();
+		m_retx.erase(m_retx.begin());
+		if(!m_rto.IsRunning())
+			RestartRto();
+		return BuildPacket(start, toSend);
 	}
 
-	uint64_t toSend = std::min(m_totalBytes - m_bytesSent, uint64_t(m_sendSize));
+	Ptr<Packet> ret = BuildPacket(m_bytesSent, toSend);
+	m_bytesSent = AlignUp(m_bytesSent + std::max<uint64_t>(toSend, 1));
+	if(!m_rto.IsRunning())
+		RestartRto();
+	// std::cout << "Send: " << m_bytesSent << " " << toSend << " " << m_bytesAcked << std::endl;
+	return ret;
+}
+
+Ptr<Packet>
+RdmaQueuePair::BuildPacket(uint64_t start, uint32_t toSend)
+{
+	const Message& msg = m_messages.upper_bound(start)->second;
+	bool first = (start == msg.start);
+	bool last = (start + m_mtu >= msg.start + GetPayloadSize(msg));
+
+	uint8_t opcode;
+	if(msg.verb == READ)
+		opcode = BthHeader::OP_READ_REQUEST;
+	else if(msg.verb == WRITE)
+		opcode = first ? (last ? BthHeader::OP_WRITE_ONLY : BthHeader::OP_WRITE_FIRST)
+			: (last ? BthHeader::OP_WRITE_LAST : BthHeader::OP_WRITE_MIDDLE);
+	else if(msg.verb == READ_RESPONSE)
+		opcode = first ? (last ? BthHeader::OP_READ_RESPONSE_ONLY : BthHeader::OP_READ_RESPONSE_FIRST)
+			: (last ? BthHeader::OP_READ_RESPONSE_LAST : BthHeader::OP_READ_RESPONSE_MIDDLE);
+	else
+		opcode = first ? (last ? BthHeader::OP_SEND_ONLY : BthHeader::OP_SEND_FIRST)
+			: (last ? BthHeader::OP_SEND_LAST : BthHeader::OP_SEND_MIDDLE);
+
 	Ptr<Packet> ret = Create<Packet>(toSend);
 
+	if(BthHeader::HasReth(opcode)){
+		RethHeader reth_header;
+		reth_header.SetAddress(msg.start);
+		reth_header.SetKey(m_qp);
+		reth_header.SetLength(msg.size);
+		ret->AddHeader(reth_header);
+	}
+
+	// The sequence is the end of the packet, a READ request covers one byte
 	BthHeader bth_header;
+	bth_header.SetOpcode(opcode);
 	bth_header.SetSize(toSend);
 	bth_header.SetId(m_qp);
-	bth_header.SetSequence(m_bytesSent + toSend);
+	bth_header.SetSequence(start + std::max<uint32_t>(toSend, 1));
 	ret->AddHeader(bth_header);
 
+	if(m_cc->NeedsTelemetry()){
+		IntTag tag;
+		tag.SetTimestamp(Simulator::Now().GetNanoSeconds());
+		ret->AddPacketTag(tag);
+	}
+
 	UdpHeader udp_header;
 	udp_header.SetSourcePort(m_qp >> 16);
 	udp_header.SetDestinationPort(m_qp);
@@ -212,7 +394,7 @@ RdmaQueuePair::GenerateNextPacket()
 	if (Ipv6Address::IsMatchingType(m_dstAddr)){
 		Ipv6Header ipv6_header;
 		ipv6_header.SetEcn(Ipv6Header::EcnType::ECN_ECT0);
-		ipv6_header.SetPayloadLength(toSend + 20);
+		ipv6_header.SetPayloadLength(ret->GetSize());
 		ipv6_header.SetNextHeader(17);
 		ipv6_header.SetHopLimit(64);
 		ipv6_header.SetSource(Ipv6Address::ConvertFrom(m_srcAddr));
@@ -221,7 +403,7 @@ RdmaQueuePair::GenerateNextPacket()
 	} else {
 		Ipv4Header ipv4_header;
 		ipv4_header.SetEcn(Ipv4Header::EcnType::ECN_ECT0);
-		ipv4_header.SetPayloadSize(toSend + 20);
+		ipv4_header.SetPayloadSize(ret->GetSize());
 		ipv4_header.SetProtocol(17);
 		ipv4_header.SetTtl(64);
 		ipv4_header.SetSource(Ipv4Address::ConvertFrom(m_srcAddr));
@@ -229,8 +411,6 @@ RdmaQueuePair::GenerateNextPacket()
 		ret->AddHeader(ipv4_header);
 	}
 
-	m_bytesSent += toSend;
-	// std::cout << "Send: " << m_bytesSent << " " << toSend << " " << m_bytesAcked << std::endl;
 	return ret;
 }
 
@@ -6,9 +6,15 @@
 #include "ns3/socket-info.h"
 
 #include "bth-header.h"
+#include "int-tag.h"
+#include "rdma-congestion-control.h"
 #include "switch-node.h"
 #include "point-to-point-net-device.h"
 
+#include <deque>
+#include <map>
+#include <set>
+
 namespace ns3
 {
 
@@ -22,56 +28,96 @@ class RdmaQueuePair : public Object
     	RdmaQueuePair(Ptr<PointToPointNetDevice> device = nullptr, Address srcAddr = Address(), Address dstAddr = Address(), uint32_t qp = 0):
         	m_device(device), m_srcAddr(srcAddr), m_dstAddr(dstAddr), m_qp(qp){};
 
+		enum Verb : uint8_t
+		{
+			SEND,
+			WRITE,
+			READ,
+			READ_RESPONSE // posted by the responder NIC, completes silently
+		};
+
 		uint32_t GetQP();
 	
 		void SetFlow(uint32_t id, uint32_t totalBytes,
-			std::unordered_map<uint32_t, FlowInfo>* fctMp, FILE* fctFile);
+			std::unordered_map<uint32_t, FlowInfo>* fctMp, FctCollector* fct, Verb verb = SEND);
+
+		// Queue a message, segmented at the RdmaMtu of the NIC
+		void PostSend(Verb verb, uint32_t size, uint32_t flow);
+		// The last READ response packet of the oldest READ arrived in order
+		void CompleteRead();
 
 		bool GetSending();
 
-		bool ProcessACK(BthHeader& bth);
+		bool ProcessACK(BthHeader& bth, const IntTag* tag = nullptr);
+
+		Ptr<RdmaCongestionControl> GetCongestionControl();
+		// Rate history of every flow is appended to the file when it completes
+		void SetRateFile(FILE* rateFile);
 
-		void ScheduleSend();
+		// Used by the NIC arbiter, which pulls packets when the link is idle
+		bool HasPending();
+		int64_t GetReadyTime();
+		Ptr<Packet> GetNextPacket();
+		uint16_t GetProtocol();
+
+		bool IsScheduled();
+		void SetScheduled(bool scheduled);
 
 	private:
 		Ptr<PointToPointNetDevice> m_device;
 		Address m_srcAddr;
 		Address m_dstAddr;
 
-		bool m_cnpAlpha;
-
-		double m_alpha{1.0};
-		double m_g{1.0/256.0};
+		Ptr<RdmaCongestionControl> m_cc;
 
-		double m_targetRate; // GB/s
-		double m_sendRate{12.1};
-		double m_maxRate{12.5};
-		double m_minRate{0.1};
+		struct Message
+		{
+			Verb verb;
+			uint32_t flow;
+			uint32_t size;
+			uint64_t start;
+		};
 
 		uint32_t m_qp;
-		uint32_t m_id;
-		uint32_t m_timeStage{0};
-		uint32_t m_sendSize{1400};
+		uint32_t m_mtu{0};
+		uint32_t m_burst{1400};
+
+		// Token bucket refilled at m_sendRate, holding at most m_burst bytes
+		double m_tokens{0};
+		int64_t m_tokenTime{0};
+		bool m_scheduled{false};
 
 		uint64_t m_bytesAcked{0};
 		uint64_t m_bytesSent{0};
 		uint64_t m_totalBytes{0};
 
-		int64_t m_prevCnpTime{0};
+		// Unacknowledged messages keyed by the aligned end of their sequence range
+		std::map<uint64_t, Message> m_messages;
+		std::deque<uint32_t> m_pendingReads;
+
+		// Selective repeat scoreboard, segment starts above m_bytesAcked
+		std::set<uint64_t> m_sacked;
+		std::set<uint64_t> m_retx;
+		uint64_t m_retxMark{0};
+		EventId m_rto;
+		Time m_rtoDeadline;
 
-		FILE* m_fctFile;
+		FctCollector* m_fct{nullptr};
+		FILE* m_rateFile{nullptr};
 		std::unordered_map<uint32_t, FlowInfo>* m_fctMp{nullptr};
 
-		EventId m_updateAlpha;
-		EventId m_increaseRate;
-		EventId m_nextSend;
+		void WriteFCT(uint32_t flow);
+		uint64_t AlignUp(uint64_t offset);
+		uint32_t GetPayloadSize(const Message& msg);
 
-		void WriteFCT();
-		void UpdateAlpha();
-		void DecreaseRate();
-		void IncreaseRate();
+		void RefillTokens();
+		uint32_t GetNextSize();
+		uint32_t GetSegmentSize(uint64_t start);
+		Ptr<Packet> BuildPacket(uint64_t start, uint32_t size);
 
-		Ptr<Packet> GenerateNextPacket();
+		void ProcessSACK(BthHeader& bth);
+		void RestartRto();
+		void Timeout();
 };
 
 } // namespace ns3
@@ -0,0 +1,109 @@
+#include "reth-header.h"
+
+#include "ns3/abort.h"
+#include "ns3/assert.h"
+#include "ns3/header.h"
+#include "ns3/log.h"
+
+#include <iostream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("RethHeader");
+
+NS_OBJECT_ENSURE_REGISTERED(RethHeader);
+
+RethHeader::RethHeader()
+{
+    m_address = 0;
+    m_key = 0;
+    m_length = 0;
+}
+
+RethHeader::~RethHeader()
+{
+}
+
+TypeId
+RethHeader::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::RethHeader")
+                            .SetParent<Header>()
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<RethHeader>();
+    return tid;
+}
+
+TypeId
+RethHeader::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+void
+RethHeader::Print(std::ostream& os) const
+{
+    return;
+}
+
+uint32_t
+RethHeader::GetSerializedSize() const
+{
+    return 16;
+}
+
+void
+RethHeader::Serialize(Buffer::Iterator start) const
+{
+    start.WriteHtonU64(m_address);
+    start.WriteHtonU32(m_key);
+    start.WriteHtonU32(m_length);
+}
+
+uint32_t
+RethHeader::Deserialize(Buffer::Iterator start)
+{
+    m_address = start.ReadNtohU64();
+    m_key = start.ReadNtohU32();
+    m_length = start.ReadNtohU32();
+    return GetSerializedSize();
+}
+
+uint64_t
+RethHeader::GetAddress()
+{
+    return m_address;
+}
+
+void
+RethHeader::SetAddress(uint64_t address)
+{
+    m_address = address;
+}
+
+uint32_t
+RethHeader::GetKey()
+{
+    return m_key;
+}
+
+void
+RethHeader::SetKey(uint32_t key)
+{
+    m_key = key;
+}
+
+uint32_t
+RethHeader::GetLength()
+{
+    return m_length;
+}
+
+void
+RethHeader::SetLength(uint32_t length)
+{
+    m_length = length;
+}
+
+} // namespace ns3
@@ -0,0 +1,41 @@
+#ifndef RETH_HEADER_H
+#define RETH_HEADER_H
+
+#include "ns3/header.h"
+
+namespace ns3
+{
+
+class RethHeader: public Header
+{
+
+public:
+    RethHeader();
+    ~RethHeader() override;
+ 
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+ 
+    void Print(std::ostream& os) const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    uint32_t GetSerializedSize() const override;
+
+    uint64_t GetAddress();
+    void SetAddress(uint64_t address);
+
+    uint32_t GetKey();
+    void SetKey(uint32_t key);
+
+    uint32_t GetLength();
+    void SetLength(uint32_t length);
+    
+protected:
+    uint64_t m_address;
+    uint32_t m_key;
+    uint32_t m_length;
+};
+
+} // namespace ns3
+
+#endif /* RETH_HEADER_H */
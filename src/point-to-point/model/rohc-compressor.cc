@@ -1,8 +1,11 @@
 #include "rohc-compressor.h"
 
 #include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/udp-header.h"
 
 #include "port-header.h"
+#include "vxlan-header.h"
 #include "rohc-header.h"
 #include "rohc-ip-header.h"
 #include "rohc-hctcp-header.h"
@@ -19,19 +22,53 @@ RohcCompressor::GetTypeId()
 {
     static TypeId tid = TypeId("ns3::RohcCompressor")
                             .SetParent<Object>()
-                            .SetGroupName("PointToPoint");
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<RohcCompressor>()
+                            .AddAttribute("MaxContext",
+                                          "Number of compression contexts on this link",
+                                          UintegerValue(16384),
+                                          MakeUintegerAccessor(&RohcCompressor::SetMaxContext,
+                                                               &RohcCompressor::GetMaxContext),
+                                          MakeUintegerChecker<uint16_t>(1));
     return tid;
 }
 
 RohcCompressor::RohcCompressor()
 {
-    m_contextList.resize(m_maxContext);
 }
 
 RohcCompressor::~RohcCompressor()
 {
 }
 
+void
+RohcCompressor::SetVxLAN(uint32_t vxlan)
+{
+    m_vxlan = vxlan;
+}
+
+void
+RohcCompressor::SetMaxContext(uint16_t maxContext)
+{
+    m_maxContext = maxContext;
+    m_contextList.clear();
+    m_tunnelList.clear();
+}
+
+uint16_t
+RohcCompressor::GetMaxContext() const
+{
+    return m_maxContext;
+}
+
+RohcContext&
+RohcCompressor::GetContext(uint16_t index)
+{
+    if(m_contextList.empty())
+        m_contextList.resize(m_maxContext);
+    return m_contextList[index];
+}
+
 uint16_t 
 RohcCompressor::Process(Ptr<Packet> packet, uint16_t protocol)
 {
@@ -50,14 +87,15 @@ RohcCompressor::Process(Ptr<Packet> packet, uint16_t protocol)
         v4Id.m_dstPort= port_header.GetDestinationPort();
 
         uint16_t index = v4Id.hash(6) % m_maxContext;
-        if(m_contextList[index].flowV4Id == v4Id && Simulator::Now().GetNanoSeconds() - m_contextList[index].updateTimeNs <= 100000){
+        RohcContext& context = GetContext(index);
+        if(context.key.Match(v4Id) && Simulator::Now().GetNanoSeconds() - context.updateTimeNs <= 100000){
             if(v4Id.m_protocol == 6){
                 HcTcpHeader hctcp_header;
                 packet->RemoveHeader(hctcp_header);
                 RohcHcTcpHeader rohc_hctcp_header;
-                rohc_hctcp_header.SetHeader(m_contextList[index].hcTcpHeader, hctcp_header);
+                rohc_hctcp_header.SetHeader(context.tcp.Get(), hctcp_header);
                 packet->AddHeader(rohc_hctcp_header);
-                m_contextList[index].hcTcpHeader = hctcp_header;
+                context.tcp.Set(hctcp_header);
             }
 
             RohcIpHeader rohc_ip_header;
@@ -72,11 +110,13 @@ RohcCompressor::Process(Ptr<Packet> packet, uint16_t protocol)
         }
         else{
             if(v4Id.m_protocol == 6){
-                packet->PeekHeader(m_contextList[index].hcTcpHeader);
+                HcTcpHeader hctcp_header;
+                packet->PeekHeader(hctcp_header);
+                context.tcp.Set(hctcp_header);
             }
 
-            m_contextList[index].updateTimeNs = Simulator::Now().GetNanoSeconds();
-            m_contextList[index].flowV4Id = v4Id;
+            context.updateTimeNs = Simulator::Now().GetNanoSeconds();
+            context.key.Set(v4Id);
 
             packet->AddHeader(port_header);
             packet->AddHeader(ipv4_header);
@@ -94,6 +134,9 @@ RohcCompressor::Process(Ptr<Packet> packet, uint16_t protocol)
         Ipv6Header ipv6_header;
         packet->RemoveHeader(ipv6_header);
 
+        if(m_vxlan && ipv6_header.GetNextHeader() == 17)
+            return ProcessVxLAN(packet, ipv6_header);
+
         auto src_pair = Ipv6ToPair(ipv6_header.GetSource());
         auto dst_pair = Ipv6ToPair(ipv6_header.GetDestination());
 
@@ -110,14 +153,15 @@ RohcCompressor::Process(Ptr<Packet> packet, uint16_t protocol)
         v6Id.m_dstPort= port_header.GetDestinationPort();
 
         uint16_t index = v6Id.hash(6) % m_maxContext;
-        if(m_contextList[index].flowV6Id == v6Id && Simulator::Now().GetNanoSeconds() - m_contextList[index].updateTimeNs <= 100000){
+        RohcContext& context = GetContext(index);
+        if(context.key.Match(v6Id) && Simulator::Now().GetNanoSeconds() - context.updateTimeNs <= 100000){
             if(v6Id.m_protocol == 6){
                 HcTcpHeader hctcp_header;
                 packet->RemoveHeader(hctcp_header);
                 RohcHcTcpHeader rohc_hctcp_header;
-                rohc_hctcp_header.SetHeader(m_contextList[index].hcTcpHeader, hctcp_header);
+                rohc_hctcp_header.SetHeader(context.tcp.Get(), hctcp_header);
                 packet->AddHeader(rohc_hctcp_header);
-                m_contextList[index].hcTcpHeader = hctcp_header;
+                context.tcp.Set(hctcp_header);
             }
 
             RohcIpHeader rohc_ip_header;
@@ -136,9 +180,9 @@ RohcCompressor::Process(Ptr<Packet> packet, uint16_t protocol)
                 packet->PeekHeader(hctcp_header);
             }
 
-            m_contextList[index].updateTimeNs = Simulator::Now().GetNanoSeconds();
-            m_contextList[index].flowV6Id = v6Id;
-            m_contextList[index].hcTcpHeader = hctcp_header;
+            context.updateTimeNs = Simulator::Now().GetNanoSeconds();
+            context.key.Set(v6Id);
+            context.tcp.Set(hctcp_header);
 
             packet->AddHeader(port_header);
             packet->AddHeader(ipv6_header);
@@ -155,4 +199,104 @@ RohcCompressor::Process(Ptr<Packet> packet, uint16_t protocol)
     return protocol;
 }
 
+uint16_t
+RohcCompressor::ProcessVxLAN(Ptr<Packet> packet, Ipv6Header& ipv6_header)
+{
+    // Outer IPv6 + UDP + VXLAN + PPP + inner IPv6 + ports share one context
+    UdpHeader udp_header;
+    VxlanHeader vxlan_header;
+    PppHeader ppp_header;
+    Ipv6Header inner_header;
+    PortHeader port_header;
+
+    packet->RemoveHeader(udp_header);
+    packet->RemoveHeader(vxlan_header);
+    packet->RemoveHeader(ppp_header);
+    packet->RemoveHeader(inner_header);
+    packet->RemoveHeader(port_header);
+
+    auto src_pair = Ipv6ToPair(ipv6_header.GetSource());
+    auto dst_pair = Ipv6ToPair(ipv6_header.GetDestination());
+
+    FlowV6Id v6Id;
+    v6Id.m_srcIP[0] = src_pair.first;
+    v6Id.m_srcIP[1] = src_pair.second;
+    v6Id.m_dstIP[0] = dst_pair.first;
+    v6Id.m_dstIP[1] = dst_pair.second;
+    v6Id.m_protocol = ipv6_header.GetNextHeader();
+    v6Id.m_srcPort = udp_header.GetSourcePort();
+    v6Id.m_dstPort = udp_header.GetDestinationPort();
+
+    src_pair = Ipv6ToPair(inner_header.GetSource());
+    dst_pair = Ipv6ToPair(inner_header.GetDestination());
+
+    FlowV6Id innerId;
+    innerId.m_srcIP[0] = src_pair.first;
+    innerId.m_srcIP[1] = src_pair.second;
+    innerId.m_dstIP[0] = dst_pair.first;
+    innerId.m_dstIP[1] = dst_pair.second;
+    innerId.m_protocol = inner_header.GetNextHeader();
+    innerId.m_srcPort = port_header.GetSourcePort();
+    innerId.m_dstPort = port_header.GetDestinationPort();
+
+    uint16_t index = v6Id.hash(6) % m_maxContext;
+    RohcContext& context = GetContext(index);
+    if(m_tunnelList.empty())
+        m_tunnelList.resize(m_maxContext);
+    RohcTunnelContext& tunnel = m_tunnelList[index];
+    if(context.key.Match(v6Id) && tunnel.inner.Match(innerId) && tunnel.vni == vxlan_header.GetVni() &&
+        Simulator::Now().GetNanoSeconds() - context.updateTimeNs <= 100000){
+        if(innerId.m_protocol == 6){
+            HcTcpHeader hctcp_header;
+            packet->RemoveHeader(hctcp_header);
+            RohcHcTcpHeader rohc_hctcp_header;
+            rohc_hctcp_header.SetHeader(context.tcp.Get(), hctcp_header);
+            packet->AddHeader(rohc_hctcp_header);
+            context.tcp.Set(hctcp_header);
+        }
+
+        RohcIpHeader rohc_ip_header;
+        rohc_ip_header.SetIpv6Header(ipv6_header);
+        packet->AddHeader(rohc_ip_header);
+
+        RohcHeader rohc_header;
+        rohc_header.SetType(0);
+        rohc_header.SetCid(index);
+
+        packet->AddHeader(rohc_header);
+    }
+    else{
+        HcTcpHeader hctcp_header;
+        if(innerId.m_protocol == 6){
+            packet->PeekHeader(hctcp_header);
+        }
+
+        context.updateTimeNs = Simulator::Now().GetNanoSeconds();
+        context.key.Set(v6Id);
+        context.tcp.Set(hctcp_header);
+        tunnel.inner.Set(innerId);
+        tunnel.vni = vxlan_header.GetVni();
+
+        // A deserialized UdpHeader does not re-serialize its length, rebuild it
+        UdpHeader outer_udp;
+        outer_udp.SetSourcePort(udp_header.GetSourcePort());
+        outer_udp.SetDestinationPort(udp_header.GetDestinationPort());
+
+        packet->AddHeader(port_header);
+        packet->AddHeader(inner_header);
+        packet->AddHeader(ppp_header);
+        packet->AddHeader(vxlan_header);
+        packet->AddHeader(outer_udp);
+        packet->AddHeader(ipv6_header);
+
+        RohcHeader rohc_header;
+        rohc_header.SetType(1);
+        rohc_header.SetProfile(7);
+        rohc_header.SetCid(index);
+
+        packet->AddHeader(rohc_header);
+    }
+    return 0x0172;
+}
+
 } // namespace ns3
\ No newline at end of file
@@ -9,18 +9,27 @@
 
 #include "ppp-header.h"
 #include "hctcp-header.h"
+#include "rohc-header.h"
+#include "rohc-hctcp-header.h"
 
 namespace ns3
 {
 
+#pragma pack(push, 1)
 struct RohcContext
 {
-	int64_t updateTimeNs;
-	FlowV4Id flowV4Id;
-	FlowV6Id flowV6Id;
-	HcTcpHeader hcTcpHeader;
+	int64_t updateTimeNs{0};
+	RohcFlowKey key{};
+	RohcTcpFields tcp{};
 };
 
+struct RohcTunnelContext
+{
+	RohcFlowKey inner{};
+	uint32_t vni{0};
+};
+#pragma pack(pop)
+
 class RohcCompressor : public Object
 {
 	public:
@@ -31,9 +40,21 @@ class RohcCompressor : public Object
 
 		uint16_t Process(Ptr<Packet> packet, uint16_t protocol);
 
+		void SetVxLAN(uint32_t vxlan);
+
+		void SetMaxContext(uint16_t maxContext);
+		uint16_t GetMaxContext() const;
+
 	private:
+		uint32_t m_vxlan{0};
+
+		uint16_t ProcessVxLAN(Ptr<Packet> packet, Ipv6Header& ipv6_header);
+		RohcContext& GetContext(uint16_t index);
+
+		// Contexts are allocated on first use, tunnel state only when VxLAN is on
 		std::vector<RohcContext> m_contextList;
-		const uint16_t m_maxContext = 16384;
+		std::vector<RohcTunnelContext> m_tunnelList;
+		uint16_t m_maxContext{16384};
 };
 
 } // namespace ns3
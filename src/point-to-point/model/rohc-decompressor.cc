@@ -2,6 +2,9 @@
 
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv6-header.h"
+#include "ns3/node.h"
+#include "ns3/udp-header.h"
+#include "ns3/uinteger.h"
 
 #include "port-header.h"
 #include "rohc-header.h"
@@ -20,19 +23,39 @@ RohcDecompressor::GetTypeId()
 {
     static TypeId tid = TypeId("ns3::RohcDecompressor")
                             .SetParent<Object>()
-                            .SetGroupName("PointToPoint");
+                            .SetGroupName("PointToPoint")
+                            .AddConstructor<RohcDecompressor>()
+                            .AddAttribute("MaxContent",
+                                          "Number of decompression contexts on this link",
+                                          UintegerValue(16384),
+                                          MakeUintegerAccessor(&RohcDecompressor::SetMaxContent,
+                                                               &RohcDecompressor::GetMaxContent),
+                                          MakeUintegerChecker<uint16_t>(1));
     return tid;
 }
 
 RohcDecompressor::RohcDecompressor()
 {
-    m_contentList.resize(m_maxContent);
 }
 
 RohcDecompressor::~RohcDecompressor()
 {
 }
 
+void
+RohcDecompressor::SetMaxContent(uint16_t maxContent)
+{
+    m_maxContent = maxContent;
+    m_contentList.clear();
+    m_tunnelList.clear();
+}
+
+uint16_t
+RohcDecompressor::GetMaxContent() const
+{
+    return m_maxContent;
+}
+
 uint16_t 
 RohcDecompressor::Process(Ptr<Packet> packet)
 {
@@ -41,27 +64,99 @@ RohcDecompressor::Process(Ptr<Packet> packet)
 
     uint16_t protocol = 0x0800;
     uint16_t index = rohc_header.GetCid();
+    if(index >= m_maxContent){
+        NS_LOG_WARN("Cid " << index << " out of " << m_maxContent << " contexts, drop the packet");
+        return 0;
+    }
+    if(m_contentList.empty())
+        m_contentList.resize(m_maxContent);
     RohcContent& content = m_contentList[index];
 
     if(rohc_header.GetType() == 1){
         content.profile = rohc_header.GetProfile();
         if(content.profile == 4){
-            packet->RemoveHeader(content.ipv4Header);
-            packet->RemoveHeader(content.portHeader);
-            if(content.ipv4Header.GetProtocol() == 6){
-                packet->PeekHeader(content.hcTcpHeader);
+            Ipv4Header ipv4_header;
+            PortHeader port_header;
+            packet->RemoveHeader(ipv4_header);
+            packet->PeekHeader(port_header);
+            SaveIpv4(content, ipv4_header);
+            content.key.srcPort = port_header.GetSourcePort();
+            content.key.dstPort = port_header.GetDestinationPort();
+            if(content.key.protocol == 6){
+                HcTcpHeader hctcp_header;
+                packet->RemoveHeader(port_header);
+                packet->PeekHeader(hctcp_header);
+                content.tcp.Set(hctcp_header);
+                packet->AddHeader(port_header);
             }
-            packet->AddHeader(content.portHeader);
-            packet->AddHeader(content.ipv4Header);
+            packet->AddHeader(ipv4_header);
         }
         else if(content.profile == 6){
-            packet->RemoveHeader(content.ipv6Header);
-            packet->RemoveHeader(content.portHeader);
-            if(content.ipv6Header.GetNextHeader() == Ipv6Header::IPV6_TCP){
-                packet->PeekHeader(content.hcTcpHeader);
+            Ipv6Header ipv6_header;
+            PortHeader port_header;
+            packet->RemoveHeader(ipv6_header);
+            packet->PeekHeader(port_header);
+            SaveIpv6(content, ipv6_header);
+            content.key.srcPort = port_header.GetSourcePort();
+            content.key.dstPort = port_header.GetDestinationPort();
+            if(content.key.protocol == Ipv6Header::IPV6_TCP){
+                HcTcpHeader hctcp_header;
+                packet->RemoveHeader(port_header);
+                packet->PeekHeader(hctcp_header);
+                content.tcp.Set(hctcp_header);
+                packet->AddHeader(port_header);
             }
-            packet->AddHeader(content.portHeader);
-            packet->AddHeader(content.ipv6Header);
+            packet->AddHeader(ipv6_header);
+            protocol = 0x86DD;
+        }
+        else if(content.profile == 7){
+            if(m_tunnelList.empty())
+                m_tunnelList.resize(m_maxContent);
+            RohcTunnelContent& tunnel = m_tunnelList[index];
+
+            Ipv6Header ipv6_header;
+            UdpHeader udp_header;
+            VxlanHeader vxlan_header;
+            PppHeader ppp_header;
+            Ipv6Header inner_header;
+            PortHeader port_header;
+            packet->RemoveHeader(ipv6_header);
+            packet->RemoveHeader(udp_header);
+            packet->RemoveHeader(vxlan_header);
+            packet->RemoveHeader(ppp_header);
+            packet->RemoveHeader(inner_header);
+            packet->RemoveHeader(port_header);
+
+            SaveIpv6(content, ipv6_header);
+            content.key.srcPort = udp_header.GetSourcePort();
+            content.key.dstPort = udp_header.GetDestinationPort();
+
+            auto src_pair = Ipv6ToPair(inner_header.GetSource());
+            auto dst_pair = Ipv6ToPair(inner_header.GetDestination());
+            tunnel.inner.addr.v6.src[0] = src_pair.first;
+            tunnel.inner.addr.v6.src[1] = src_pair.second;
+            tunnel.inner.addr.v6.dst[0] = dst_pair.first;
+            tunnel.inner.addr.v6.dst[1] = dst_pair.second;
+            tunnel.inner.srcPort = port_header.GetSourcePort();
+            tunnel.inner.dstPort = port_header.GetDestinationPort();
+            tunnel.inner.protocol = inner_header.GetNextHeader();
+            tunnel.inner.version = 6;
+            tunnel.innerTrafficClass = inner_header.GetTrafficClass();
+            tunnel.innerFlowLabel = inner_header.GetFlowLabel();
+            tunnel.innerHopLimit = inner_header.GetHopLimit();
+            tunnel.vni = vxlan_header.GetVni();
+            tunnel.vxlanFlag = vxlan_header.GetFlag();
+            tunnel.pppProtocol = ppp_header.GetProtocol();
+            tunnel.pppPadding = ppp_header.GetPadding();
+            tunnel.payloadDelta = int32_t(inner_header.GetPayloadLength()) -
+                                    int32_t(ipv6_header.GetPayloadLength());
+
+            if(tunnel.inner.protocol == Ipv6Header::IPV6_TCP){
+                HcTcpHeader hctcp_header;
+                packet->PeekHeader(hctcp_header);
+                content.tcp.Set(hctcp_header);
+            }
+            AddVxLAN(packet, ipv6_header, content, tunnel);
             protocol = 0x86DD;
         }
     }
@@ -69,30 +164,56 @@ RohcDecompressor::Process(Ptr<Packet> packet)
         RohcIpHeader rohc_ip_header;
         packet->RemoveHeader(rohc_ip_header);
         if(content.profile == 4){
-            rohc_ip_header.GetIpv4Header(content.ipv4Header);
+            Ipv4Header ipv4_header = BuildIpv4(content);
+            rohc_ip_header.GetIpv4Header(ipv4_header);
             
-            if(content.ipv4Header.GetProtocol() == 6){
+            if(content.key.protocol == 6){
                 RohcHcTcpHeader rohc_hctcp_header;
                 packet->RemoveHeader(rohc_hctcp_header);
-                content.hcTcpHeader = rohc_hctcp_header.GetHeader(content.hcTcpHeader);
-                packet->AddHeader(content.hcTcpHeader);
+                HcTcpHeader hctcp_header = rohc_hctcp_header.GetHeader(content.tcp.Get());
+                content.tcp.Set(hctcp_header);
+                packet->AddHeader(hctcp_header);
             }
 
-            packet->AddHeader(content.portHeader);
-            packet->AddHeader(content.ipv4Header);
+            PortHeader port_header;
+            port_header.SetSourcePort(content.key.srcPort);
+            port_header.SetDestinationPort(content.key.dstPort);
+            packet->AddHeader(port_header);
+            packet->AddHeader(ipv4_header);
         }
         else if(content.profile == 6){
-            rohc_ip_header.GetIpv6Header(content.ipv6Header);
+            Ipv6Header ipv6_header = BuildIpv6(content);
+            rohc_ip_header.GetIpv6Header(ipv6_header);
             
-            if(content.ipv6Header.GetNextHeader() == Ipv6Header::IPV6_TCP){
+            if(content.key.protocol == Ipv6Header::IPV6_TCP){
+                RohcHcTcpHeader rohc_hctcp_header;
+                packet->RemoveHeader(rohc_hctcp_header);
+                HcTcpHeader hctcp_header = rohc_hctcp_header.GetHeader(content.tcp.Get());
+                content.tcp.Set(hctcp_header);
+                packet->AddHeader(hctcp_header);
+            }
+
+            PortHeader port_header;
+            port_header.SetSourcePort(content.key.srcPort);
+            port_header.SetDestinationPort(content.key.dstPort);
+            packet->AddHeader(port_header);
+            packet->AddHeader(ipv6_header);
+            protocol = 0x86DD;
+        }
+        else if(content.profile == 7 && !m_tunnelList.empty()){
+            RohcTunnelContent& tunnel = m_tunnelList[index];
+            Ipv6Header ipv6_header = BuildIpv6(content);
+            rohc_ip_header.GetIpv6Header(ipv6_header);
+
+            if(tunnel.inner.protocol == Ipv6Header::IPV6_TCP){
                 RohcHcTcpHeader rohc_hctcp_header;
                 packet->RemoveHeader(rohc_hctcp_header);
-                content.hcTcpHeader = rohc_hctcp_header.GetHeader(content.hcTcpHeader);
-                packet->AddHeader(content.hcTcpHeader);
+                HcTcpHeader hctcp_header = rohc_hctcp_header.GetHeader(content.tcp.Get());
+                content.tcp.Set(hctcp_header);
+                packet->AddHeader(hctcp_header);
             }
 
-            packet->AddHeader(content.portHeader);
-            packet->AddHeader(content.ipv6Header);
+            AddVxLAN(packet, ipv6_header, content, tunnel);
             protocol = 0x86DD;
         }
     }
@@ -100,4 +221,103 @@ RohcDecompressor::Process(Ptr<Packet> packet)
     return protocol;
 }
 
-} // namespace ns3
\ No newline at end of file
+void
+RohcDecompressor::SaveIpv4(RohcContent& content, const Ipv4Header& header)
+{
+    content.key.addr.v4.src = header.GetSource().Get();
+    content.key.addr.v4.dst = header.GetDestination().Get();
+    content.key.protocol = header.GetProtocol();
+    content.key.version = 4;
+    content.tos = header.GetTos();
+    content.identification = header.GetIdentification();
+    content.fragmentOffset = header.GetFragmentOffset();
+    content.fragmentFlags = (header.IsDontFragment() ? 1 : 0) | (header.IsLastFragment() ? 0 : 2);
+}
+
+void
+RohcDecompressor::SaveIpv6(RohcContent& content, const Ipv6Header& header)
+{
+    auto src_pair = Ipv6ToPair(header.GetSource());
+    auto dst_pair = Ipv6ToPair(header.GetDestination());
+    content.key.addr.v6.src[0] = src_pair.first;
+    content.key.addr.v6.src[1] = src_pair.second;
+    content.key.addr.v6.dst[0] = dst_pair.first;
+    content.key.addr.v6.dst[1] = dst_pair.second;
+    content.key.protocol = header.GetNextHeader();
+    content.key.version = 6;
+    content.tos = header.GetTrafficClass();
+    content.flowLabel = header.GetFlowLabel();
+}
+
+Ipv4Header
+RohcDecompressor::BuildIpv4(const RohcContent& content)
+{
+    Ipv4Header header;
+    if(Node::ChecksumEnabled())
+        header.EnableChecksum();
+    header.SetSource(Ipv4Address(content.key.addr.v4.src));
+    header.SetDestination(Ipv4Address(content.key.addr.v4.dst));
+    header.SetProtocol(content.key.protocol);
+    header.SetTos(content.tos);
+    header.SetIdentification(content.identification);
+    header.SetFragmentOffset(content.fragmentOffset);
+    if(content.fragmentFlags & 1)
+        header.SetDontFragment();
+    else
+        header.SetMayFragment();
+    if(content.fragmentFlags & 2)
+        header.SetMoreFragments();
+    else
+        header.SetLastFragment();
+    return header;
+}
+
+Ipv6Header
+RohcDecompressor::BuildIpv6(const RohcContent& content)
+{
+    Ipv6Header header;
+    header.SetSource(PairToIpv6({content.key.addr.v6.src[0], content.key.addr.v6.src[1]}));
+    header.SetDestination(PairToIpv6({content.key.addr.v6.dst[0], content.key.addr.v6.dst[1]}));
+    header.SetNextHeader(content.key.protocol);
+    header.SetTrafficClass(content.tos);
+    header.SetFlowLabel(content.flowLabel);
+    return header;
+}
+
+void
+RohcDecompressor::AddVxLAN(Ptr<Packet> packet, Ipv6Header& outer, RohcContent& content, RohcTunnelContent& tunnel)
+{
+    PortHeader port_header;
+    port_header.SetSourcePort(tunnel.inner.srcPort);
+    port_header.SetDestinationPort(tunnel.inner.dstPort);
+
+    Ipv6Header inner_header;
+    inner_header.SetSource(PairToIpv6({tunnel.inner.addr.v6.src[0], tunnel.inner.addr.v6.src[1]}));
+    inner_header.SetDestination(PairToIpv6({tunnel.inner.addr.v6.dst[0], tunnel.inner.addr.v6.dst[1]}));
+    inner_header.SetNextHeader(tunnel.inner.protocol);
+    inner_header.SetTrafficClass(tunnel.innerTrafficClass);
+    inner_header.SetFlowLabel(tunnel.innerFlowLabel);
+    inner_header.SetHopLimit(tunnel.innerHopLimit);
+    inner_header.SetPayloadLength(outer.GetPayloadLength() + tunnel.payloadDelta);
+
+    PppHeader ppp_header;
+    ppp_header.SetProtocol(tunnel.pppProtocol);
+    ppp_header.SetPadding(tunnel.pppPadding);
+
+    VxlanHeader vxlan_header;
+    vxlan_header.SetFlag(tunnel.vxlanFlag);
+    vxlan_header.SetVni(tunnel.vni);
+
+    UdpHeader udp_header;
+    udp_header.SetSourcePort(content.key.srcPort);
+    udp_header.SetDestinationPort(content.key.dstPort);
+
+    packet->AddHeader(port_header);
+    packet->AddHeader(inner_header);
+    packet->AddHeader(ppp_header);
+    packet->AddHeader(vxlan_header);
+    packet->AddHeader(udp_header);
+    packet->AddHeader(outer);
+}
+
+} // namespace ns3
@@ -10,19 +10,40 @@
 #include "ppp-header.h"
 #include "port-header.h"
 #include "hctcp-header.h"
+#include "vxlan-header.h"
+#include "rohc-header.h"
+#include "rohc-hctcp-header.h"
 
 namespace ns3
 {
 
+#pragma pack(push, 1)
 struct RohcContent
 {
-	uint8_t profile;
-	Ipv4Header ipv4Header;
-	Ipv6Header ipv6Header;
-	PortHeader portHeader;
-	HcTcpHeader hcTcpHeader;
+	RohcFlowKey key{};
+	RohcTcpFields tcp{};
+	uint32_t flowLabel{0};
+	uint16_t identification{0};
+	uint16_t fragmentOffset{0};
+	uint8_t profile{0};
+	uint8_t tos{0};
+	uint8_t fragmentFlags{0};
 };
 
+struct RohcTunnelContent
+{
+	RohcFlowKey inner{};
+	uint32_t vni{0};
+	uint32_t innerFlowLabel{0};
+	int32_t payloadDelta{0};
+	uint16_t pppProtocol{0};
+	uint8_t pppPadding{0};
+	uint8_t vxlanFlag{0};
+	uint8_t innerTrafficClass{0};
+	uint8_t innerHopLimit{0};
+};
+#pragma pack(pop)
+
 class RohcDecompressor : public Object
 {
 	public:
@@ -31,11 +52,23 @@ class RohcDecompressor : public Object
     	RohcDecompressor();
 		~RohcDecompressor();
 
+		// Protocol of the restored packet, 0 if it has to be dropped
 		uint16_t Process(Ptr<Packet> packet);
 
+		void SetMaxContent(uint16_t maxContent);
+		uint16_t GetMaxContent() const;
+
 	private:
+		void SaveIpv4(RohcContent& content, const Ipv4Header& header);
+		void SaveIpv6(RohcContent& content, const Ipv6Header& header);
+		Ipv4Header BuildIpv4(const RohcContent& content);
+		Ipv6Header BuildIpv6(const RohcContent& content);
+		void AddVxLAN(Ptr<Packet> packet, Ipv6Header& outer, RohcContent& content, RohcTunnelContent& tunnel);
+
+		// Contents are allocated on the first packet, tunnel state on the first VxLAN IR
 		std::vector<RohcContent> m_contentList;
-		const uint16_t m_maxContent = 16384;
+		std::vector<RohcTunnelContent> m_tunnelList;
+		uint16_t m_maxContent{16384};
 };
 
 } // namespace ns3
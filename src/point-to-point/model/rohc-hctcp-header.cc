@@ -17,6 +17,28 @@ NS_LOG_COMPONENT_DEFINE("RohcHcTcpHeader");
 
 NS_OBJECT_ENSURE_REGISTERED(RohcHcTcpHeader);
 
+void
+RohcTcpFields::Set(const HcTcpHeader& header)
+{
+    sequenceNumber = header.GetSequenceNumber().GetValue();
+    ackNumber = header.GetAckNumber().GetValue();
+    length = header.GetLength();
+    flags = header.GetFlags();
+    windowSize = header.GetWindowSize();
+}
+
+HcTcpHeader
+RohcTcpFields::Get() const
+{
+    HcTcpHeader header;
+    header.SetSequenceNumber(sequenceNumber);
+    header.SetAckNumber(ackNumber);
+    header.SetLength(length);
+    header.SetFlags(flags);
+    header.SetWindowSize(windowSize);
+    return header;
+}
+
 RohcHcTcpHeader::RohcHcTcpHeader()
 {
 }
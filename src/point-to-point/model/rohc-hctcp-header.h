@@ -6,6 +6,20 @@
 namespace ns3
 {
 
+#pragma pack(push, 1)
+struct RohcTcpFields
+{
+    uint32_t sequenceNumber;
+    uint32_t ackNumber;
+    uint8_t length;
+    uint8_t flags;
+    uint16_t windowSize;
+
+    void Set(const HcTcpHeader& header);
+    HcTcpHeader Get() const;
+};
+#pragma pack(pop)
+
 class RohcHcTcpHeader: public Header
 {
 
@@ -14,6 +14,45 @@ NS_LOG_COMPONENT_DEFINE("RohcHeader");
 
 NS_OBJECT_ENSURE_REGISTERED(RohcHeader);
 
+void
+RohcFlowKey::Set(const FlowV4Id& id)
+{
+    addr.v4.src = id.m_srcIP;
+    addr.v4.dst = id.m_dstIP;
+    srcPort = id.m_srcPort;
+    dstPort = id.m_dstPort;
+    protocol = id.m_protocol;
+    version = 4;
+}
+
+void
+RohcFlowKey::Set(const FlowV6Id& id)
+{
+    addr.v6.src[0] = id.m_srcIP[0];
+    addr.v6.src[1] = id.m_srcIP[1];
+    addr.v6.dst[0] = id.m_dstIP[0];
+    addr.v6.dst[1] = id.m_dstIP[1];
+    srcPort = id.m_srcPort;
+    dstPort = id.m_dstPort;
+    protocol = id.m_protocol;
+    version = 6;
+}
+
+bool
+RohcFlowKey::Match(const FlowV4Id& id) const
+{
+    return version == 4 && addr.v4.src == id.m_srcIP && addr.v4.dst == id.m_dstIP &&
+        srcPort == id.m_srcPort && dstPort == id.m_dstPort && protocol == id.m_protocol;
+}
+
+bool
+RohcFlowKey::Match(const FlowV6Id& id) const
+{
+    return version == 6 && addr.v6.src[0] == id.m_srcIP[0] && addr.v6.src[1] == id.m_srcIP[1] &&
+        addr.v6.dst[0] == id.m_dstIP[0] && addr.v6.dst[1] == id.m_dstIP[1] &&
+        srcPort == id.m_srcPort && dstPort == id.m_dstPort && protocol == id.m_protocol;
+}
+
 RohcHeader::RohcHeader()
 {
     m_type = 0;
@@ -3,9 +3,39 @@
 
 #include "ns3/header.h"
 
+#include "ppp-header.h"
+
 namespace ns3
 {
 
+#pragma pack(push, 1)
+struct RohcFlowKey
+{
+    union
+    {
+        struct
+        {
+            uint32_t src;
+            uint32_t dst;
+        } v4;
+        struct
+        {
+            uint64_t src[2];
+            uint64_t dst[2];
+        } v6;
+    } addr;
+    uint16_t srcPort;
+    uint16_t dstPort;
+    uint8_t protocol;
+    uint8_t version;
+
+    void Set(const FlowV4Id& id);
+    void Set(const FlowV6Id& id);
+    bool Match(const FlowV4Id& id) const;
+    bool Match(const FlowV6Id& id) const;
+};
+#pragma pack(pop)
+
 class RohcHeader : public Header
 {
   public:
@@ -1,6 +1,7 @@
 #include "switch-node.h"
 
 #include "ns3/application.h"
+#include "ns3/channel.h"
 #include "ns3/net-device.h"
 #include "ns3/node-list.h"
 #include "ns3/ipv4-header.h"
@@ -8,6 +9,7 @@
 
 #include "ns3/assert.h"
 #include "ns3/boolean.h"
+#include "ns3/double.h"
 #include "ns3/global-value.h"
 #include "ns3/log.h"
 #include "ns3/object-vector.h"
@@ -31,10 +33,10 @@
 
 #include "compress-ip-header.h"
 
-#include "ipv4-tag.h"
-#include "ipv6-tag.h"
-#include "packet-tag.h"
+#include "ideal-metadata.h"
 
+#include <map>
+#include <tuple>
 #include <unordered_set>
 #include <unordered_map>
 
@@ -45,6 +47,12 @@ NS_LOG_COMPONENT_DEFINE("SwitchNode");
 
 NS_OBJECT_ENSURE_REGISTERED(SwitchNode);
 
+Time SwitchNode::m_deadlockInterval;
+EventId SwitchNode::m_deadlockEvent;
+bool SwitchNode::m_deadlockRecover = false;
+uint64_t SwitchNode::m_deadlockCount = 0;
+std::map<std::tuple<uint32_t, uint32_t, uint32_t>, SwitchNode::DeadlockStall> SwitchNode::m_deadlockStalls;
+
 TypeId
 SwitchNode::GetTypeId()
 {
@@ -52,23 +60,68 @@ SwitchNode::GetTypeId()
         TypeId("ns3::SwitchNode")
             .SetParent<Node>()
             .SetGroupName("PointToPoint")
-            .AddConstructor<SwitchNode>();
+            .AddConstructor<SwitchNode>()
+            .AddAttribute("PfcClasses",
+                          "Bit mask of the lossless classes protected by PFC",
+                          UintegerValue(1 << 2),
+                          MakeUintegerAccessor(&SwitchNode::m_pfcClasses),
+                          MakeUintegerChecker<uint32_t>(0, 0xff))
+            .AddAttribute("PfcQuanta",
+                          "Pause time carried by PFC frames, in quanta of 512 bit times",
+                          UintegerValue(0xffff),
+                          MakeUintegerAccessor(&SwitchNode::m_pfcQuanta),
+                          MakeUintegerChecker<uint16_t>(1))
+            .AddAttribute("PfcRefresh",
+                          "Fraction of the pause time after which an asserted pause is refreshed",
+                          DoubleValue(0.5),
+                          MakeDoubleAccessor(&SwitchNode::m_pfcRefresh),
+                          MakeDoubleChecker<double>(0.01, 1.0))
+            .AddAttribute("PfcWatchdogTimeout",
+                          "Lift the pause on a non-empty egress class paused this long, 0 disables",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&SwitchNode::m_watchdogTimeout),
+                          MakeTimeChecker())
+            .AddAttribute("PfcWatchdogRecovery",
+                          "How long pause frames are ignored after the watchdog fires",
+                          TimeValue(MicroSeconds(100)),
+                          MakeTimeAccessor(&SwitchNode::m_watchdogRecovery),
+                          MakeTimeChecker());
     return tid;
 }
 
 SwitchNode::SwitchNode() : Node()
 {
-    Simulator::Schedule(Seconds(4), &SwitchNode::CheckEcnCount, this);
+    Construct();
+}
+
+SwitchNode::SwitchNode(uint32_t systemId) : Node(systemId)
+{
+    Construct();
+}
+
+void
+SwitchNode::Construct()
+{
+    m_random = CreateObject<UniformRandomVariable>();
+}
+
+void
+SwitchNode::DoInitialize()
+{
+    // Runs in the context of the switch, so in its own partition or rank
+    m_local = (GetSystemId() == Simulator::GetSystemId());
+    if(m_local)
+        Simulator::Schedule(Seconds(4), &SwitchNode::CheckEcnCount, this);
+    Node::DoInitialize();
 }
 
 SwitchNode::~SwitchNode()
 {
+    if(!m_local)
+        return;
     std::string out_file = m_output + ".node";
     FILE* fout = fopen(out_file.c_str(), "a");
-    uint64_t total = 0;
-    for(auto it = m_pauseDuration.begin(); it != m_pauseDuration.end(); ++it)
-        total += it->second;
-    fprintf(fout, "%d,%lu,%lu,%lu,%lu\n", m_nid, m_drops, m_ecnCount, m_pfcCount, total);
+    fprintf(fout, "%d,%lu,%lu,%lu,%lu,%lu\n", m_nid, m_drops, m_ecnCount, m_pfcCount, m_pauseDuration, m_watchdogCount);
     fclose(fout);
 }
 
@@ -95,12 +148,36 @@ SwitchNode::AddDevice(Ptr<NetDevice> device)
     m_devices.push_back(device);
     device->SetNode(this);
     device->SetIfIndex(index);
+    GetPfcPort(index);
     device->SetReceiveCallback(MakeCallback(&SwitchNode::ReceiveFromDevice, this));
     Simulator::ScheduleWithContext(GetId(), Seconds(0.0), &NetDevice::Initialize, device);
     NotifyDeviceAdded(device);
     return index;
 }
 
+void
+SwitchNode::CreateRohc(Ptr<NetDevice> dev)
+{
+    uint32_t index = dev->GetIfIndex();
+    if(m_rohcCom.size() <= index){
+        m_rohcCom.resize(index + 1);
+        m_rohcDecom.resize(index + 1);
+    }
+    if(m_rohcCom[index] != nullptr)
+        return;
+
+    uint16_t contexts = 16384;
+    Ptr<PointToPointNetDevice> p2pDev = DynamicCast<PointToPointNetDevice>(dev);
+    if(p2pDev != nullptr)
+        contexts = p2pDev->GetRohcContexts();
+
+    m_rohcCom[index] = CreateObject<RohcCompressor>();
+    m_rohcCom[index]->SetMaxContext(contexts);
+    m_rohcCom[index]->SetVxLAN(m_vxlan);
+    m_rohcDecom[index] = CreateObject<RohcDecompressor>();
+    m_rohcDecom[index]->SetMaxContent(contexts);
+}
+
 bool
 SwitchNode::ReceiveFromDevice(Ptr<NetDevice> device,
                                   Ptr<const Packet> p,
@@ -114,7 +191,7 @@ SwitchNode::ReceiveFromDevice(Ptr<NetDevice> device,
 void
 SwitchNode::SetECMPHash(uint32_t hashSeed)
 {
-    m_hashSeed = hashSeed;
+    m_route.hashSeed = hashSeed;
 }
 
 void
@@ -127,6 +204,18 @@ void
 SwitchNode::SetPFC(uint32_t pfc)
 {
     m_pfc = pfc;
+    if(m_pfc && m_watchdogTimeout.IsStrictlyPositive())
+        Simulator::ScheduleWithContext(GetId(), m_watchdogTimeout / 2, &SwitchNode::CheckPfcWatchdog, this);
+}
+
+void
+SwitchNode::SetVxLAN(uint32_t vxlan)
+{
+    m_vxlan = vxlan;
+    for(auto com : m_rohcCom){
+        if(com != nullptr)
+            com->SetVxLAN(vxlan);
+    }
 }
 
 void
@@ -144,7 +233,7 @@ SwitchNode::GetID()
 void
 SwitchNode::SetNextNode(uint16_t devId, uint16_t nodeId)
 {
-    m_node[devId] = nodeId;
+    m_route.node[devId] = nodeId;
 }
 
 void
@@ -159,13 +248,13 @@ SwitchNode::SetOutput(std::string output)
 void
 SwitchNode::AddHostRouteTo(Ipv4Address dest, uint32_t devId)
 {
-    m_v4route[dest.Get()].push_back(devId);
+    m_route.v4route[dest.Get()].push_back(devId);
 }
 
 void
 SwitchNode::AddHostRouteTo(Ipv6Address dest, uint32_t devId)
 {
-    m_v6route[Ipv6ToPair(dest)].push_back(devId);
+    m_route.v6route[Ipv6ToPair(dest)].push_back(devId);
 }
 
 void
@@ -176,44 +265,68 @@ SwitchNode::AddControlRouteTo(uint16_t id, uint32_t devId)
 
 
 uint16_t
-SwitchNode::GetNextDev(FlowV4Id id)
+SwitchNode::RouteTable::GetNextDev(const FlowV4Id& id) const
 {
-    const std::vector<uint32_t>& route_vec = m_v4route[id.m_dstIP];
-    if(route_vec.size() == 0){
-        std::cout << "Cannot find NextDev for Ipv6" << std::endl;
+    auto it = v4route.find(id.m_dstIP);
+    if(it == v4route.end() || it->second.size() == 0){
+        std::cout << "Cannot find NextDev for Ipv4" << std::endl;
         return 0xffff;
     }
 
-    uint32_t hashValue = 0;
-    if(route_vec.size() > 1)
-        hashValue = id.hash(m_hashSeed);
-    return route_vec[hashValue % route_vec.size()];
+    const std::vector<uint32_t>& route_vec = it->second;
+    if(route_vec.size() == 1)
+        return route_vec[0];
+    return route_vec[id.hash(hashSeed) % route_vec.size()];
 }
 
 uint16_t
-SwitchNode::GetNextDev(FlowV6Id id)
+SwitchNode::RouteTable::GetNextDev(const FlowV6Id& id) const
 {
-    const std::vector<uint32_t>& route_vec = m_v6route[
-        std::pair<uint64_t, uint64_t>(id.m_dstIP[0], id.m_dstIP[1])];
-    if(route_vec.size() == 0){
+    auto it = v6route.find(std::pair<uint64_t, uint64_t>(id.m_dstIP[0], id.m_dstIP[1]));
+    if(it == v6route.end() || it->second.size() == 0){
         std::cout << "Cannot find NextDev for Ipv6" << std::endl;
         return 0xffff;
     }
 
-    uint32_t hashValue = 0;
-    if(route_vec.size() > 1)
-        hashValue = id.hash(m_hashSeed);
-    return route_vec[hashValue % route_vec.size()];
+    const std::vector<uint32_t>& route_vec = it->second;
+    if(route_vec.size() == 1)
+        return route_vec[0];
+    return route_vec[id.hash(hashSeed) % route_vec.size()];
 }
 
 uint16_t
-SwitchNode::GetNextNode(uint16_t devId)
+SwitchNode::RouteTable::GetNextNode(uint16_t devId) const
 {
-    if(m_node.find(devId) == m_node.end()){
+    auto it = node.find(devId);
+    if(it == node.end()){
         std::cout << "Fail to find dev" << std::endl;
         return 0xffff;
     }
-    return m_node[devId];
+    return it->second;
+}
+
+uint16_t
+SwitchNode::GetNextDev(FlowV4Id id)
+{
+    return m_route.GetNextDev(id);
+}
+
+uint16_t
+SwitchNode::GetNextDev(FlowV6Id id)
+{
+    return m_route.GetNextDev(id);
+}
+
+uint16_t
+SwitchNode::GetNextNode(uint16_t devId)
+{
+    return m_route.GetNextNode(devId);
+}
+
+const SwitchNode::RouteTable&
+SwitchNode::GetRouteTable() const
+{
+    return m_route;
 }
 
 void
@@ -228,41 +341,53 @@ SwitchNode::EgressPipeline(Ptr<Packet> packet, uint16_t protocol, Ptr<NetDevice>
     packet->RemoveHeader(ppp);
 
     if(m_setting == 3 && (protocol == 0x0800 || protocol == 0x86DD)){
-        if(m_rohcCom.find(dev) == m_rohcCom.end()){
-            m_rohcCom[dev] = CreateObject<RohcCompressor>();
-        }
-        protocol = m_rohcCom[dev]->Process(packet, protocol);
+        // Created on first use, once the link and its contexts are known
+        if(dev->GetIfIndex() >= m_rohcCom.size() || m_rohcCom[dev->GetIfIndex()] == nullptr)
+            CreateRohc(dev);
+        protocol = m_rohcCom[dev->GetIfIndex()]->Process(packet, protocol);
         ppp.SetProtocol(PointToPointNetDevice::EtherToPpp(protocol));
     }
 
     if(protocol != 0x0170 && protocol != 0x8808){
-        PacketTag packetTag;
-        if(!packet->PeekPacketTag(packetTag))
-            std::cerr << "Fail to find packetTag" << std::endl;
-        m_userSize -= packetTag.GetSize();
-        Ptr<NetDevice> ingressDev = packetTag.GetNetDevice();
-        m_ingressSize[ingressDev] -= packetTag.GetSize();
-        if(m_userSize < 0){
-            std::cout << "Error for userSize in Switch " << m_nid << std::endl;
-            std::cout << "Egress size : " << m_userSize << std::endl;
-        }
-        if(m_ingressSize[ingressDev] < 0){
-            std::cout << "Error for ingressSize in Switch " << m_nid << std::endl;
-            std::cout << "Egress size : " << m_ingressSize[ingressDev] << std::endl;
-        }
-        if(m_pause[ingressDev]){
-            if(m_ingressSize[ingressDev] < m_resumeNicThd || (m_nicDevices.find(ingressDev) == m_nicDevices.end() && m_ingressSize[ingressDev] < m_resumeThd)){
-                m_pause[ingressDev] = false;
-                m_pauseDuration[ingressDev] = Simulator::Now().GetNanoSeconds() - m_pauseTime[ingressDev];
-                Simulator::Schedule(NanoSeconds(1), &SwitchNode::SendPFC, this, ingressDev, false);
-            }
-        }
+        if(ReleaseIngress(packet))
+            UpdateEgressSize(packet, dev->GetIfIndex(), false);
     }
 
     packet->AddHeader(ppp);
     return packet;
 }
 
+bool
+SwitchNode::ReleaseIngress(Ptr<Packet> packet)
+{
+    uint32_t size = 0, port = 0;
+    if(!packet->PeekSlot(Packet::SLOT_ENQUEUE_SIZE, size) || !packet->PeekSlot(Packet::SLOT_INGRESS_PORT, port)){
+        std::cerr << "Fail to find ingress slots" << std::endl;
+        return false;
+    }
+    uint32_t cls = 0;
+    packet->PeekSlot(Packet::SLOT_PRIORITY, cls);
+    cls = std::min<uint32_t>(cls, PfcHeader::PRIORITY_NUM - 1);
+
+    m_userSize -= size;
+    Ptr<NetDevice> ingressDev = m_devices[port];
+    PfcPortState& state = GetPfcPort(port);
+    state.ingressSize[cls] -= size;
+    if(m_userSize < 0){
+        std::cout << "Error for userSize in Switch " << m_nid << std::endl;
+        std::cout << "Egress size : " << m_userSize << std::endl;
+    }
+    if(state.ingressSize[cls] < 0){
+        std::cout << "Error for ingressSize in Switch " << m_nid << std::endl;
+        std::cout << "Egress size : " << state.ingressSize[cls] << std::endl;
+    }
+    if(state.pause[cls]){
+        if(state.ingressSize[cls] < int32_t(m_resumeNicThd) || (m_nicDevices.find(ingressDev) == m_nicDevices.end() && state.ingressSize[cls] < int32_t(m_resumeThd)))
+            ResumePort(port, cls);
+    }
+    return true;
+}
+
 bool
 SwitchNode::IngressPipeline(Ptr<Packet> packet, uint16_t protocol, Ptr<NetDevice> dev){
     if(protocol != 0x0170){
@@ -273,29 +398,34 @@ SwitchNode::IngressPipeline(Ptr<Packet> packet, uint16_t protocol, Ptr<NetDevice
             return false;
         }
         else{
-            PacketTag packetTag;
-            packetTag.SetSize(packet->GetSize());
-            packetTag.SetNetDevice(dev);
-            packet->ReplacePacketTag(packetTag);
+            uint32_t port = dev->GetIfIndex();
+            uint32_t cls = 0;
+            packet->PeekSlot(Packet::SLOT_PRIORITY, cls);
+            cls = std::min<uint32_t>(cls, PfcHeader::PRIORITY_NUM - 1);
+
+            packet->SetSlot(Packet::SLOT_ENQUEUE_SIZE, packet->GetSize());
+            packet->SetSlot(Packet::SLOT_INGRESS_PORT, port);
             m_userSize += packet->GetSize();
-            m_ingressSize[dev] += packet->GetSize();
-
-            if(!m_pause[dev] && m_pfc){
-                if(m_ingressSize[dev] > m_pfcThd || (m_nicDevices.find(dev) != m_nicDevices.end() && m_ingressSize[dev] > m_pfcNicThd)){
-                    m_pfcCount += 1;
-                    m_pause[dev] = true;
-                    m_pauseTime[dev] = Simulator::Now().GetNanoSeconds();
-                    Simulator::Schedule(NanoSeconds(1), &SwitchNode::SendPFC, this, dev, true);
-                }
+            PfcPortState& state = GetPfcPort(port);
+            state.ingressSize[cls] += packet->GetSize();
+
+            if(m_pfc && ((m_pfcClasses >> cls) & 1) && !state.pause[cls]){
+                if(state.ingressSize[cls] > int32_t(m_pfcThd) || (m_nicDevices.find(dev) != m_nicDevices.end() && state.ingressSize[cls] > int32_t(m_pfcNicThd)))
+                    PausePort(port, cls);
             }
         }
     }
 
     if(protocol == 0x0172){
-        if(m_rohcDecom.find(dev) == m_rohcDecom.end()){
-            m_rohcDecom[dev] = CreateObject<RohcDecompressor>();
+        if(dev->GetIfIndex() >= m_rohcDecom.size() || m_rohcDecom[dev->GetIfIndex()] == nullptr)
+            CreateRohc(dev);
+        protocol = m_rohcDecom[dev->GetIfIndex()]->Process(packet);
+        if(protocol == 0){
+            // No context for it, the packet leaves the buffer here
+            m_drops += 1;
+            ReleaseIngress(packet);
+            return false;
         }
-        protocol = m_rohcDecom[dev]->Process(packet);
     }
 
     uint8_t ttl = 64;
@@ -341,7 +471,7 @@ SwitchNode::IngressPipeline(Ptr<Packet> packet, uint16_t protocol, Ptr<NetDevice
             }
 
             const std::vector<uint32_t>& route_vec = m_idroute[cmd.GetDestinationId()];
-            devId = route_vec[rand() % route_vec.size()];
+            devId = route_vec[m_random->GetInteger(0, route_vec.size() - 1)];
         }
     }
     else if(protocol == 0x8847){
@@ -364,53 +494,47 @@ SwitchNode::IngressPipeline(Ptr<Packet> packet, uint16_t protocol, Ptr<NetDevice
         mpls_header.SetLabel(m_mplsroute[label].first);
         packet->AddHeader(mpls_header);
 
+        // Charged first, the device may transmit it right away
+        UpdateEgressSize(packet, m_mplsroute[label].second, true);
         if(!m_devices[m_mplsroute[label].second]->Send(packet, m_devices[m_mplsroute[label].second]->GetBroadcast(), 0x8847)){
+            UpdateEgressSize(packet, m_mplsroute[label].second, false);
             std::cout << "Fail to send packet for MPLS in SwitchNode" << std::endl;
             return false;
         }
         return true;
     }
     else if(protocol == 0x0171){
-        Ipv4Tag ipv4Tag;
-        Ipv6Tag ipv6Tag;
-
-        Ipv4Header ipv4_header;
-        Ipv6Header ipv6_header;
-        PortHeader port_header;
-
-        if (packet->PeekPacketTag(ipv4Tag)){
-            ipv4Tag.GetHeader(ipv4_header, port_header);
+        Ptr<const IdealMetadata> metadata = DynamicCast<const IdealMetadata>(packet->GetSideChannel());
+        if(metadata == nullptr){
+            std::cout << "Fail to find ideal metadata" << std::endl;
+            return false;
+        }
 
+        if(metadata->version == 4){
             FlowV4Id v4Id;
-            v4Id.m_srcIP = ipv4_header.GetSource().Get();
-            v4Id.m_dstIP = ipv4_header.GetDestination().Get();
-            v4Id.m_protocol = ipv4_header.GetProtocol();
-            v4Id.m_srcPort = port_header.GetSourcePort();
-            v4Id.m_dstPort= port_header.GetDestinationPort();
+            v4Id.m_srcIP = metadata->ipv4Header.GetSource().Get();
+            v4Id.m_dstIP = metadata->ipv4Header.GetDestination().Get();
+            v4Id.m_protocol = metadata->ipv4Header.GetProtocol();
+            v4Id.m_srcPort = metadata->portHeader.GetSourcePort();
+            v4Id.m_dstPort= metadata->portHeader.GetDestinationPort();
 
             devId = GetNextDev(v4Id);
         }
-        else if(packet->PeekPacketTag(ipv6Tag)){
-            ipv6Tag.GetHeader(ipv6_header, port_header);
-
-            auto src_pair = Ipv6ToPair(ipv6_header.GetSource());
-            auto dst_pair = Ipv6ToPair(ipv6_header.GetDestination());
+        else{
+            auto src_pair = Ipv6ToPair(metadata->ipv6Header.GetSource());
+            auto dst_pair = Ipv6ToPair(metadata->ipv6Header.GetDestination());
 
             FlowV6Id v6Id;
             v6Id.m_srcIP[0] = src_pair.first;
             v6Id.m_srcIP[1] = src_pair.second;
             v6Id.m_dstIP[0] = dst_pair.first;
             v6Id.m_dstIP[1] = dst_pair.second;
-            v6Id.m_protocol = ipv6_header.GetNextHeader();
-            v6Id.m_srcPort = port_header.GetSourcePort();
-            v6Id.m_dstPort= port_header.GetDestinationPort();
+            v6Id.m_protocol = metadata->ipv6Header.GetNextHeader();
+            v6Id.m_srcPort = metadata->portHeader.GetSourcePort();
+            v6Id.m_dstPort= metadata->portHeader.GetDestinationPort();
 
             devId = GetNextDev(v6Id);
         }
-        else{
-            std::cout << "Fail to find tag" << std::endl;
-            return false;
-        }
     }
     else{
         std::cout << "Unknown Protocol for IngressPipeline" << std::endl;
@@ -428,31 +552,261 @@ SwitchNode::IngressPipeline(Ptr<Packet> packet, uint16_t protocol, Ptr<NetDevice
     }
 
     Ptr<NetDevice> device = m_devices[devId];
+    if(protocol != 0x0170)
+        UpdateEgressSize(packet, devId, true);
     if(!device->Send(packet, device->GetBroadcast(), protocol)){
+        if(protocol != 0x0170)
+            UpdateEgressSize(packet, devId, false);
         std::cout << "Fail to send packet in SwitchNode" << std::endl;
         return false;
     }
     return true;
 }
 
+void
+SwitchNode::UpdateEgressSize(Ptr<Packet> packet, uint32_t egress, bool add)
+{
+    uint32_t size = 0, port = 0, cls = 0;
+    if(!packet->PeekSlot(Packet::SLOT_ENQUEUE_SIZE, size) || !packet->PeekSlot(Packet::SLOT_INGRESS_PORT, port))
+        return;
+    packet->PeekSlot(Packet::SLOT_PRIORITY, cls);
+    cls = std::min<uint32_t>(cls, PfcHeader::PRIORITY_NUM - 1);
+    std::vector<int32_t>& egressSize = GetPfcPort(port).egressSize[cls];
+    if(egressSize.size() <= egress)
+        egressSize.resize(egress + 1, 0);
+    egressSize[egress] += add ? int32_t(size) : -int32_t(size);
+}
+
 void
 SwitchNode::UpdateMplsRoute(CommandHeader cmd)
 {
     m_mplsroute[cmd.GetLabel()] = std::pair<uint16_t, uint16_t>(cmd.GetNewLabel(), cmd.GetPort());
 }
 
+SwitchNode::PfcPortState&
+SwitchNode::GetPfcPort(uint32_t port)
+{
+    if(m_pfcPorts.size() <= port)
+        m_pfcPorts.resize(port + 1);
+    return m_pfcPorts[port];
+}
+
+bool
+SwitchNode::IsPausing(uint32_t port, uint32_t cls)
+{
+    return port < m_pfcPorts.size() && cls < PfcHeader::PRIORITY_NUM && m_pfcPorts[port].pause[cls];
+}
+
+Time
+SwitchNode::GetPauseTime(Ptr<NetDevice> dev)
+{
+    Ptr<PointToPointNetDevice> p2pDev = DynamicCast<PointToPointNetDevice>(dev);
+    if(p2pDev == nullptr)
+        return Time(0);
+    return p2pDev->GetDataRate().CalculateBytesTxTime(uint32_t(m_pfcQuanta) * 64);
+}
+
+void
+SwitchNode::PausePort(uint32_t port, uint32_t cls)
+{
+    PfcPortState& state = GetPfcPort(port);
+    m_pfcCount += 1;
+    state.pause[cls] = true;
+    state.pauseTime[cls] = Simulator::Now().GetNanoSeconds();
+    Simulator::Schedule(NanoSeconds(1), &SwitchNode::SendPFC, this, m_devices[port], cls, m_pfcQuanta);
+
+    // Refresh well before the peer's pause timer runs out
+    Time pauseTime = GetPauseTime(m_devices[port]);
+    if(pauseTime.IsStrictlyPositive())
+        state.refresh[cls] = Simulator::Schedule(NanoSeconds(1) + pauseTime * m_pfcRefresh,
+                                                 &SwitchNode::RefreshPFC, this, port, cls);
+}
+
+void
+SwitchNode::ResumePort(uint32_t port, uint32_t cls)
+{
+    PfcPortState& state = GetPfcPort(port);
+    state.pause[cls] = false;
+    state.refresh[cls].Cancel();
+    m_pauseDuration += Simulator::Now().GetNanoSeconds() - state.pauseTime[cls];
+    Simulator::Schedule(NanoSeconds(1), &SwitchNode::SendPFC, this, m_devices[port], cls, 0);
+}
+
+void
+SwitchNode::RefreshPFC(uint32_t port, uint32_t cls)
+{
+    PfcPortState& state = GetPfcPort(port);
+    if(!state.pause[cls])
+        return;
+    SendPFC(m_devices[port], cls, m_pfcQuanta);
+    state.refresh[cls] = Simulator::Schedule(GetPauseTime(m_devices[port]) * m_pfcRefresh,
+                                             &SwitchNode::RefreshPFC, this, port, cls);
+}
+
+void
+SwitchNode::CheckPfcWatchdog()
+{
+    for(auto dev : m_devices){
+        Ptr<PointToPointNetDevice> p2pDev = DynamicCast<PointToPointNetDevice>(dev);
+        if(p2pDev == nullptr)
+            continue;
+        Ptr<PointToPointQueue> queue = DynamicCast<PointToPointQueue>(p2pDev->GetQueue());
+        if(queue == nullptr)
+            continue;
+        for(uint32_t cls = 0; cls < PfcHeader::PRIORITY_NUM; ++cls){
+            if(queue->GetNBytes(cls) > 0 &&
+                queue->GetPausedFor(cls) >= uint64_t(m_watchdogTimeout.GetNanoSeconds())){
+                m_watchdogCount += 1;
+                std::cout << "PFC watchdog fires in Switch " << m_nid << " port " << dev->GetIfIndex() << " class " << cls << std::endl;
+                p2pDev->RecoverPfc(cls, m_watchdogRecovery);
+            }
+        }
+    }
+    Simulator::Schedule(m_watchdogTimeout / 2, &SwitchNode::CheckPfcWatchdog, this);
+}
+
+void
+SwitchNode::StartDeadlockDetector(Time interval, bool recover)
+{
+    m_deadlockInterval = interval;
+    m_deadlockRecover = recover;
+    m_deadlockEvent.Cancel();
+    m_deadlockStalls.clear();
+    if(interval.IsStrictlyPositive())
+        m_deadlockEvent = Simulator::Schedule(interval, &SwitchNode::CheckDeadlock);
+}
+
+uint64_t
+SwitchNode::GetDeadlockCount()
+{
+    return m_deadlockCount;
+}
+
+void
+SwitchNode::CheckDeadlock()
+{
+    // A hop is an egress class of a switch holding packets while paused by its peer,
+    // and that has sent nothing since the last check. Hop a waits on hop b if the
+    // peer of a is pausing that link and holds bytes from it bound for b.
+    struct Hop
+    {
+        Ptr<SwitchNode> node;
+        Ptr<PointToPointNetDevice> dev;
+        uint32_t cls;
+        DeadlockStall* stall;
+    };
+    std::vector<Hop> hops;
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, uint32_t> index;
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, DeadlockStall> stalls;
+
+    for(auto it = NodeList::Begin(); it != NodeList::End(); ++it){
+        Ptr<SwitchNode> node = DynamicCast<SwitchNode>(*it);
+        if(node == nullptr)
+            continue;
+        for(auto dev : node->m_devices){
+            Ptr<PointToPointNetDevice> p2pDev = DynamicCast<PointToPointNetDevice>(dev);
+            if(p2pDev == nullptr)
+                continue;
+            Ptr<PointToPointQueue> queue = DynamicCast<PointToPointQueue>(p2pDev->GetQueue());
+            if(queue == nullptr)
+                continue;
+            for(uint32_t cls = 0; cls < PfcHeader::PRIORITY_NUM; ++cls){
+                if(!queue->IsPaused(cls) || queue->GetNBytes(cls) == 0)
+                    continue;
+                auto key = std::make_tuple(node->GetId(), dev->GetIfIndex(), cls);
+                DeadlockStall stall{queue->GetTxBytes(cls), 0, false};
+                auto last = m_deadlockStalls.find(key);
+                if(last != m_deadlockStalls.end() && last->second.txBytes == stall.txBytes){
+                    stall.checks = last->second.checks + 1;
+                    stall.reported = last->second.reported;
+                }
+                DeadlockStall& kept = (stalls[key] = stall);
+                if(stall.checks > 0){
+                    index[key] = hops.size();
+                    hops.push_back(Hop{node, p2pDev, cls, &kept});
+                }
+            }
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> next(hops.size());
+    for(uint32_t i = 0; i < hops.size(); ++i){
+        Ptr<Channel> channel = hops[i].dev->GetChannel();
+        if(channel == nullptr || channel->GetNDevices() != 2)
+            continue;
+        Ptr<NetDevice> peer = channel->GetDevice(0) == hops[i].dev ? channel->GetDevice(1) : channel->GetDevice(0);
+        Ptr<SwitchNode> peerNode = DynamicCast<SwitchNode>(peer->GetNode());
+        if(peerNode == nullptr || !peerNode->IsPausing(peer->GetIfIndex(), hops[i].cls))
+            continue;
+        const std::vector<int32_t>& egressSize = peerNode->GetPfcPort(peer->GetIfIndex()).egressSize[hops[i].cls];
+        for(uint32_t port = 0; port < egressSize.size(); ++port){
+            if(egressSize[port] <= 0)
+                continue;
+            auto it = index.find(std::make_tuple(peerNode->GetId(), port, hops[i].cls));
+            if(it != index.end())
+                next[i].push_back(it->second);
+        }
+    }
+
+    // Iterative DFS, a back edge closes a cycle
+    std::vector<uint8_t> color(hops.size(), 0);
+    std::vector<uint32_t> parent(hops.size(), 0);
+    for(uint32_t root = 0; root < hops.size(); ++root){
+        if(color[root] != 0)
+            continue;
+        std::vector<std::pair<uint32_t, uint32_t>> stack{{root, 0}};
+        color[root] = 1;
+        while(!stack.empty()){
+            uint32_t u = stack.back().first;
+            uint32_t& edge = stack.back().second;
+            if(edge == next[u].size()){
+                color[u] = 2;
+                stack.pop_back();
+                continue;
+            }
+            uint32_t v = next[u][edge++];
+            if(color[v] == 0){
+                color[v] = 1;
+                parent[v] = u;
+                stack.push_back({v, 0});
+            }
+            else if(color[v] == 1){
+                std::vector<uint32_t> cycle{u};
+                while(cycle.back() != v)
+                    cycle.push_back(parent[cycle.back()]);
+                // A deadlock left in place is counted once
+                bool reported = true;
+                for(uint32_t hop : cycle){
+                    reported = reported && hops[hop].stall->reported;
+                    hops[hop].stall->reported = true;
+                }
+                if(reported)
+                    continue;
+                m_deadlockCount += 1;
+                std::cout << "PFC deadlock at " << Simulator::Now().GetNanoSeconds() << "ns:";
+                for(auto it = cycle.rbegin(); it != cycle.rend(); ++it)
+                    std::cout << " " << hops[*it].node->GetID() << ":" << hops[*it].dev->GetIfIndex();
+                std::cout << " class " << hops[v].cls << std::endl;
+                if(m_deadlockRecover)
+                    hops[v].dev->RecoverPfc(hops[v].cls, hops[v].node->m_watchdogRecovery);
+            }
+        }
+    }
+
+    m_deadlockStalls.swap(stalls);
+    m_deadlockEvent = Simulator::Schedule(m_deadlockInterval, &SwitchNode::CheckDeadlock);
+}
+
 void 
-SwitchNode::SendPFC(Ptr<NetDevice> dev, bool pause)
+SwitchNode::SendPFC(Ptr<NetDevice> dev, uint32_t cls, uint16_t quanta)
 {
     Ptr<Packet> packet = Create<Packet>();
     PfcHeader pfc_header;
-    if(pause) pfc_header.SetPause(2);
-    else pfc_header.SetResume(2);
+    if(quanta > 0) pfc_header.SetPause(cls, quanta);
+    else pfc_header.SetResume(cls);
     packet->AddHeader(pfc_header);
 
-    SocketPriorityTag tag;
-    tag.SetPriority(0);
-    packet->ReplacePacketTag(tag);
+    packet->SetSlot(Packet::SLOT_PRIORITY, 0);
     if(!dev->Send(packet, dev->GetBroadcast(), 0x8808))
         std::cout << "Drop of PFC" << std::endl;
 }
@@ -2,17 +2,23 @@
 #define SWITCH_NODE_H
 
 #include "ns3/node.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/random-variable-stream.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv6-header.h"
 
 #include "ppp-header.h"
 #include "hctcp-header.h"
 #include "command-header.h"
+#include "pfc-header.h"
 #include "rohc-compressor.h"
 #include "rohc-decompressor.h"
 
 #include <bitset>
+#include <map>
 #include <random>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -35,7 +41,27 @@ class SwitchNode : public Node
      */
     static TypeId GetTypeId();
 
+    /**
+     * \brief ECMP routes of a switch, enough to replay its forwarding
+     * decision without touching the switch.
+     */
+    struct RouteTable
+    {
+        int hashSeed{0};
+        std::unordered_map<uint32_t, std::vector<uint32_t>> v4route;
+        std::map<std::pair<uint64_t, uint64_t>, std::vector<uint32_t>> v6route;
+        std::unordered_map<uint32_t, uint32_t> node;
+
+        uint16_t GetNextDev(const FlowV4Id& id) const;
+        uint16_t GetNextDev(const FlowV6Id& id) const;
+        uint16_t GetNextNode(uint16_t devId) const;
+    };
+
     SwitchNode();
+    /**
+     * \param systemId the partition of the switch in a parallel simulation
+     */
+    SwitchNode(uint32_t systemId);
     virtual ~SwitchNode();
 
     /**
@@ -69,6 +95,7 @@ class SwitchNode : public Node
     void SetECMPHash(uint32_t hashSeed);
     void SetSetting(uint32_t setting);
     void SetPFC(uint32_t pfc);
+    void SetVxLAN(uint32_t vxlan);
     
     void SetID(uint32_t id);
     uint32_t GetID();
@@ -82,10 +109,26 @@ class SwitchNode : public Node
 
     uint16_t GetNextNode(uint16_t devId);
 
+    // Routes are fixed once the simulation starts
+    const RouteTable& GetRouteTable() const;
+
     void MarkNicDevice(Ptr<NetDevice> device);
 
     bool IngressPipeline(Ptr<Packet> packet, uint16_t protocol, Ptr<NetDevice> dev);
     Ptr<Packet> EgressPipeline(Ptr<Packet> packet, uint16_t protocol, Ptr<NetDevice> dev);
+    // Gives back the buffer charged on ingress, false without the ingress slots
+    bool ReleaseIngress(Ptr<Packet> packet);
+
+    bool IsPausing(uint32_t port, uint32_t cls);
+
+    /**
+     * Periodically look for cyclic buffer dependencies among paused links of
+     * all SwitchNodes, and lift the pause on one hop of each cycle if recover is set.
+     * A hop counts once it has stayed paused and backlogged without sending
+     * for a whole interval, so transient back-pressure is not a deadlock.
+     */
+    static void StartDeadlockDetector(Time interval, bool recover);
+    static uint64_t GetDeadlockCount();
 
     protected:
     std::string m_output;
@@ -93,6 +136,7 @@ class SwitchNode : public Node
     uint32_t m_nid;
     uint32_t m_setting;
     uint32_t m_pfc{0};
+    uint32_t m_vxlan{0};
 
     uint32_t m_userThd = 2064000;
     uint32_t m_pfcThd = 250000;
@@ -100,30 +144,76 @@ class SwitchNode : public Node
     uint32_t m_resumeThd = 200000;
     uint32_t m_resumeNicThd = 40000;
     int32_t m_userSize = 0;
-    std::unordered_map<Ptr<NetDevice>, uint32_t> m_ingressSize;
-    std::unordered_map<Ptr<NetDevice>, bool> m_pause;
-    std::unordered_map<Ptr<NetDevice>, uint64_t> m_pauseTime;
-    std::unordered_map<Ptr<NetDevice>, uint64_t> m_pauseDuration;
     std::unordered_set<Ptr<NetDevice>> m_nicDevices;
 
-    int m_hashSeed;
+    // Ingress accounting and the pause we assert towards the upstream port
+    struct PfcPortState
+    {
+        int32_t ingressSize[PfcHeader::PRIORITY_NUM]{};
+        bool pause[PfcHeader::PRIORITY_NUM]{};
+        uint64_t pauseTime[PfcHeader::PRIORITY_NUM]{};
+        EventId refresh[PfcHeader::PRIORITY_NUM];
+        // Bytes of ingressSize bound for each egress port, indexed by its ifIndex
+        std::vector<int32_t> egressSize[PfcHeader::PRIORITY_NUM];
+    };
+    // Indexed by ifIndex
+    std::vector<PfcPortState> m_pfcPorts;
+    uint64_t m_pauseDuration = 0;
+
+    uint32_t m_pfcClasses;   // bit i set if class i is lossless
+    uint16_t m_pfcQuanta;
+    double m_pfcRefresh;     // fraction of the pause time after which it is refreshed
+    Time m_watchdogTimeout;
+    Time m_watchdogRecovery;
+    uint64_t m_watchdogCount = 0;
+
 
     uint64_t m_drops = 0;
     uint64_t m_ecnCount = 0;
     uint64_t m_pfcCount = 0;
 
-    std::unordered_map<uint32_t, std::vector<uint32_t>> m_v4route;
-    std::map<std::pair<uint64_t, uint64_t>, std::vector<uint32_t>> m_v6route;
+    static Time m_deadlockInterval;
+    static EventId m_deadlockEvent;
+    static bool m_deadlockRecover;
+    static uint64_t m_deadlockCount;
+    // Paused and backlogged egress classes at the last check, by (node, port, class)
+    struct DeadlockStall
+    {
+        uint64_t txBytes;
+        uint32_t checks;    // consecutive checks without sending
+        bool reported;
+    };
+    static std::map<std::tuple<uint32_t, uint32_t, uint32_t>, DeadlockStall> m_deadlockStalls;
+    static void CheckDeadlock();
+
+    RouteTable m_route;
     std::unordered_map<uint32_t, std::vector<uint32_t>> m_idroute;
+    // ECMP choice for command packets
+    Ptr<UniformRandomVariable> m_random;
+    // Run by this process, every rank of an MPI run holds all the nodes
+    bool m_local{false};
 
     std::unordered_map<uint16_t, std::pair<uint16_t, uint16_t>> m_mplsroute;
 
-    std::unordered_map<uint32_t, uint32_t> m_node;
+    // Indexed by ifIndex, sized per link from PointToPointNetDevice::RohcContexts
+    std::vector<Ptr<RohcCompressor>> m_rohcCom;
+    std::vector<Ptr<RohcDecompressor>> m_rohcDecom;
+
+    void CreateRohc(Ptr<NetDevice> dev);
+
+    void Construct();
+    void DoInitialize() override;
 
-    std::unordered_map<Ptr<NetDevice>, Ptr<RohcCompressor>> m_rohcCom;
-    std::unordered_map<Ptr<NetDevice>, Ptr<RohcDecompressor>> m_rohcDecom;
+    PfcPortState& GetPfcPort(uint32_t port);
+    // Charge or release the ingress bytes of a packet against its egress port
+    void UpdateEgressSize(Ptr<Packet> packet, uint32_t egress, bool add);
+    void PausePort(uint32_t port, uint32_t cls);
+    void ResumePort(uint32_t port, uint32_t cls);
+    void RefreshPFC(uint32_t port, uint32_t cls);
+    void SendPFC(Ptr<NetDevice> dev, uint32_t cls, uint16_t quanta);
+    Time GetPauseTime(Ptr<NetDevice> dev);
 
-    void SendPFC(Ptr<NetDevice> dev, bool pause);
+    void CheckPfcWatchdog();
 
     void UpdateMplsRoute(CommandHeader cmd);
 
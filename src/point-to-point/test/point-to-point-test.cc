@@ -18,9 +18,11 @@
  */
 
 #include "ns3/drop-tail-queue.h"
+#include "ns3/int-tag.h"
 #include "ns3/net-device-queue-interface.h"
 #include "ns3/point-to-point-channel.h"
 #include "ns3/point-to-point-net-device.h"
+#include "ns3/rdma-congestion-control.h"
 #include "ns3/simulator.h"
 #include "ns3/test.h"
 
@@ -139,6 +141,149 @@ PointToPointTest::DoRun()
     Simulator::Destroy();
 }
 
+/**
+ * \brief Rate updates of the RDMA congestion controls on hand made ACKs
+ */
+class RdmaCongestionControlTest : public TestCase
+{
+  public:
+    RdmaCongestionControlTest();
+
+    void DoRun() override;
+
+  private:
+    void TestDcqcn();
+    void TestHpcc();
+    void TestSwift();
+
+    static RdmaAck MakeAck(int64_t now, uint64_t seq, bool cnp, const IntTag* tag);
+};
+
+RdmaCongestionControlTest::RdmaCongestionControlTest()
+    : TestCase("RDMA congestion control")
+{
+}
+
+RdmaAck
+RdmaCongestionControlTest::MakeAck(int64_t now, uint64_t seq, bool cnp, const IntTag* tag)
+{
+    RdmaAck ack;
+    ack.now = now;
+    ack.seq = seq;
+    ack.newlyAcked = 1000;
+    ack.sent = seq + 500;
+    ack.cnp = cnp;
+    ack.tag = tag;
+    return ack;
+}
+
+void
+RdmaCongestionControlTest::TestDcqcn()
+{
+    Ptr<DcqcnCc> cc = CreateObject<DcqcnCc>();
+    cc->Init(12.5);
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), 12.1, 1e-9, "Starts at the initial rate");
+
+    cc->OnAck(MakeAck(1000, 1000, false, nullptr));
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), 12.1, 1e-9, "No CNP, no change");
+
+    // Alpha decays for two periods, gets the CNP and the rate is cut by alpha / 2
+    cc->OnAck(MakeAck(20000, 2000, true, nullptr));
+    double g = 1.0 / 256.0;
+    double alpha = (1 - g) * (1 - g) * (1 - g) + g;
+    double cut = 12.1 * (1 - alpha / 2);
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), cut, 1e-9, "CNP cuts the rate");
+
+    cc->OnAck(MakeAck(25000, 3000, true, nullptr));
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), cut, 1e-9, "No second cut within DecreaseInterval");
+
+    // First increase stage moves halfway back to the target rate
+    cc->OnAck(MakeAck(25000 + 100000, 4000, false, nullptr));
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), (12.1 + cut) / 2, 1e-9, "Fast recovery");
+
+    cc->OnAck(MakeAck(100000000, 5000, false, nullptr));
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), 12.5, 1e-6, "Recovers the line rate");
+}
+
+void
+RdmaCongestionControlTest::TestHpcc()
+{
+    Ptr<HpccCc> cc = CreateObject<HpccCc>();
+    cc->Init(12.5);
+
+    cc->OnAck(MakeAck(1000, 1000, false, nullptr));
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), 12.1, 1e-9, "No telemetry, no change");
+
+    // A 100 Gb/s hop fully busy with a standing queue of 100 KB
+    uint64_t txBytes = 0;
+    for(uint32_t i = 0; i < 30; ++i){
+        IntTag tag;
+        tag.PushHop(i * 1000, txBytes, 100000, 100000000000);
+        txBytes += 12500;
+        cc->OnAck(MakeAck(i * 1000, (i + 2) * 1000, false, &tag));
+    }
+    double busy = cc->GetRate();
+    NS_TEST_EXPECT_MSG_LT(busy, 6.0, "Overloaded hop cuts the rate");
+
+    // The same hop almost idle
+    for(uint32_t i = 30; i < 60; ++i){
+        IntTag tag;
+        tag.PushHop(i * 1000, txBytes, 0, 100000000000);
+        txBytes += 1250;
+        cc->OnAck(MakeAck(i * 1000, (i + 2) * 1000, false, &tag));
+    }
+    NS_TEST_EXPECT_MSG_GT(cc->GetRate(), busy, "Idle hop raises the rate");
+
+    // A different path only records the new hops
+    double rate = cc->GetRate();
+    IntTag tag;
+    tag.PushHop(60000, 0, 100000, 100000000000);
+    tag.PushHop(60000, 0, 100000, 100000000000);
+    cc->OnAck(MakeAck(60000, 62000, false, &tag));
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), rate, 1e-9, "New path keeps the rate");
+}
+
+void
+RdmaCongestionControlTest::TestSwift()
+{
+    Ptr<SwiftCc> cc = CreateObject<SwiftCc>();
+    cc->Init(12.5);
+
+    // 50 us against a 20 us target, cut by 0.8 * 30 / 50
+    IntTag tag;
+    tag.SetTimestamp(0);
+    cc->OnAck(MakeAck(50000, 1000, false, &tag));
+    double cut = 12.1 * (1 - 0.8 * 30.0 / 50.0);
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), cut, 1e-9, "Delay above target cuts the rate");
+
+    // At most one cut per RTT
+    tag.SetTimestamp(10000);
+    cc->OnAck(MakeAck(60000, 2000, false, &tag));
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), cut, 1e-9, "No second cut within an RTT");
+
+    // A window worth of ACKs below target adds RateAI
+    tag.SetTimestamp(60000);
+    RdmaAck ack = MakeAck(70000, 3000, false, &tag);
+    ack.newlyAcked = 1000000;
+    cc->OnAck(ack);
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), cut + 0.05, 1e-9, "Delay below target adds RateAI");
+
+    // Very large delay, the cut is bounded by MaxMdf
+    double rate = cc->GetRate();
+    tag.SetTimestamp(1000000);
+    cc->OnAck(MakeAck(2000000, 4000, false, &tag));
+    NS_TEST_EXPECT_MSG_EQ_TOL(cc->GetRate(), rate * 0.5, 1e-9, "Cut bounded by MaxMdf");
+}
+
+void
+RdmaCongestionControlTest::DoRun()
+{
+    TestDcqcn();
+    TestHpcc();
+    TestSwift();
+    Simulator::Destroy();
+}
+
 /**
  * \brief TestSuite for PointToPoint module
  */
@@ -155,6 +300,7 @@ PointToPointTestSuite::PointToPointTestSuite()
     : TestSuite("devices-point-to-point", UNIT)
 {
     AddTestCase(new PointToPointTest, TestCase::QUICK);
+    AddTestCase(new RdmaCongestionControlTest, TestCase::QUICK);
 }
 
 static PointToPointTestSuite g_pointToPointTestSuite; //!< The testsuite